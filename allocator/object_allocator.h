@@ -18,9 +18,8 @@
 #ifndef TESLA_ALLOCATOR_OBJECT_ALLOCATOR_H_
 #define TESLA_ALLOCATOR_OBJECT_ALLOCATOR_H_
 
-#include <cstdio>   // for fprintf, stderr
-#include <cstdlib>  // for abort
 #include "allocator/metadata_allocator.h"  // for MetaDataAlloc
+#include "log/logging.h"                   // for LOG_FATAL
 
 namespace tesla {
 namespace allocator {
@@ -53,11 +52,8 @@ class ObjectAllocator {
       if (free_avail_ < sizeof(T)) {
         free_area_ = reinterpret_cast<char*>(MetaDataAlloc(kAllocIncrement));
         if (free_area_ == nullptr) {
-          // TODO: Print stacktrace to stderr.
-          fprintf(stderr, "%s %d FATAL ERROR: Out of memory trying to "
-                  "allocate bytes[%zd] for object-size[%zd]!", __FILE__,
-                  __LINE__, kAllocIncrement, sizeof(T));
-          abort();
+          LOG_FATAL << "Out of memory trying to allocate bytes["
+                    << kAllocIncrement << "] for object-size[" << sizeof(T) << "]";
         }
         free_avail_ = kAllocIncrement;
       }
@@ -22,6 +22,7 @@
 #include <memory>
 #include <pthread.h>
 #include "tutil/compiler_specific.h"
+#include "log/logging.h"
 
 namespace tesla {
 namespace allocator {
@@ -208,6 +209,7 @@ class TESLA_CACHELINE_ALIGNMENT ObjectPool {
     DynamicFreeChunk* p = (DynamicFreeChunk*)malloc(
       sizeof(DynamicFreeChunk) + sizeof(c.ptrs[0]) * c.num_ptrs);
     if (!p) {
+      LOG_ERROR << "Fail to allocate a free chunk of " << c.num_ptrs << " items";
       return false;
     }
 
@@ -245,6 +247,7 @@ class TESLA_CACHELINE_ALIGNMENT ObjectPool {
   static Block* AddBlock() {
     Block* const new_block = new (std::nothrow) Block;
     if (new_block == nullptr) {
+      LOG_ERROR << "Fail to allocate a block of " << kNumItemsInBlock << " items";
       return nullptr;
     }
 
@@ -265,6 +268,7 @@ class TESLA_CACHELINE_ALIGNMENT ObjectPool {
     } while (AddGroup(num_block_groups));
 
     // Fail to add BlockGroup
+    LOG_ERROR << "Fail to add a block group, num_block_groups=" << num_block_groups;
     delete new_block;
     return nullptr;
   }
@@ -286,6 +290,7 @@ class TESLA_CACHELINE_ALIGNMENT ObjectPool {
         // **un-constructed** `new_group' ?
         block_groups_[group_index].store(new_group, std::memory_order_relaxed);
         num_block_groups_.store(group_index + 1, std::memory_order_release);
+        LOG_DEBUG << "Added block group " << group_index;
       }
     }
     return new_group != nullptr;
@@ -35,7 +35,11 @@ AsyncLogging::AsyncLogging(const string& basename,
     latch_(1),
     thread_(&AsyncLogging::ThreadFunction, this),
     current_buffer_(new Buffer),
-    next_buffer_(new Buffer) {
+    next_buffer_(new Buffer),
+    appended_bytes_(0),
+    written_bytes_(0),
+    dropped_bytes_(0),
+    dropped_buffers_(0) {
 
   current_buffer_->bzero();
   next_buffer_->bzero();
@@ -51,6 +55,7 @@ AsyncLogging::~AsyncLogging() {
 
 void AsyncLogging::Append(const char* logline, int len) {
   std::lock_guard<std::mutex> lock(mutex_); 
+  appended_bytes_.fetch_add(len, std::memory_order_relaxed);
   if (current_buffer_->avail() > len) {
     current_buffer_->append(logline, len);
   } else {
@@ -86,7 +91,7 @@ void AsyncLogging::ThreadFunction() {
       std::unique_lock<std::mutex> lock(mutex_); 
 
       // wait for the notification or flush_interval_ seconds.
-      if (buffers_.empty()) {
+      if (buffers_.empty() && running_) {
         condition_.wait_for(lock, std::chrono::seconds(flush_interval_));
       }
 
@@ -103,19 +108,31 @@ void AsyncLogging::ThreadFunction() {
 
     // discard log
     if (buffers_to_write_.size() > 25) {
+      uint64_t dropped = 0;
+      for (size_t i = 2; i < buffers_to_write_.size(); ++i) {
+        dropped += buffers_to_write_[i]->length();
+      }
+      dropped_bytes_.fetch_add(dropped, std::memory_order_relaxed);
+      dropped_buffers_.fetch_add(buffers_to_write_.size() - 2,
+                                 std::memory_order_relaxed);
       char buf[256];
       snprintf(buf, sizeof buf, "Dropped log message at %s, %zd larger buffers\n",
                Timestamp::now().toFormattedString().c_str(),
                buffers_to_write_.size() -2);
       fputs(buf, stderr);
-      output.Append(buf, static_cast<int>(strlen(buf)));
+      const size_t notice_len = strlen(buf);
+      output.Append(buf, static_cast<int>(notice_len));
+      written_bytes_.fetch_add(notice_len, std::memory_order_relaxed);
       buffers_to_write_.erase(buffers_to_write_.begin()+2, buffers_to_write_.end());
     }
 
+    uint64_t written = 0;
     for (size_t i = 0; i < buffers_to_write_.size(); ++i) {
       output.Append(buffers_to_write_[i]->data(), 
                     buffers_to_write_[i]->length());
+      written += buffers_to_write_[i]->length();
     }
+    written_bytes_.fetch_add(written, std::memory_order_relaxed);
 
     if (!new_buffer1_) {
       assert(!buffers_to_write_.empty());
@@ -132,6 +149,22 @@ void AsyncLogging::ThreadFunction() {
     buffers_to_write_.clear();
     output.Flush();
   }
+
+  // Write what was appended after the last round, Stop() must not lose
+  // the tail of the log.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.push_back(std::move(current_buffer_));
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      output.Append(buffers_[i]->data(), buffers_[i]->length());
+      written_bytes_.fetch_add(buffers_[i]->length(),
+                               std::memory_order_relaxed);
+    }
+    // Keep Append() after Stop() safe, nothing will write it though.
+    current_buffer_ = std::move(buffers_[0]);
+    current_buffer_->reset();
+    buffers_.clear();
+  }
   output.Flush();
 }
 
@@ -140,8 +173,22 @@ void AsyncLogging::Start() {
   latch_.CountDown();
 }
 
+AsyncLogging::Stats AsyncLogging::GetStats() const {
+  Stats stats;
+  stats.appended_bytes = appended_bytes_.load(std::memory_order_relaxed);
+  stats.written_bytes = written_bytes_.load(std::memory_order_relaxed);
+  stats.dropped_bytes = dropped_bytes_.load(std::memory_order_relaxed);
+  stats.dropped_buffers = dropped_buffers_.load(std::memory_order_relaxed);
+  return stats;
+}
+
 void AsyncLogging::Stop() {
-  running_ = false;
+  {
+    // Under the lock, so the backend can't miss the notification between
+    // testing running_ and waiting.
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
   condition_.notify_one();
   thread_.join();
 }
@@ -30,6 +30,17 @@ class AsyncLogging : Noncopyable {
 
   void Start();
   void Stop();
+
+  // Counters of the backend, may be read from any thread.
+  // appended - written - dropped is the amount waiting for the backend,
+  // less the "Dropped log message" notices the backend writes itself.
+  struct Stats {
+    uint64_t appended_bytes;   // accepted by Append()
+    uint64_t written_bytes;    // handed to the log file, notices included
+    uint64_t dropped_bytes;    // discarded because the backend fell behind
+    uint64_t dropped_buffers;
+  };
+  Stats GetStats() const;
   
   static void Init(char* path, Logger::LogLevel level = Logger::INFO,
                    int roll_size = 1024 * 1024 * 1024,
@@ -46,7 +57,7 @@ class AsyncLogging : Noncopyable {
   off_t roll_size_;
   const int flush_interval_;
 
-  bool running_;
+  std::atomic<bool> running_;
 
   CountDownLatch latch_;  
   std::mutex mutex_;
@@ -56,6 +67,11 @@ class AsyncLogging : Noncopyable {
   BufferPtr current_buffer_;
   BufferPtr next_buffer_;
   BufferVectorPtr buffers_;
+
+  std::atomic<uint64_t> appended_bytes_;
+  std::atomic<uint64_t> written_bytes_;
+  std::atomic<uint64_t> dropped_bytes_;
+  std::atomic<uint64_t> dropped_buffers_;
 };
 
 } // namespace log
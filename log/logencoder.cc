@@ -0,0 +1,161 @@
+#include "logencoder.h"
+
+#include <string.h>
+
+#include <cmath>
+
+namespace tesla {
+namespace log {
+
+namespace {
+
+// Characters which force a logfmt value to be quoted.
+inline bool NeedLogfmtQuote(const char* s, int len) {
+  if (len == 0) {
+    return true;
+  }
+  for (int i = 0; i < len; ++i) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c <= ' ' || c == '=' || c == '"' || c == '\\' || c == 0x7f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendEscaped(LogStream& out, const char* s, int len) {
+  static const char kHex[] = "0123456789abcdef";
+  const char* begin = s;
+  const char* end = s + len;
+  for (const char* p = s; p != end; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f) {
+      continue;
+    }
+    out.Append(begin, static_cast<int>(p - begin));
+    begin = p + 1;
+    switch (c) {
+      case '"':  out.Append("\\\"", 2); break;
+      case '\\': out.Append("\\\\", 2); break;
+      case '\n': out.Append("\\n", 2); break;
+      case '\r': out.Append("\\r", 2); break;
+      case '\t': out.Append("\\t", 2); break;
+      default: {
+        const char u[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf] };
+        out.Append(u, 6);
+      }
+    }
+  }
+  out.Append(begin, static_cast<int>(end - begin));
+}
+
+void AppendLogfmtValue(LogStream& out, const char* s, int len) {
+  if (NeedLogfmtQuote(s, len)) {
+    out << '"';
+    AppendEscaped(out, s, len);
+    out << '"';
+  } else {
+    out.Append(s, len);
+  }
+}
+
+void AppendJsonString(LogStream& out, const char* s, int len) {
+  out << '"';
+  AppendEscaped(out, s, len);
+  out << '"';
+}
+
+// Numeric values are shared by both encoders, strings are not.
+void AppendNumber(LogStream& out, const LogField& f, bool json) {
+  switch (f.type) {
+    case LogField::kBool:
+      out << (f.value.b ? "true" : "false");
+      break;
+    case LogField::kInt:
+      out << static_cast<long long>(f.value.i);
+      break;
+    case LogField::kUint:
+      out << static_cast<unsigned long long>(f.value.u);
+      break;
+    case LogField::kDouble:
+      // JSON has no representation of nan and inf.
+      if (json && !std::isfinite(f.value.d)) {
+        out << "null";
+      } else {
+        out << f.value.d;
+      }
+      break;
+    case LogField::kString:
+      break;
+  }
+}
+
+void AppendCaller(LogStream& out, const LogRecord& r) {
+  out.Append(r.file, r.file_len);
+  out << ':' << r.line;
+}
+
+} // namespace
+
+void AppendLogfmtFields(const LogStream& fields, LogStream& out) {
+  for (int i = 0; i < fields.fieldCount(); ++i) {
+    const LogField& f = fields.field(i);
+    out << ' ';
+    out.Append(f.key, f.key_len);
+    out << '=';
+    if (f.type == LogField::kString) {
+      AppendLogfmtValue(out, fields.fieldData(f), f.value.s.length);
+    } else {
+      AppendNumber(out, f, false);
+    }
+  }
+}
+
+void LogfmtEncoder::Encode(const LogRecord& r, LogStream& out) {
+  out.Append("time=", 5);
+  AppendLogfmtValue(out, r.time, r.time_len);
+  out << " tid=" << r.tid << " level=";
+  out.Append(r.level, r.level_len);
+  if (r.func) {
+    out.Append(" func=", 6);
+    AppendLogfmtValue(out, r.func, static_cast<int>(strlen(r.func)));
+  }
+  out.Append(" msg=", 5);
+  AppendLogfmtValue(out, r.message, r.message_len);
+  AppendLogfmtFields(*r.fields, out);
+  out.Append(" caller=", 8);
+  AppendCaller(out, r);
+  out << '\n';
+}
+
+void JsonEncoder::Encode(const LogRecord& r, LogStream& out) {
+  out.Append("{\"time\":", 8);
+  AppendJsonString(out, r.time, r.time_len);
+  out << ",\"tid\":" << r.tid << ",\"level\":\"";
+  out.Append(r.level, r.level_len);
+  out << '"';
+  if (r.func) {
+    out.Append(",\"func\":", 8);
+    AppendJsonString(out, r.func, static_cast<int>(strlen(r.func)));
+  }
+  out.Append(",\"msg\":", 7);
+  AppendJsonString(out, r.message, r.message_len);
+  const LogStream& fields = *r.fields;
+  for (int i = 0; i < fields.fieldCount(); ++i) {
+    const LogField& f = fields.field(i);
+    out << ',';
+    AppendJsonString(out, f.key, f.key_len);
+    out << ':';
+    if (f.type == LogField::kString) {
+      AppendJsonString(out, fields.fieldData(f), f.value.s.length);
+    } else {
+      AppendNumber(out, f, true);
+    }
+  }
+  out.Append(",\"caller\":\"", 11);
+  AppendCaller(out, r);
+  out.Append("\"}\n", 3);
+}
+
+} // namespace log
+} // namespace tesla
@@ -0,0 +1,64 @@
+/***************************************************************************
+ * LogEncoder 决定一条日志最终输出的格式。默认(未设置 encoder)时输出文本格式,
+ * kv() 写入的字段以 ` key=value' 的形式追加在消息之后。用法：
+ *
+ * static tesla::log::JsonEncoder json_encoder;
+ * tesla::log::Logger::set_encoder(&json_encoder);
+ *
+ * LOG_INFO.kv("user", id).kv("lat_us", 12.5) << "request done";
+ * // {"time":"20190101 12:00:00.000000Z","tid":1234,"level":"INFO",
+ * //  "msg":"request done","user":42,"lat_us":12.5,"caller":"main.cc:10"}
+ ***************************************************************************/
+
+#ifndef TESLALOG_LOGENCODER_H_
+#define TESLALOG_LOGENCODER_H_
+
+#include "noncopyable.h"
+#include "logstream.h"
+
+namespace tesla {
+namespace log {
+
+// Everything known about one log line when it is finished.
+struct LogRecord {
+  const char* time;         // "20190101 12:00:00.000000Z"
+  int time_len;
+  int tid;
+  const char* level;        // "INFO", "WARN", ...
+  int level_len;
+  const char* func;         // NULL unless logged by LOG_TRACE/LOG_DEBUG
+  const char* message;      // free text written by operator<<
+  int message_len;
+  const LogStream* fields;  // typed fields written by kv()
+  const char* file;         // basename of the source file
+  int file_len;
+  int line;
+};
+
+// Renders a LogRecord into `out'. Encoders are called from the threads
+// which write logs, so Encode() must be thread-safe.
+class LogEncoder : Noncopyable {
+ public:
+  virtual ~LogEncoder() = default;
+  virtual void Encode(const LogRecord& record, LogStream& out) = 0;
+};
+
+// time="..." tid=1234 level=INFO msg="..." user=42 caller=main.cc:10
+class LogfmtEncoder : public LogEncoder {
+ public:
+  void Encode(const LogRecord& record, LogStream& out) override;
+};
+
+// One JSON object per line.
+class JsonEncoder : public LogEncoder {
+ public:
+  void Encode(const LogRecord& record, LogStream& out) override;
+};
+
+// Append typed fields of `fields' to `out' as ` key=value' pairs.
+void AppendLogfmtFields(const LogStream& fields, LogStream& out);
+
+} // namespace log
+} // namespace tesla
+
+#endif // TESLALOG_LOGENCODER_H_
@@ -41,6 +41,11 @@ const char* LogLevelName[Logger::NUM_LOG_LEVELS] = {
   "FATAL ",
 };
 
+// Level names without padding, used by encoders.
+const int LogLevelNameLength[Logger::NUM_LOG_LEVELS] = {
+  5, 5, 4, 4, 5, 5,
+};
+
 void DefaultOutput(const char* message, int len) {
   fwrite(message, len, 1, stdout);
 }
@@ -53,6 +58,12 @@ void DefaultFlush() {
 Logger::OutputFunc kOutputFunc = DefaultOutput;
 // function that flush log buffer
 Logger::FlushFunc kFlushFunc = DefaultFlush;
+// encoder of log lines, NULL for the default text format
+LogEncoder* kLogEncoder = NULL;
+
+// Lines rendered by kLogEncoder are written here instead of the stream of
+// Logger, so no allocation happens in the logging thread.
+thread_local LogStream t_encoded;
 
 // helper class for known string length at compile time
 class T {
@@ -82,7 +93,10 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int l
     stream_(),
     level_(level),
     line_(line),
-    basename_(file) {
+    basename_(file),
+    func_(NULL),
+    time_len_(0),
+    header_len_(0) {
   // output datetime
   formatTime(); 
   // output thread id
@@ -90,6 +104,7 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int l
   stream_ << T(CurrentThread::tidString(), CurrentThread::tidStringLength());
   // output loglevel
   stream_ << T(LogLevelName[level], 6); 
+  header_len_ = stream_.buffer().length();
   if (savedErrno != 0) {
     stream_ << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") ";
   }
@@ -115,6 +130,8 @@ void Logger::Impl::formatTime() {
   Fmt us(".%06dZ ", microseconds);
   assert(us.length() == 9);
   stream_ << T(t_time, 17) << T(us.data(), 9);
+  // Without the trailing space.
+  time_len_ = stream_.buffer().length() - 1;
 }
 
 Logger::Logger(SourceFile file, int line)
@@ -125,6 +142,8 @@ Logger::Logger(SourceFile file, int line)
 Logger::Logger(SourceFile file, int line, LogLevel level, const char* func)
   : impl_(level, 0, file, line) {
   impl_.stream_ << func << ' ';
+  impl_.func_ = func;
+  impl_.header_len_ = impl_.stream_.buffer().length();
 }
 
 Logger::Logger(SourceFile file, int line, LogLevel level)
@@ -137,14 +156,43 @@ Logger::Logger(SourceFile file, int line, bool toAbort)
 }
 
 void Logger::Impl::finish() {
+  if (stream_.fieldCount() > 0) {
+    AppendLogfmtFields(stream_, stream_);
+  }
   stream_ << " - " << basename_ << ':' << line_ << '\n';
 }
 
+void Logger::Impl::encode(LogEncoder* encoder, LogStream& out) {
+  const LogStream::Buffer& buf = stream_.buffer();
+  LogRecord record;
+  record.time = buf.data();
+  record.time_len = time_len_;
+  record.tid = CurrentThread::tid();
+  record.level = LogLevelName[level_];
+  record.level_len = LogLevelNameLength[level_];
+  record.func = func_;
+  record.message = buf.data() + header_len_;
+  record.message_len = buf.length() - header_len_;
+  record.fields = &stream_;
+  record.file = basename_.data_;
+  record.file_len = basename_.size_;
+  record.line = line_;
+  encoder->Encode(record, out);
+}
+
 Logger::~Logger() {
-  // output filename and line number
-  impl_.finish(); 
-  const LogStream::Buffer& buf(stream().buffer());  
-  kOutputFunc(buf.data(), buf.length());
+  LogEncoder* encoder = kLogEncoder;
+  if (encoder == NULL) {
+    // output filename and line number
+    impl_.finish(); 
+    const LogStream::Buffer& buf(stream().buffer());  
+    kOutputFunc(buf.data(), buf.length());
+  } else {
+    t_encoded.resetBuffer();
+    impl_.encode(encoder, t_encoded);
+    const LogStream::Buffer& buf(t_encoded.buffer());
+    kOutputFunc(buf.data(), buf.length());
+  }
   if (impl_.level_ == FATAL) {
     kFlushFunc();
     abort();
@@ -163,5 +211,9 @@ void Logger::set_flush(Logger::FlushFunc flush) {
   kFlushFunc = flush;
 }
 
+void Logger::set_encoder(LogEncoder* encoder) {
+  kLogEncoder = encoder;
+}
+
 } // namespace log
 } // namespace tesla
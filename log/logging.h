@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "logstream.h"
+#include "logencoder.h"
 #include "timestamp.h"
 
 namespace tesla {
@@ -68,6 +69,10 @@ class Logger {
   static void set_output(OutputFunc);
   static void set_flush(FlushFunc);
 
+  // Set the encoder which renders finished log lines, NULL restores the
+  // default text format. `encoder' is not owned and must outlive logging.
+  static void set_encoder(LogEncoder* encoder);
+
  private:
   class Impl {
    public:
@@ -75,12 +80,16 @@ class Logger {
     Impl(LogLevel level, int old_errno, const SourceFile& file, int line);
     void formatTime();
     void finish();
+    void encode(LogEncoder* encoder, LogStream& out);
 
     Timestamp time_;
     LogStream stream_;
     LogLevel level_;
     int line_;
     SourceFile basename_;
+    const char* func_;
+    int time_len_;    // the time starts the line, see formatTime()
+    int header_len_;  // the message written by users starts here
   };
  
   Impl impl_; 
@@ -89,13 +98,29 @@ class Logger {
 extern Logger::LogLevel kLogLevel;
 inline Logger::LogLevel Logger::loglevel() { return kLogLevel; }
 
-#define LOG_TRACE if (tesla::log::Logger::loglevel() <= tesla::log::Logger::TRACE) \
+// Statements below TESLA_LOG_MIN_LEVEL are removed at compile time, so
+// LOG_TRACE/LOG_DEBUG cost nothing in hot paths of release builds, not
+// even the check of Logger::loglevel(). The value is a Logger::LogLevel,
+// 0 for TRACE, ..., 2 for INFO. Override it with -DTESLA_LOG_MIN_LEVEL=N.
+#ifndef TESLA_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define TESLA_LOG_MIN_LEVEL 2
+#else
+#define TESLA_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#define TESLA_LOG_ENABLED(level) \
+  (TESLA_LOG_MIN_LEVEL <= tesla::log::Logger::level && \
+   tesla::log::Logger::loglevel() <= tesla::log::Logger::level)
+
+#define LOG_TRACE if (TESLA_LOG_ENABLED(TRACE)) \
   tesla::log::Logger(__FILE__, __LINE__, tesla::log::Logger::TRACE, __func__).stream()
 
-#define LOG_DEBUG if (tesla::log::Logger::loglevel() <= tesla::log::Logger::DEBUG) \
+#define LOG_DEBUG if (TESLA_LOG_ENABLED(DEBUG)) \
   tesla::log::Logger(__FILE__, __LINE__, tesla::log::Logger::DEBUG, __func__).stream()
 
-#define LOG_INFO if (tesla::log::Logger::loglevel() <= tesla::log::Logger::INFO) \
+#define LOG_INFO if (TESLA_LOG_ENABLED(INFO)) \
   tesla::log::Logger(__FILE__, __LINE__).stream()
 
 #define LOG_WARN tesla::log::Logger(__FILE__, __LINE__, tesla::log::Logger::WARN).stream()
@@ -143,13 +168,46 @@ class LogMessageVoidify {
   void operator&(tesla::log::LogStream&) { }
 };
 
-/*
-#define LOG_IF(severity, condition) \
-  !(condition) ? (void)0 : tesla::log::LogMessageVoidify() & tesla::log::Logger(__FILE__, __LINE__, severity).stream()
-
-#define CHECK(condition) \
-  LOG_IF(tesla::log::Logger::FATAL, !(condition)) << "Check failed: `" #condition "` "
-*/
+// Log at `level' (a Logger::LogLevel) only if `condition' is true. Usable
+// as an expression, e.g. in the else branch of an if without braces.
+#define TESLA_LOG_IF(level, condition) \
+  !(TESLA_LOG_ENABLED(level) && (condition)) ? (void)0 : \
+  tesla::log::LogMessageVoidify() & \
+  tesla::log::Logger(__FILE__, __LINE__, tesla::log::Logger::level).stream()
+
+// Abort with a FATAL log if `condition' is false, in every build mode.
+// Extra context can be streamed: TESLA_CHECK(fd >= 0) << "open " << path;
+#define TESLA_CHECK(condition) \
+  (condition) ? (void)0 : \
+  tesla::log::LogMessageVoidify() & \
+  tesla::log::Logger(__FILE__, __LINE__, tesla::log::Logger::FATAL).stream() \
+      << "Check failed: " #condition " "
+
+#define TESLA_CHECK_EQ(val1, val2) TESLA_CHECK((val1) == (val2))
+#define TESLA_CHECK_NE(val1, val2) TESLA_CHECK((val1) != (val2))
+#define TESLA_CHECK_LE(val1, val2) TESLA_CHECK((val1) <= (val2))
+#define TESLA_CHECK_LT(val1, val2) TESLA_CHECK((val1) <  (val2))
+#define TESLA_CHECK_GE(val1, val2) TESLA_CHECK((val1) >= (val2))
+#define TESLA_CHECK_GT(val1, val2) TESLA_CHECK((val1) >  (val2))
+#define TESLA_CHECK_TRUE(cond)     TESLA_CHECK(cond)
+#define TESLA_CHECK_FALSE(cond)    TESLA_CHECK(!(cond))
+#define TESLA_CHECK_STREQ(a, b)    TESLA_CHECK(strcmp(a, b) == 0)
+
+// Checks of debug builds. With NDEBUG the condition and the streamed
+// values are still compiled, so they do not rot, but never evaluated.
+#ifdef NDEBUG
+#define TESLA_DCHECK(condition) \
+  while (false) TESLA_CHECK(condition)
+#else
+#define TESLA_DCHECK(condition) TESLA_CHECK(condition)
+#endif
+
+#define TESLA_DCHECK_EQ(val1, val2) TESLA_DCHECK((val1) == (val2))
+#define TESLA_DCHECK_NE(val1, val2) TESLA_DCHECK((val1) != (val2))
+#define TESLA_DCHECK_LE(val1, val2) TESLA_DCHECK((val1) <= (val2))
+#define TESLA_DCHECK_LT(val1, val2) TESLA_DCHECK((val1) <  (val2))
+#define TESLA_DCHECK_GE(val1, val2) TESLA_DCHECK((val1) >= (val2))
+#define TESLA_DCHECK_GT(val1, val2) TESLA_DCHECK((val1) >  (val2))
 
 } // namespace log
 } // namespace tesla
@@ -1,56 +1,334 @@
 #include "logstream.h"
 
-#include <algorithm>
+#include <cmath>
+
+#include "tutil/strings/integer_format.h"
 
 namespace tesla {
 namespace log {
 
-const char digits[] = "9876543210123456789";
-const char digitsHex[] = "0123456789ABCDEF";
-const char* zero = digits + 9;
+// ---------------------------------------------------------------------
+// Shortest round-trip formatting of floating point numbers.
+//
+// This is Grisu2 by Florian Loitsch ("Printing Floating-Point Numbers
+// Quickly and Accurately with Integers", PLDI 2010), in the form used by
+// RapidJSON. The generated digits always read back to the same value and
+// are the shortest ones in nearly all cases. Both float and double are
+// handled: only the boundaries of the rounding interval differ.
 
-template<typename T>
-size_t convert(char *buf, T value) {
-  T i = value;
-  char* p = buf;
+namespace {
 
-  do {
-    int lsd = static_cast<int>(i % 10);
-    i /= 10;
-    *p++ = zero[lsd];
-  } while (i != 0);
- 
-  if (value < 0) {
-    *p++ = '-';
+// A floating point number f * 2^e with a 64-bit significand.
+struct DiyFp {
+  DiyFp() : f(0), e(0) {}
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+  DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+  DiyFp operator*(const DiyFp& rhs) const {
+    const unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+    uint64_t h = static_cast<uint64_t>(p >> 64);
+    const uint64_t l = static_cast<uint64_t>(p);
+    if (l & (uint64_t(1) << 63)) {
+      ++h;  // rounding
+    }
+    return DiyFp(h, e + rhs.e + 64);
+  }
+
+  DiyFp Normalize() const {
+    const int s = __builtin_clzll(f);
+    return DiyFp(f << s, e - s);
+  }
+
+  uint64_t f;
+  int e;
+};
+
+// Layout of IEEE-754 binary32 and binary64.
+template <typename Float>
+struct IeeeTraits;
+
+template <>
+struct IeeeTraits<double> {
+  typedef uint64_t Bits;
+  static const int kSignificandSize = 52;
+  static const int kExponentBias = 0x3FF + kSignificandSize;
+};
+
+template <>
+struct IeeeTraits<float> {
+  typedef uint32_t Bits;
+  static const int kSignificandSize = 23;
+  static const int kExponentBias = 0x7F + kSignificandSize;
+};
+
+// Decompose a positive finite `value' and compute the normalized
+// boundaries m- and m+ of its rounding interval, m+ and the value share
+// the same exponent.
+template <typename Float>
+DiyFp Decompose(Float value, DiyFp* minus, DiyFp* plus) {
+  typedef IeeeTraits<Float> Traits;
+  typename Traits::Bits bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  const uint64_t hidden_bit = uint64_t(1) << Traits::kSignificandSize;
+  const uint64_t significand = bits & (hidden_bit - 1);
+  const int biased_e = static_cast<int>(bits >> Traits::kSignificandSize);
+  DiyFp v;
+  if (biased_e != 0) {
+    v = DiyFp(significand + hidden_bit, biased_e - Traits::kExponentBias);
+  } else {
+    v = DiyFp(significand, 1 - Traits::kExponentBias);  // subnormal
+  }
+
+  DiyFp pl = DiyFp((v.f << 1) + 1, v.e - 1).Normalize();
+  DiyFp mi = (v.f == hidden_bit) ? DiyFp((v.f << 2) - 1, v.e - 2)
+                                 : DiyFp((v.f << 1) - 1, v.e - 1);
+  mi.f <<= mi.e - pl.e;
+  mi.e = pl.e;
+  *plus = pl;
+  *minus = mi;
+  return v.Normalize();
+}
+
+// 10^k for k = -348, -340, ..., 340, normalized.
+const uint64_t kCachedPowersF[] = {
+  0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76, 0xcf42894a5dce35ea,
+  0x9a6bb0aa55653b2d, 0xe61acf033d1a45df, 0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f,
+  0xbe5691ef416bd60c, 0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+  0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57, 0xc21094364dfb5637,
+  0x9096ea6f3848984f, 0xd77485cb25823ac7, 0xa086cfcd97bf97f4, 0xef340a98172aace5,
+  0xb23867fb2a35b28e, 0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+  0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126, 0xb5b5ada8aaff80b8,
+  0x87625f056c7c4a8b, 0xc9bcff6034c13053, 0x964e858c91ba2655, 0xdff9772470297ebd,
+  0xa6dfbd9fb8e5b88f, 0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+  0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06, 0xaa242499697392d3,
+  0xfd87b5f28300ca0e, 0xbce5086492111aeb, 0x8cbccc096f5088cc, 0xd1b71758e219652c,
+  0x9c40000000000000, 0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+  0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068, 0x9f4f2726179a2245,
+  0xed63a231d4c4fb27, 0xb0de65388cc8ada8, 0x83c7088e1aab65db, 0xc45d1df942711d9a,
+  0x924d692ca61be758, 0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+  0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d, 0x952ab45cfa97a0b3,
+  0xde469fbd99a05fe3, 0xa59bc234db398c25, 0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece,
+  0x88fcf317f22241e2, 0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+  0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410, 0x8bab8eefb6409c1a,
+  0xd01fef10a657842c, 0x9b10a4e5e9913129, 0xe7109bfba19c0c9d, 0xac2820d9623bf429,
+  0x80444b5e7aa7cf85, 0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+  0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b
+};
+
+const int16_t kCachedPowersE[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066
+};
+
+// Get the cached power c_k = 10^-K such that the exponent of w * c_k
+// lies in [-60, -32].
+DiyFp GetCachedPower(int e, int* K) {
+  const double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = static_cast<int>(dk);
+  if (dk - k > 0.0) {
+    ++k;
+  }
+  const unsigned index = static_cast<unsigned>((k >> 3) + 1);
+  *K = -(-348 + static_cast<int>(index << 3));
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+const uint32_t kPow10U32[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+const uint64_t kPow10U64[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL,
+  10000000000000000000ULL,
+};
+
+inline int CountDecimalDigit32(uint32_t n) {
+  int count = 1;
+  while (count < 10 && n >= kPow10U32[count]) {
+    ++count;
+  }
+  return count;
+}
+
+// Move the last digit towards w when the result stays in the interval.
+inline void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                       uint64_t ten_kappa, uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+void DigitGen(const DiyFp& w, const DiyFp& mp, uint64_t delta,
+              char* buffer, int* len, int* K) {
+  const DiyFp one(uint64_t(1) << -mp.e, mp.e);
+  const DiyFp wp_w = mp - w;
+  uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = CountDecimalDigit32(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    const uint32_t d = p1 / kPow10U32[kappa - 1];
+    p1 %= kPow10U32[kappa - 1];
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    --kappa;
+    const uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (rest <= delta) {
+      *K += kappa;
+      GrisuRound(buffer, *len, delta, rest, kPow10U64[kappa] << -one.e, wp_w.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    const char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    p2 &= one.f - 1;
+    --kappa;
+    if (p2 < delta) {
+      *K += kappa;
+      const int index = -kappa;
+      GrisuRound(buffer, *len, delta, p2, one.f,
+                 wp_w.f * (index < 20 ? kPow10U64[index] : 0));
+      return;
+    }
   }
+}
 
-  *p = 0;
-  std::reverse(buf, p);
+// Generate the shortest digits of a positive finite `value',
+// value = digits * 10^K.
+template <typename Float>
+void Grisu2(Float value, char* digits, int* len, int* K) {
+  DiyFp w_m;
+  DiyFp w_p;
+  const DiyFp v = Decompose(value, &w_m, &w_p);
+  const DiyFp c_mk = GetCachedPower(w_p.e, K);
+  const DiyFp w = v * c_mk;
+  DiyFp wp = w_p * c_mk;
+  DiyFp wm = w_m * c_mk;
+  ++wm.f;
+  --wp.f;
+  DigitGen(w, wp, wp.f - wm.f, digits, len, K);
+}
 
+// Lay out digits * 10^K like printf("%g") does, but without a fixed
+// precision: plain notation for exponents in [-4, 17), otherwise
+// scientific notation with at least two exponent digits.
+size_t Prettify(char* buf, const char* digits, int len, int K) {
+  const int exponent = len + K - 1;
+  char* p = buf;
+  if (exponent >= -4 && exponent < 17) {
+    if (K >= 0) {
+      // 1234e2 -> 123400
+      memcpy(p, digits, len);
+      p += len;
+      memset(p, '0', K);
+      p += K;
+    } else if (exponent >= 0) {
+      // 1234e-2 -> 12.34
+      const int integral = exponent + 1;
+      memcpy(p, digits, integral);
+      p += integral;
+      *p++ = '.';
+      memcpy(p, digits + integral, len - integral);
+      p += len - integral;
+    } else {
+      // 1234e-6 -> 0.001234
+      *p++ = '0';
+      *p++ = '.';
+      memset(p, '0', -exponent - 1);
+      p += -exponent - 1;
+      memcpy(p, digits, len);
+      p += len;
+    }
+  } else {
+    // 1234e30 -> 1.234e+33
+    *p++ = digits[0];
+    if (len > 1) {
+      *p++ = '.';
+      memcpy(p, digits + 1, len - 1);
+      p += len - 1;
+    }
+    *p++ = 'e';
+    int e = exponent;
+    if (e < 0) {
+      *p++ = '-';
+      e = -e;
+    } else {
+      *p++ = '+';
+    }
+    if (e >= 100) {
+      *p++ = static_cast<char>('0' + e / 100);
+      e %= 100;
+    }
+    *p++ = static_cast<char>('0' + e / 10);
+    *p++ = static_cast<char>('0' + e % 10);
+  }
   return p - buf;
 }
 
-size_t convertHex(char *buf, uintptr_t value) {
-  uintptr_t i = value;
+template <typename Float>
+size_t FormatFloatingPoint(char* buf, Float value) {
   char* p = buf;
+  if (std::isnan(value)) {
+    memcpy(p, "nan", 3);
+    return 3;
+  }
+  if (std::signbit(value)) {
+    *p++ = '-';
+    value = -value;
+  }
+  if (std::isinf(value)) {
+    memcpy(p, "inf", 3);
+    return p - buf + 3;
+  }
+  if (std::fpclassify(value) == FP_ZERO) {
+    *p++ = '0';
+    return p - buf;
+  }
+  char digits[24];
+  int len = 0;
+  int K = 0;
+  Grisu2(value, digits, &len, &K);
+  return p - buf + Prettify(p, digits, len, K);
+}
 
-  do {
-    int lsd = static_cast<int>(i % 16);
-    i /= 16;
-    *p++ = digitsHex[lsd];
-  } while (i != 0);
+} // namespace
 
-  *p = 0;
-  std::reverse(buf, p);
+size_t FormatDouble(char* buf, double v) {
+  return FormatFloatingPoint(buf, v);
+}
 
-  return p - buf;
+size_t FormatFloat(char* buf, float v) {
+  return FormatFloatingPoint(buf, v);
 }
 
 template<typename T>
 void LogStream::formatInteger(T v) {
   if (buffer_.avail() >= kMaxNumericSize) {
-    size_t len = convert(buffer_.current(), v);
-    buffer_.add(len);
+    size_t len = ::tutil::FormatInteger(buffer_.current(), v);
+    buffer_.add(static_cast<int>(len));
   }
 }
 
@@ -102,27 +380,91 @@ LogStream& LogStream::operator<<(const void* p) {
     char* buf = buffer_.current();
     buf[0] = '0';
     buf[1] = 'x';
-    size_t len = convertHex(buf+2, v);
-    buffer_.add(len+2);
+    size_t len = ::tutil::FormatHex(buf+2, v);
+    buffer_.add(static_cast<int>(len+2));
   }
 
   return *this;
 }
 
 LogStream& LogStream::operator<<(float v) {
-  *this << static_cast<double>(v);
+  if (buffer_.avail() > kMaxNumericSize) {
+    size_t len = FormatFloat(buffer_.current(), v);
+    buffer_.add(static_cast<int>(len));
+  }
+
   return *this;
 }
 
 LogStream& LogStream::operator<<(double v) {
   if (buffer_.avail() > kMaxNumericSize) {
-    int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
-    buffer_.add(len);
+    size_t len = FormatDouble(buffer_.current(), v);
+    buffer_.add(static_cast<int>(len));
   }
   
   return *this;
 }
 
+LogField* LogStream::newField(const char* key, int key_len,
+                              LogField::Type type) {
+  if (!fields_) {
+    fields_.reset(new FieldArea);
+  }
+  if (fields_->count >= kMaxFields) {
+    return NULL;
+  }
+  LogField* f = &fields_->fields[fields_->count++];
+  f->key = key;
+  f->key_len = key_len;
+  f->type = type;
+  return f;
+}
+
+void LogStream::addBoolField(const char* key, int key_len, bool v) {
+  LogField* f = newField(key, key_len, LogField::kBool);
+  if (f) {
+    f->value.b = v;
+  }
+}
+
+void LogStream::addIntField(const char* key, int key_len, int64_t v) {
+  LogField* f = newField(key, key_len, LogField::kInt);
+  if (f) {
+    f->value.i = v;
+  }
+}
+
+void LogStream::addUintField(const char* key, int key_len, uint64_t v) {
+  LogField* f = newField(key, key_len, LogField::kUint);
+  if (f) {
+    f->value.u = v;
+  }
+}
+
+void LogStream::addDoubleField(const char* key, int key_len, double v) {
+  LogField* f = newField(key, key_len, LogField::kDouble);
+  if (f) {
+    f->value.d = v;
+  }
+}
+
+void LogStream::addStringField(const char* key, int key_len,
+                               const char* v, size_t len) {
+  // String values are copied, the caller may pass a temporary.
+  LogField* f = newField(key, key_len, LogField::kString);
+  if (f == NULL) {
+    return;
+  }
+  if (len > static_cast<size_t>(kSizeOfFieldData - fields_->data_len)) {
+    --fields_->count;
+    return;
+  }
+  memcpy(fields_->data + fields_->data_len, v, len);
+  f->value.s.offset = fields_->data_len;
+  f->value.s.length = static_cast<int>(len);
+  fields_->data_len += static_cast<int>(len);
+}
+
 template<typename T>
 Fmt::Fmt(const char* fmt, T val)
 {
@@ -1,7 +1,10 @@
 #ifndef TESLALOG_LOGSTREAM_H_
 #define TESLALOG_LOGSTREAM_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <type_traits>
 
 #include "noncopyable.h"
 #include "fixedbuffer.h"
@@ -9,11 +12,46 @@
 namespace tesla {
 namespace log {
 
+// A typed key-value field attached to a log line by LogStream::kv(). Keys
+// point to string literals; string values are copied into the field area
+// of the owning LogStream and referenced by offset. The area is allocated
+// by the first kv() of a line, streams without fields do not carry it.
+struct LogField {
+  enum Type {
+    kBool,
+    kInt,
+    kUint,
+    kDouble,
+    kString,
+  };
+
+  struct StringRef {
+    int offset;
+    int length;
+  };
+
+  const char* key;
+  int key_len;
+  Type type;
+  union {
+    bool b;
+    int64_t i;
+    uint64_t u;
+    double d;
+    StringRef s;
+  } value;
+};
+
 class LogStream : Noncopyable {
  public:
   const static int kSizeOfLogBuffer = 4000;
   typedef FixedBuffer<kSizeOfLogBuffer> Buffer;
 
+  // At most kMaxFields fields are kept for one log line, and at most
+  // kSizeOfFieldData bytes of string values. Extra fields are dropped.
+  const static int kMaxFields = 16;
+  const static int kSizeOfFieldData = 512;
+
   LogStream& operator<<(short v);
   LogStream& operator<<(unsigned short v);
   
@@ -50,15 +88,78 @@ class LogStream : Noncopyable {
   LogStream& operator<<(float v);
   LogStream& operator<<(double v);
   
+  // Attach a typed field to the log line, e.g.
+  //   LOG_INFO.kv("user", id).kv("lat_us", latency) << "request done";
+  // `key' must be a string literal, it is referenced rather than copied.
+  // Fields are not formatted here; the output encoder of Logger renders
+  // them (as ` key=value' pairs in the default text format).
+  template <int N, typename T>
+  LogStream& kv(const char (&key)[N], const T& value) {
+    if constexpr (std::is_same<T, bool>::value) {
+      addBoolField(key, N - 1, value);
+    } else if constexpr (std::is_same<T, char>::value) {
+      addStringField(key, N - 1, &value, 1);
+    } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+      addIntField(key, N - 1, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral<T>::value) {
+      addUintField(key, N - 1, static_cast<uint64_t>(value));
+    } else if constexpr (std::is_floating_point<T>::value) {
+      addDoubleField(key, N - 1, static_cast<double>(value));
+    } else {
+      addStringField(key, N - 1, value);
+    }
+    return *this;
+  }
+
+  int fieldCount() const { return fields_ ? fields_->count : 0; }
+  const LogField& field(int index) const { return fields_->fields[index]; }
+
+  // Get the string value of a kString field.
+  const char* fieldData(const LogField& f) const {
+    return fields_->data + f.value.s.offset;
+  }
+
   const Buffer& buffer() const { return buffer_; }
 
   void Append(const char* buf, int len) { buffer_.append(buf, static_cast<size_t>(len)); }
 
+  void resetBuffer() {
+    buffer_.reset();
+    if (fields_) {
+      fields_->count = 0;
+      fields_->data_len = 0;
+    }
+  }
+
  private:
   template<typename T>
   void formatInteger(T);
 
+  LogField* newField(const char* key, int key_len, LogField::Type type);
+  void addBoolField(const char* key, int key_len, bool v);
+  void addIntField(const char* key, int key_len, int64_t v);
+  void addUintField(const char* key, int key_len, uint64_t v);
+  void addDoubleField(const char* key, int key_len, double v);
+  void addStringField(const char* key, int key_len, const char* v, size_t len);
+
+  void addStringField(const char* key, int key_len, const char* v) {
+    addStringField(key, key_len, v ? v : "(null)", v ? strlen(v) : 6);
+  }
+
+  void addStringField(const char* key, int key_len, const std::string& v) {
+    addStringField(key, key_len, v.data(), v.size());
+  }
+
+  struct FieldArea {
+    int count = 0;
+    int data_len = 0;
+    LogField fields[kMaxFields];
+    char data[kSizeOfFieldData];
+  };
+
   Buffer buffer_; 
+
+  std::unique_ptr<FieldArea> fields_;
   
   static const int kMaxNumericSize = 32;
 };
@@ -77,6 +178,13 @@ class Fmt
   int length_;
 };
 
+// Format `v' into `buf' with the shortest digits which read back to the
+// same value, e.g. 0.1 -> "0.1", 1e21 -> "1e+21", 0.1f -> "0.1".
+// `buf' must have room for 32 bytes, the result is not NUL-terminated.
+// Returns the length of the result.
+size_t FormatDouble(char* buf, double v);
+size_t FormatFloat(char* buf, float v);
+
 inline LogStream& operator<<(LogStream& s, const Fmt& fmt)
 {
   s.Append(fmt.data(), fmt.length());
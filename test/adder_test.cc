@@ -1,6 +1,7 @@
 #include "tvar/reducer.h"
 
 #include <string.h>
+#include <atomic>
 #include <iostream>
 #include <thread>
 #include <gtest/gtest.h>
@@ -77,6 +78,52 @@ TEST_F(AdderTest, MultiThread) {
   }
 }
 
+TEST_F(AdderTest, DescribeDouble) {
+  Adder<double> d;
+  d << 0.1 << 0.2;
+  ASSERT_EQ(d.get_description(), "0.30000000000000004");
+}
+
+// A value updated by the seqlock of ElementContainer.
+struct Pair {
+  int64_t count;
+  int64_t total;
+};
+
+struct AddPair {
+  void operator()(Pair& lhs, const Pair& rhs) const {
+    lhs.count += rhs.count;
+    lhs.total += rhs.total;
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const Pair& p) {
+  return os << p.count << '/' << p.total;
+}
+
+TEST_F(AdderTest, CompositeValue) {
+  ASSERT_TRUE(detail::is_seqlockable<Pair>::value);
+  ASSERT_FALSE(detail::is_seqlockable<std::string>::value);
+
+  Reducer<Pair, AddPair> reducer(Pair{0, 0});
+  std::atomic<bool> stop(false);
+  std::thread writer([&reducer, &stop] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      reducer << Pair{1, 10};
+    }
+  });
+  // Readers and resets never see half of an update.
+  for (int i = 0; i < 100000; ++i) {
+    const Pair p = (i % 100 == 0) ? reducer.Reset() : reducer.GetValue();
+    ASSERT_EQ(p.count * 10, p.total);
+  }
+  stop.store(true, std::memory_order_relaxed);
+  writer.join();
+  reducer.Reset();
+  reducer << Pair{2, 3};
+  ASSERT_EQ(reducer.get_description(), "2/3");
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
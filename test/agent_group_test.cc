@@ -1,6 +1,7 @@
 #include "tvar/detail/agent_group.h"
 
 #include <string.h>
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <gtest/gtest.h>
@@ -112,6 +113,55 @@ TEST_F(AgentGroupTest, MultiThread) {
   AgentGroup<Agent>::DestroyAgent(id);
 }
 
+TEST_F(AgentGroupTest, ReuseId) {
+  AgentId id1 = AgentGroup<Agent>::CreateNewAgent();
+  AgentId id2 = AgentGroup<Agent>::CreateNewAgent();
+  ASSERT_NE(id1, id2);
+  ASSERT_EQ(AgentGroup<Agent>::DestroyAgent(id1), 0);
+  ASSERT_EQ(AgentGroup<Agent>::DestroyAgent(id2), 0);
+  // Last in first out.
+  ASSERT_EQ(AgentGroup<Agent>::CreateNewAgent(), id2);
+  ASSERT_EQ(AgentGroup<Agent>::CreateNewAgent(), id1);
+  AgentGroup<Agent>::DestroyAgent(id1);
+  AgentGroup<Agent>::DestroyAgent(id2);
+
+  ASSERT_EQ(AgentGroup<Agent>::DestroyAgent(-1), -1);
+  ASSERT_EQ(AgentGroup<Agent>::DestroyAgent(1 << 30), -1);
+}
+
+TEST_F(AgentGroupTest, ConcurrentCreateAndDestroy) {
+  struct OtherAgent {
+    int a{0};
+  };
+  using Group = AgentGroup<OtherAgent>;
+  std::vector<std::thread> v;
+  std::vector<std::vector<AgentId>> owned(kThreadNum);
+  for (int t = 0; t < kThreadNum; ++t) {
+    v.push_back(std::thread([&owned, t] {
+      for (int i = 0; i < 10000; ++i) {
+        AgentId id = Group::CreateNewAgent();
+        ASSERT_GE(id, 0);
+        if (i % 2 == 0) {
+          Group::DestroyAgent(id);
+        } else {
+          owned[t].push_back(id);
+        }
+      }
+    }));
+  }
+  for (auto& t : v) {
+    t.join();
+  }
+  // An id is never given to two owners.
+  std::vector<AgentId> all;
+  for (auto& ids : owned) {
+    all.insert(all.end(), ids.begin(), ids.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+  ASSERT_EQ(all.size(), kThreadNum * 5000u);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,82 @@
+#include "tvar/reducer.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tutil/count_down_latch.h"
+#include "tutil/time.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+// Startup of a large service: `nreducers' reducers are created, then
+// `nthreads' threads touch every one of them for the first time.
+int main(int argc, const char *argv[])
+{
+  int nthreads = 64;
+  int nreducers = 500;
+  if (argc > 1) {
+    nthreads = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    nreducers = atoi(argv[2]);
+  }
+
+  tesla::tutil::Timer timer;
+  std::vector<std::unique_ptr<Adder<int64_t>>> adders;
+  timer.start();
+  for (int i = 0; i < nreducers; ++i) {
+    adders.emplace_back(new Adder<int64_t>);
+  }
+  timer.stop();
+  cout << "create:      " << timer.n_elapsed() / nreducers << "ns/reducer"
+       << endl;
+
+  tesla::tutil::CountDownLatch start(1);
+  std::vector<double> costs(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([&adders, &start, &costs, t] {
+      start.Wait();
+      tesla::tutil::Timer timer;
+      timer.start();
+      for (auto& adder : adders) {
+        *adder << 1;
+      }
+      timer.stop();
+      costs[t] = timer.n_elapsed() / static_cast<double>(adders.size());
+    }));
+  }
+  timer.start();
+  start.CountDown();
+  for (auto& t : threads) {
+    t.join();
+  }
+  timer.stop();
+  double total = 0;
+  for (double cost : costs) {
+    total += cost;
+  }
+  cout << "first touch: " << total / nthreads << "ns/agent, "
+       << timer.n_elapsed() / 1000000.0 << "ms for " << nthreads
+       << " threads" << endl;
+
+  timer.start();
+  for (auto& adder : adders) {
+    adder->GetValue();
+  }
+  timer.stop();
+  cout << "combine:     " << timer.n_elapsed() / nreducers << "ns/reducer"
+       << endl;
+
+  timer.start();
+  adders.clear();
+  timer.stop();
+  cout << "destroy:     " << timer.n_elapsed() / nreducers << "ns/reducer"
+       << endl;
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "tvar/default_variables.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "tutil/time.h"
+#include "tvar/passive_status.h"
+#include "tvar/variable.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing default variables.
+class DefaultVariablesTest : public ::testing::Test {
+}; // class DefaultVariablesTest
+
+int64_t GetInt(const std::string& name) {
+  const std::string value = Variable::describe_exposed(name);
+  EXPECT_FALSE(value.empty()) << name;
+  return strtoll(value.c_str(), nullptr, 10);
+}
+
+double GetDouble(const std::string& name) {
+  const std::string value = Variable::describe_exposed(name);
+  EXPECT_FALSE(value.empty()) << name;
+  return strtod(value.c_str(), nullptr);
+}
+
+double GetTaken(void*) { return 42; }
+
+// Runs in a new process, where the default variables are not exposed yet.
+void ExposeTakenName() {
+  // Fail instead of hanging.
+  alarm(10);
+  PassiveStatus<double> taken("process_cpu_usage", GetTaken, nullptr);
+  Variable::count_exposed();
+  if (Variable::describe_exposed("process_cpu_usage") != "42" ||
+      Variable::describe_exposed("process_cpu_usage_user").empty()) {
+    exit(1);
+  }
+  exit(0);
+}
+
+TEST_F(DefaultVariablesTest, NameTaken) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_EXIT(ExposeTakenName(), ::testing::ExitedWithCode(0), "");
+}
+
+TEST_F(DefaultVariablesTest, Exposed) {
+  std::vector<std::string> names;
+  Variable::list_exposed(names);
+  for (const char* name : {
+           "process_cpu_usage", "process_cpu_usage_user",
+           "process_cpu_usage_system", "process_memory_resident",
+           "process_memory_virtual", "process_faults_minor",
+           "process_faults_major", "process_fd_count", "process_thread_count",
+           "process_context_switches_voluntary",
+           "process_context_switches_involuntary", "process_io_read_bytes",
+           "process_io_write_bytes", "process_disk_read_bytes",
+           "process_disk_write_bytes", "system_network_receive_bytes",
+           "system_network_transmit_bytes"}) {
+    ASSERT_NE(std::find(names.begin(), names.end(), name), names.end())
+        << name;
+  }
+  ASSERT_GT(GetInt("process_memory_resident"), 0);
+  ASSERT_GT(GetInt("process_memory_virtual"),
+            GetInt("process_memory_resident"));
+  ASSERT_GT(GetInt("process_faults_minor"), 0);
+  ASSERT_GE(GetInt("process_fd_count"), 3);
+  ASSERT_GE(GetInt("process_thread_count"), 1);
+}
+
+TEST_F(DefaultVariablesTest, Refreshed) {
+  // Values sampled after the sampler thread started.
+  Variable::count_exposed();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  const int64_t fds = GetInt("process_fd_count");
+  const int64_t threads = GetInt("process_thread_count");
+  std::vector<int> opened;
+  for (int i = 0; i < 10; ++i) {
+    opened.push_back(open("/dev/null", O_RDONLY));
+  }
+  bool stop = false;
+  std::thread idle([&stop] {
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+  // Keep busy until a sample sees the new fds and some user time, which
+  // does not depend on how loaded the machine is. 10s at most.
+  const int64_t deadline = tesla::tutil::clock_ns() + 10000000000L;
+  while (tesla::tutil::clock_ns() < deadline &&
+         (GetInt("process_fd_count") != fds + 10 ||
+          GetDouble("process_cpu_usage_user") <= 0)) {
+    const int64_t busy_until = tesla::tutil::clock_ns() + 50000000L;
+    while (tesla::tutil::clock_ns() < busy_until) {
+    }
+  }
+  EXPECT_EQ(fds + 10, GetInt("process_fd_count"));
+  EXPECT_EQ(threads + 1, GetInt("process_thread_count"));
+  // Usages are rates of the last second, no more than the CPUs can give
+  // (with some room for the tick granularity).
+  const double max_usage = 2.0 * sysconf(_SC_NPROCESSORS_ONLN);
+  for (const char* name : {"process_cpu_usage", "process_cpu_usage_user",
+                           "process_cpu_usage_system"}) {
+    const double usage = GetDouble(name);
+    EXPECT_GE(usage, 0) << name;
+    EXPECT_LE(usage, max_usage) << name;
+  }
+  EXPECT_GT(GetDouble("process_cpu_usage_user"), 0);
+
+  __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+  idle.join();
+  for (int fd : opened) {
+    close(fd);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "tvar/multi_dimension.h"
+#include "tvar/passive_status.h"
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing the periodic dumping into files.
+class FileDumperTest : public ::testing::Test {
+ protected:
+  static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path);
+    std::ostringstream os;
+    os << in.rdbuf();
+    return os.str();
+  }
+
+  // Wait until the content of `path' differs from `old', which means a
+  // round is done.
+  static std::string WaitForChange(const std::string& path,
+                                   const std::string& old) {
+    for (int i = 0; i < 50; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      const std::string content = ReadFile(path);
+      if (content != old) {
+        return content;
+      }
+    }
+    return old;
+  }
+}; // class FileDumperTest
+
+TEST_F(FileDumperTest, Snapshot) {
+  char dir[] = "/tmp/tvar_file_dumper_test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  const std::string path = std::string(dir) + "/sub/tvar.data";
+
+  Adder<int64_t> foo;
+  std::unique_ptr<Adder<int64_t>> bar(new Adder<int64_t>);
+  foo.expose("file_dumper_test_foo");
+  bar->expose("file_dumper_test_bar");
+  foo << 1;
+  *bar << 2;
+
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_file",
+                                            path.c_str()).empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_include",
+                                            "file_dumper_test_*").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_prefix", "").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_interval",
+                                            "1").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump", "true").empty());
+
+  std::string content = WaitForChange(path, "");
+  ASSERT_EQ("file_dumper_test_bar : 2\r\nfile_dumper_test_foo : 1\r\n",
+            content);
+  // Every round writes all variables, changed or not.
+  foo << 10;
+  content = WaitForChange(path, content);
+  ASSERT_EQ("file_dumper_test_bar : 2\r\nfile_dumper_test_foo : 11\r\n",
+            content);
+
+  // One line per labels.
+  MultiDimension<Adder<int64_t>> family("file_dumper_test_family",
+                                        {"method"});
+  *family.get_stats({"Get"}) << 3;
+  *family.get_stats({"Set"}) << 4;
+  content = WaitForChange(path, content);
+  ASSERT_EQ("file_dumper_test_bar : 2\r\n"
+            "file_dumper_test_family{method=\"Get\"} : 3\r\n"
+            "file_dumper_test_family{method=\"Set\"} : 4\r\n"
+            "file_dumper_test_foo : 11\r\n",
+            content);
+
+  // Hidden variables are gone.
+  bar.reset();
+  family.hide();
+  content = WaitForChange(path, content);
+  ASSERT_EQ("file_dumper_test_foo : 11\r\n", content);
+
+  foo.hide();
+  content = WaitForChange(path, content);
+  ASSERT_EQ("", content);
+  google::SetCommandLineOption("tvar_dump", "false");
+  // No temporary file is left.
+  ASSERT_NE(0, access((path + ".tmp").c_str(), F_OK));
+  unlink(path.c_str());
+  rmdir((std::string(dir) + "/sub").c_str());
+  rmdir(dir);
+}
+
+int64_t SlowGet(void* arg) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  return static_cast<std::atomic<int64_t>*>(arg)->load();
+}
+
+TEST_F(FileDumperTest, Deadline) {
+  char dir[] = "/tmp/tvar_file_dumper_test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  const std::string path = std::string(dir) + "/tvar.data";
+
+  // Each round describes one variable, the others keep their last lines.
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_max_ms", "1").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_file",
+                                            path.c_str()).empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_include",
+                                            "file_dumper_test_*").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_prefix", "").empty());
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump_interval",
+                                            "1").empty());
+  std::atomic<int64_t> values[3];
+  for (auto& v : values) {
+    v = 0;
+  }
+  PassiveStatus<int64_t> a("file_dumper_test_a", SlowGet, &values[0]);
+  PassiveStatus<int64_t> b("file_dumper_test_b", SlowGet, &values[1]);
+  PassiveStatus<int64_t> c("file_dumper_test_c", SlowGet, &values[2]);
+  ASSERT_FALSE(google::SetCommandLineOption("tvar_dump", "true").empty());
+
+  const std::string all_zero = "file_dumper_test_a : 0\r\n"
+                               "file_dumper_test_b : 0\r\n"
+                               "file_dumper_test_c : 0\r\n";
+  std::string content;
+  for (int i = 0; i < 5 && content != all_zero; ++i) {
+    content = WaitForChange(path, content);
+  }
+  ASSERT_EQ(all_zero, content);
+
+  for (auto& v : values) {
+    v = 1;
+  }
+  content = WaitForChange(path, content);
+  // Complete, with one value updated.
+  int updated = 0;
+  for (const char* name : {"a", "b", "c"}) {
+    const std::string prefix = std::string("file_dumper_test_") + name;
+    if (content.find(prefix + " : 1\r\n") != std::string::npos) {
+      ++updated;
+    } else {
+      ASSERT_NE(std::string::npos, content.find(prefix + " : 0\r\n"))
+          << content;
+    }
+  }
+  ASSERT_EQ(1, updated) << content;
+
+  google::SetCommandLineOption("tvar_dump", "false");
+  google::SetCommandLineOption("tvar_dump_max_ms", "1000");
+  unlink(path.c_str());
+  rmdir(dir);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include "log/logstream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::tutil;
+using namespace std;
+
+// Compare LogStream's shortest round-trip formatter with snprintf on
+// values which look like metrics: latencies, ratios and large counters.
+int main(int argc, const char *argv[])
+{
+  size_t jobs = 10000000;
+  if (argc > 1) {
+    jobs = atoi(argv[1]);
+    if (jobs < 100000) {
+      jobs = 100000;
+    }
+  }
+
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> latency(0.0, 2000.0);
+  std::uniform_real_distribution<double> ratio(0.0, 1.0);
+  std::vector<double> values(4096);
+  for (size_t i = 0; i < values.size(); ++i) {
+    switch (i % 3) {
+      case 0: values[i] = latency(rng); break;
+      case 1: values[i] = ratio(rng); break;
+      default: values[i] = static_cast<double>(rng() >> 11) * 1e3; break;
+    }
+  }
+  const size_t mask = values.size() - 1;
+
+  Timer timer;
+  char buf[64];
+  size_t total = 0;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += snprintf(buf, sizeof(buf), "%.12g", values[i & mask]);
+  }
+  timer.stop();
+  cout << "snprintf(%.12g): " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += snprintf(buf, sizeof(buf), "%.17g", values[i & mask]);
+  }
+  timer.stop();
+  cout << "snprintf(%.17g): " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += tesla::log::FormatDouble(buf, values[i & mask]);
+  }
+  timer.stop();
+  cout << "FormatDouble:    " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += tesla::log::FormatFloat(buf, static_cast<float>(values[i & mask]));
+  }
+  timer.stop();
+  cout << "FormatFloat:     " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  // Keep `total' alive so that loops are not optimized out.
+  return total == 0;
+}
@@ -0,0 +1,92 @@
+#include "tutil/strings/integer_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::tutil;
+using namespace std;
+
+// The digit-at-a-time conversion LogStream used before.
+size_t LegacyConvert(char* buf, int64_t value) {
+  static const char digits[] = "9876543210123456789";
+  static const char* zero = digits + 9;
+  int64_t i = value;
+  char* p = buf;
+  do {
+    int lsd = static_cast<int>(i % 10);
+    i /= 10;
+    *p++ = zero[lsd];
+  } while (i != 0);
+  if (value < 0) {
+    *p++ = '-';
+  }
+  *p = 0;
+  std::reverse(buf, p);
+  return p - buf;
+}
+
+int main(int argc, const char *argv[])
+{
+  size_t jobs = 20000000;
+  if (argc > 1) {
+    jobs = atoi(argv[1]);
+    if (jobs < 100000) {
+      jobs = 100000;
+    }
+  }
+
+  // Small ids, latencies in us and large byte counters.
+  std::mt19937_64 rng(12345);
+  std::vector<int64_t> values(4096);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int64_t>(rng() >> (rng() % 63 + 1));
+  }
+  const size_t mask = values.size() - 1;
+
+  Timer timer;
+  char buf[32];
+  size_t total = 0;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += snprintf(buf, sizeof(buf), "%lld",
+                      static_cast<long long>(values[i & mask]));
+  }
+  timer.stop();
+  cout << "snprintf:      " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += LegacyConvert(buf, values[i & mask]);
+  }
+  timer.stop();
+  cout << "legacy:        " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += tutil::FormatInt64(buf, values[i & mask]);
+  }
+  timer.stop();
+  cout << "FormatInt64:   " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    total += tutil::FormatHex(buf, values[i & mask]);
+  }
+  timer.stop();
+  cout << "FormatHex:     " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+
+  // Keep `total' alive so that loops are not optimized out.
+  return total == 0;
+}
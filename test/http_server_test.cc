@@ -0,0 +1,163 @@
+#include "tvar/http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <gtest/gtest.h>
+
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing HttpServer.
+class HttpServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(0, server_.Start(0));
+    ASSERT_GT(server_.port(), 0);
+  }
+
+  int Connect() {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server_.port());
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+                sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  static void Send(int fd, const std::string& data) {
+    ASSERT_EQ(static_cast<ssize_t>(data.size()),
+              write(fd, data.data(), data.size()));
+  }
+
+  // Read one response, returns its body and puts its status line into
+  // `status'.
+  static std::string ReadResponse(int fd, std::string* buffer,
+                                  std::string* status) {
+    char buf[4096];
+    size_t header_end;
+    while ((header_end = buffer->find("\r\n\r\n")) == std::string::npos) {
+      const ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) {
+        return std::string();
+      }
+      buffer->append(buf, n);
+    }
+    *status = buffer->substr(0, buffer->find("\r\n"));
+    const size_t pos = buffer->find("Content-Length: ");
+    const size_t length = strtoul(buffer->c_str() + pos + 16, nullptr, 10);
+    while (buffer->size() < header_end + 4 + length) {
+      const ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) {
+        return std::string();
+      }
+      buffer->append(buf, n);
+    }
+    std::string body = buffer->substr(header_end + 4, length);
+    buffer->erase(0, header_end + 4 + length);
+    return body;
+  }
+
+  HttpServer server_;
+}; // class HttpServerTest
+
+TEST_F(HttpServerTest, Vars) {
+  Adder<int64_t> foo;
+  Adder<int64_t> bar;
+  foo.expose("http_server_test_foo");
+  bar.expose("http_server_test_bar");
+  foo << 10;
+  bar << 20;
+
+  const int fd = Connect();
+  ASSERT_GE(fd, 0);
+  std::string buffer;
+  std::string status;
+  Send(fd, "GET /vars/http_server_test_* HTTP/1.1\r\nHost: x\r\n\r\n");
+  ASSERT_EQ("http_server_test_bar : 20\nhttp_server_test_foo : 10\n",
+            ReadResponse(fd, &buffer, &status));
+  ASSERT_EQ("HTTP/1.1 200 OK", status);
+
+  // Same connection, `$' matches one character.
+  Send(fd, "GET /vars?filter=http_server_test_f%24o HTTP/1.1\r\n\r\n");
+  ASSERT_EQ("http_server_test_foo : 10\n",
+            ReadResponse(fd, &buffer, &status));
+
+  Send(fd, "GET /metrics?filter=http_server_test_bar HTTP/1.1\r\n\r\n");
+  ASSERT_EQ("# TYPE http_server_test_bar gauge\nhttp_server_test_bar 20\n",
+            ReadResponse(fd, &buffer, &status));
+  close(fd);
+}
+
+TEST_F(HttpServerTest, Pipelined) {
+  Adder<int64_t> foo;
+  foo.expose("http_server_test_pipelined");
+  foo << 1;
+
+  const int fd = Connect();
+  ASSERT_GE(fd, 0);
+  Send(fd,
+       "GET /vars/http_server_test_pipelined HTTP/1.1\r\n\r\n"
+       "GET /not_found HTTP/1.1\r\n\r\n"
+       "POST /vars HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+       "GET /vars/http_server_test_pipelined HTTP/1.1\r\n"
+       "Connection: close\r\n\r\n");
+  std::string buffer;
+  std::string status;
+  ASSERT_EQ("http_server_test_pipelined : 1\n",
+            ReadResponse(fd, &buffer, &status));
+  ReadResponse(fd, &buffer, &status);
+  ASSERT_EQ("HTTP/1.1 404 Not Found", status);
+  ReadResponse(fd, &buffer, &status);
+  ASSERT_EQ("HTTP/1.1 405 Method Not Allowed", status);
+  ASSERT_EQ("http_server_test_pipelined : 1\n",
+            ReadResponse(fd, &buffer, &status));
+  // The server closes the connection.
+  char c;
+  ASSERT_EQ(0, read(fd, &c, 1));
+  close(fd);
+}
+
+TEST_F(HttpServerTest, Http10ClosesConnection) {
+  const int fd = Connect();
+  ASSERT_GE(fd, 0);
+  Send(fd, "GET /vars/no_such_variable HTTP/1.0\r\n\r\n");
+  std::string buffer;
+  std::string status;
+  ASSERT_EQ("", ReadResponse(fd, &buffer, &status));
+  ASSERT_EQ("HTTP/1.1 200 OK", status);
+  char c;
+  ASSERT_EQ(0, read(fd, &c, 1));
+  close(fd);
+}
+
+TEST_F(HttpServerTest, Restart) {
+  server_.Stop();
+  ASSERT_EQ(-1, server_.port());
+  ASSERT_EQ(0, server_.Start(0));
+  const int fd = Connect();
+  ASSERT_GE(fd, 0);
+  close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
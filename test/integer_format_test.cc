@@ -0,0 +1,83 @@
+#include "tutil/strings/integer_format.h"
+
+#include <stdio.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace tutil;
+
+namespace {
+
+template <typename T>
+std::string Format(T v) {
+  char buf[24];
+  return std::string(buf, FormatInteger(buf, v));
+}
+
+std::string Hex(uint64_t v) {
+  char buf[16];
+  return std::string(buf, FormatHex(buf, v));
+}
+
+// The fixture for testing integer formatting.
+class IntegerFormatTest : public ::testing::Test {
+}; // class IntegerFormatTest
+
+TEST_F(IntegerFormatTest, Limits) {
+  ASSERT_EQ(Format(0), "0");
+  ASSERT_EQ(Format(-1), "-1");
+  ASSERT_EQ(Format(static_cast<short>(-32768)), "-32768");
+  ASSERT_EQ(Format(std::numeric_limits<int32_t>::min()), "-2147483648");
+  ASSERT_EQ(Format(std::numeric_limits<int32_t>::max()), "2147483647");
+  ASSERT_EQ(Format(std::numeric_limits<uint32_t>::max()), "4294967295");
+  ASSERT_EQ(Format(std::numeric_limits<int64_t>::min()),
+            "-9223372036854775808");
+  ASSERT_EQ(Format(std::numeric_limits<uint64_t>::max()),
+            "18446744073709551615");
+  ASSERT_EQ(Hex(0), "0");
+  ASSERT_EQ(Hex(0xabcdef), "ABCDEF");
+  ASSERT_EQ(Hex(std::numeric_limits<uint64_t>::max()), "FFFFFFFFFFFFFFFF");
+}
+
+TEST_F(IntegerFormatTest, PowersOfTen) {
+  uint64_t p = 1;
+  for (int i = 1; i <= 20; ++i) {
+    ASSERT_EQ(CountDecimalDigits(p), i);
+    ASSERT_EQ(Format(p), "1" + std::string(i - 1, '0'));
+    ASSERT_EQ(CountDecimalDigits(p - 1), i == 1 ? 1 : i - 1);
+    if (i < 20) {
+      p *= 10;
+    }
+  }
+}
+
+TEST_F(IntegerFormatTest, Random) {
+  std::mt19937_64 rng(42);
+  char expected[32];
+  for (int i = 0; i < 100000; ++i) {
+    // Shift to get every length, not only 19 and 20 digits.
+    const int64_t v = static_cast<int64_t>(rng()) >> (rng() % 64);
+    snprintf(expected, sizeof(expected), "%lld", static_cast<long long>(v));
+    ASSERT_EQ(Format(v), expected);
+    const uint64_t u = static_cast<uint64_t>(v);
+    snprintf(expected, sizeof(expected), "%llu",
+             static_cast<unsigned long long>(u));
+    ASSERT_EQ(Format(u), expected);
+    snprintf(expected, sizeof(expected), "%llX",
+             static_cast<unsigned long long>(u));
+    ASSERT_EQ(Hex(u), expected);
+    snprintf(expected, sizeof(expected), "%d", static_cast<int32_t>(v));
+    ASSERT_EQ(Format(static_cast<int32_t>(v)), expected);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
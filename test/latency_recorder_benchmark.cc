@@ -0,0 +1,68 @@
+#include "tvar/latency_recorder.h"
+#include "tvar/recorder.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+// Average cost of one operator<< with `nthreads' threads recording into
+// the same variable.
+template <typename Var>
+double Run(Var* var, int nthreads, size_t jobs) {
+  std::vector<double> costs(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([var, jobs, t, &costs] {
+      tesla::tutil::Timer timer;
+      timer.start();
+      for (size_t i = 0; i < jobs; ++i) {
+        // Latencies between 0 and ~16ms.
+        *var << static_cast<int64_t>((i * 2654435761u) & 0x3fff);
+      }
+      timer.stop();
+      costs[t] = timer.n_elapsed() / static_cast<double>(jobs);
+    }));
+  }
+  double total = 0;
+  for (int t = 0; t < nthreads; ++t) {
+    threads[t].join();
+    total += costs[t];
+  }
+  return total / nthreads;
+}
+
+int main(int argc, const char *argv[])
+{
+  size_t jobs = 10000000;
+  if (argc > 1) {
+    jobs = atoi(argv[1]);
+    if (jobs < 100000) {
+      jobs = 100000;
+    }
+  }
+
+  LatencyRecorder recorder("latency_recorder_benchmark");
+  IntRecorder int_recorder;
+  Maxer<int64_t> maxer;
+  detail::Percentile percentile;
+
+  for (int nthreads = 1; nthreads <= 8; nthreads *= 2) {
+    cout << "threads=" << nthreads
+         << " IntRecorder=" << Run(&int_recorder, nthreads, jobs) << "ns"
+         << " Maxer=" << Run(&maxer, nthreads, jobs) << "ns"
+         << " Percentile=" << Run(&percentile, nthreads, jobs) << "ns"
+         << " LatencyRecorder=" << Run(&recorder, nthreads, jobs) << "ns"
+         << endl;
+  }
+  cout << "count=" << recorder.count()
+       << " p50=" << recorder.latency_percentile(0.5)
+       << " p99=" << recorder.latency_percentile(0.99) << endl;
+  return 0;
+}
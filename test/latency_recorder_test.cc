@@ -0,0 +1,135 @@
+#include "tvar/latency_recorder.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing Percentile and LatencyRecorder.
+class LatencyRecorderTest : public ::testing::Test {
+}; // class LatencyRecorderTest
+
+TEST_F(LatencyRecorderTest, Buckets) {
+  ASSERT_EQ(detail::GetBucketIndex(0), 0u);
+  ASSERT_EQ(detail::GetBucketIndex(31), 31u);
+  ASSERT_EQ(detail::GetBucketIndex(63), 63u);
+  ASSERT_EQ(detail::GetBucketIndex(64), 64u);
+  ASSERT_EQ(detail::GetBucketIndex(65), 64u);
+  ASSERT_EQ(detail::GetBucketIndex(UINT32_MAX),
+            detail::kPercentileBucketCount - 1);
+  // Buckets are continuous and every value is inside its bucket.
+  uint32_t next = 0;
+  for (size_t i = 0; i < detail::kPercentileBucketCount; ++i) {
+    ASSERT_EQ(detail::GetBucketLowerBound(i), next) << i;
+    next = detail::GetBucketLowerBound(i) + detail::GetBucketWidth(i);
+  }
+  ASSERT_EQ(next, 0u);  // wrapped around after UINT32_MAX
+  std::mt19937 rng(1);
+  for (int i = 0; i < 100000; ++i) {
+    const uint32_t v = rng() >> (rng() % 32);
+    const size_t index = detail::GetBucketIndex(v);
+    ASSERT_LE(detail::GetBucketLowerBound(index), v);
+    ASSERT_LE(v - detail::GetBucketLowerBound(index),
+              detail::GetBucketWidth(index) - 1);
+  }
+}
+
+TEST_F(LatencyRecorderTest, Percentile) {
+  detail::PercentileHistogram empty;
+  ASSERT_EQ(empty.GetNumber(0.5), 0u);
+
+  detail::Percentile percentile;
+  std::vector<std::thread> threads;
+  // 1 ~ 10000 from four threads.
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&percentile, t] {
+      for (int i = t + 1; i <= 10000; i += 4) {
+        percentile << i;
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // The threads have exited, their values are kept.
+  const detail::PercentileHistogram h = percentile.GetValue();
+  ASSERT_EQ(h.num(), 10000u);
+  ASSERT_EQ(h.sum(), 10000u * 10001 / 2);
+  ASSERT_EQ(percentile.GetNum(), 10000u);
+  ASSERT_NEAR(h.GetNumber(0.5), 5000, 5000 / 64);
+  ASSERT_NEAR(h.GetNumber(0.99), 9900, 9900 / 64);
+  ASSERT_NEAR(h.GetNumber(0.999), 9990, 9990 / 64);
+  ASSERT_NEAR(h.GetNumber(1), 10000, 10000 / 64);
+  ASSERT_EQ(h.GetNumber(0), 1u);
+
+  percentile << -1 << (1LL << 40);
+  const detail::PercentileHistogram h2 = percentile.GetValue();
+  ASSERT_EQ(h2.count(0), 1u);
+  ASSERT_EQ(h2.count(detail::kPercentileBucketCount - 1), 1u);
+}
+
+TEST_F(LatencyRecorderTest, Window) {
+  LatencyRecorder recorder("latency_recorder_test", 2);
+  ASSERT_EQ(recorder.window_size(), 2);
+  for (int i = 1; i <= 100; ++i) {
+    recorder << i * 10;
+  }
+  ASSERT_EQ(recorder.count(), 100);
+  ASSERT_EQ(recorder.sum(), 50500);
+  // Nothing is in the window before the next sample.
+  ASSERT_EQ(recorder.latency(), 0);
+  ASSERT_EQ(recorder.latency_percentile(0.5), 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  ASSERT_EQ(recorder.latency(), 505);
+  ASSERT_EQ(recorder.max_latency(), 1000);
+  ASSERT_NEAR(recorder.latency_percentile(0.5), 500, 500 / 64);
+  ASSERT_NEAR(recorder.latency_percentile(0.99), 990, 990 / 64);
+  ASSERT_GE(recorder.qps(), 50);
+  ASSERT_LE(recorder.qps(), 100);
+
+  ASSERT_EQ(Variable::describe_exposed("latency_recorder_test_latency"),
+            "505");
+  ASSERT_EQ(Variable::describe_exposed("latency_recorder_test_max_latency"),
+            "1000");
+  ASSERT_EQ(Variable::describe_exposed("latency_recorder_test_count"), "100");
+  ASSERT_EQ(Variable::describe_exposed("latency_recorder_test_sum"), "50500");
+  ASSERT_FALSE(
+      Variable::describe_exposed("latency_recorder_test_latency_99").empty());
+  ASSERT_FALSE(Variable::describe_exposed("latency_recorder_test_qps").empty());
+
+  Summary summary;
+  recorder.get_summary(&summary);
+  ASSERT_EQ(summary.quantile_count, 4);
+  ASSERT_DOUBLE_EQ(summary.ratios[0], 0.5);
+  ASSERT_EQ(summary.values[0], recorder.latency_percentile(0.5));
+  ASSERT_DOUBLE_EQ(summary.ratios[3], 0.999);
+  ASSERT_EQ(summary.sum, 50500);
+  ASSERT_EQ(summary.count, 100);
+
+  // Totals never go down when the window moves on.
+  recorder << 10;
+  recorder.get_summary(&summary);
+  ASSERT_EQ(summary.sum, 50510);
+  ASSERT_EQ(summary.count, 101);
+
+  recorder.hide();
+  ASSERT_TRUE(
+      Variable::describe_exposed("latency_recorder_test_latency").empty());
+  ASSERT_EQ(recorder.expose("foo", "Bar"), 0);
+  ASSERT_EQ(Variable::describe_exposed("foo_bar_count"), "101");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
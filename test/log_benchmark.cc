@@ -0,0 +1,166 @@
+#include "log/logging.h"
+#include "log/logencoder.h"
+#include "log/asynclogging.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::log;
+using namespace tesla::tutil;
+using namespace std;
+
+// Measure LOG_INFO across backends and thread counts:
+//   - latency of every call in the logging thread (p50/p99/p999/max),
+//   - aggregate throughput,
+//   - for AsyncLogging, dropped bytes and the lag between the last call
+//     and the backend having written everything.
+//
+// Usage: log_benchmark [mode] [threads] [messages per thread] [log basename]
+//   mode: null | stdout | async | logfmt | json | all (default)
+// Reports go to stderr, run `log_benchmark stdout > /dev/null' to keep the
+// terminal out of the measurement.
+
+namespace {
+
+AsyncLogging* g_async = NULL;
+
+void NullOutput(const char* message, int len) {
+}
+
+void StdoutOutput(const char* message, int len) {
+  fwrite(message, len, 1, stdout);
+}
+
+void AsyncOutput(const char* message, int len) {
+  g_async->Append(message, len);
+}
+
+void Produce(size_t messages, std::atomic<bool>* go,
+             std::vector<uint32_t>* latencies) {
+  latencies->resize(messages);
+  while (!go->load(std::memory_order_acquire)) {
+  }
+  for (size_t i = 0; i < messages; ++i) {
+    const int64_t begin = clock_ns();
+    LOG_INFO.kv("seq", i).kv("lat_us", 12.5).kv("peer", "10.0.0.1:8000")
+        << "benchmark message " << i;
+    (*latencies)[i] = static_cast<uint32_t>(clock_ns() - begin);
+  }
+}
+
+void Run(const std::string& mode, int threads, size_t messages,
+         const std::string& basename) {
+  static LogfmtEncoder logfmt;
+  static JsonEncoder json;
+  std::unique_ptr<AsyncLogging> async;
+
+  Logger::set_encoder(NULL);
+  if (mode == "null") {
+    Logger::set_output(NullOutput);
+  } else if (mode == "stdout") {
+    Logger::set_output(StdoutOutput);
+  } else if (mode == "async") {
+    async.reset(new AsyncLogging(basename, 1024 * 1024 * 1024, 1));
+    async->Start();
+    g_async = async.get();
+    Logger::set_output(AsyncOutput);
+  } else if (mode == "logfmt") {
+    Logger::set_encoder(&logfmt);
+    Logger::set_output(NullOutput);
+  } else if (mode == "json") {
+    Logger::set_encoder(&json);
+    Logger::set_output(NullOutput);
+  } else {
+    fprintf(stderr, "unknown mode `%s'\n", mode.c_str());
+    exit(1);
+  }
+
+  std::atomic<bool> go(false);
+  std::vector<std::vector<uint32_t>> latencies(threads);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.push_back(std::thread(Produce, messages, &go, &latencies[i]));
+  }
+  Timer timer;
+  timer.start();
+  go.store(true, std::memory_order_release);
+  for (auto& t : workers) {
+    t.join();
+  }
+  timer.stop();
+  fflush(stdout);
+
+  std::vector<uint32_t> all;
+  all.reserve(messages * threads);
+  for (auto& v : latencies) {
+    all.insert(all.end(), v.begin(), v.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&all](double p) {
+    return all[std::min(all.size() - 1, static_cast<size_t>(all.size() * p))];
+  };
+  const double seconds = timer.n_elapsed() / 1e9;
+
+  fprintf(stderr, "%-7s threads=%-3d msgs/s=%-10.0f p50=%uns p99=%uns "
+          "p999=%uns max=%uns",
+          mode.c_str(), threads, all.size() / seconds,
+          percentile(0.5), percentile(0.99), percentile(0.999), all.back());
+
+  if (async) {
+    // Wait until the backend catches up with the producers.
+    timer.start();
+    AsyncLogging::Stats stats = async->GetStats();
+    while (stats.written_bytes + stats.dropped_bytes < stats.appended_bytes) {
+      usleep(1000);
+      stats = async->GetStats();
+    }
+    timer.stop();
+    async->Stop();
+    fprintf(stderr, " lag=%ldms written=%luB dropped=%luB(%lu buffers)",
+            timer.m_elapsed(), stats.written_bytes, stats.dropped_bytes,
+            stats.dropped_buffers);
+    g_async = NULL;
+  }
+  fprintf(stderr, "\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string mode = argc > 1 ? argv[1] : "all";
+  const int threads = argc > 2 ? atoi(argv[2]) : 0;
+  const size_t messages = argc > 3 ? atoi(argv[3]) : 200000;
+  const std::string basename = argc > 4 ? argv[4] : "/tmp/log_benchmark";
+
+  std::vector<std::string> modes;
+  if (mode == "all") {
+    modes = {"null", "stdout", "async", "logfmt", "json"};
+  } else {
+    modes.push_back(mode);
+  }
+  std::vector<int> thread_counts;
+  if (threads > 0) {
+    thread_counts.push_back(threads);
+  } else {
+    thread_counts = {1, 2, 4, 8};
+  }
+
+  for (const auto& m : modes) {
+    for (int t : thread_counts) {
+      Run(m, t, messages, basename);
+    }
+  }
+  Logger::set_output(StdoutOutput);
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "log/logging.h"
+#include "log/logencoder.h"
+
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace tesla::log;
+
+namespace {
+
+std::string kOutput;
+
+void CaptureOutput(const char* message, int len) {
+  kOutput.assign(message, len);
+}
+
+// The fixture for testing LogEncoder.
+class LogEncoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    kOutput.clear();
+    Logger::set_output(CaptureOutput);
+  }
+
+  void TearDown() override {
+    Logger::set_encoder(NULL);
+  }
+}; // class LogEncoderTest
+
+TEST_F(LogEncoderTest, DefaultText) {
+  LOG_INFO.kv("user", 42).kv("ok", true).kv("name", std::string("tesla"))
+      << "request done";
+  ASSERT_NE(kOutput.find("INFO  request done user=42 ok=true name=tesla - "),
+            std::string::npos) << kOutput;
+  ASSERT_EQ(kOutput.back(), '\n');
+}
+
+TEST_F(LogEncoderTest, Logfmt) {
+  static LogfmtEncoder encoder;
+  Logger::set_encoder(&encoder);
+
+  const char* path = "/tmp/a b";
+  LOG_INFO.kv("path", path).kv("lat_us", 1.5).kv("n", -3) << "hello";
+  ASSERT_EQ(kOutput.find("time=\""), 0u) << kOutput;
+  ASSERT_NE(kOutput.find(" level=INFO msg=hello path=\"/tmp/a b\" lat_us=1.5"
+                         " n=-3 caller=log_encoder_test.cc:"),
+            std::string::npos) << kOutput;
+}
+
+TEST_F(LogEncoderTest, Json) {
+  static JsonEncoder encoder;
+  Logger::set_encoder(&encoder);
+
+  LOG_WARN.kv("quote", "a\"b\n").kv("count", 7u) << "x";
+  ASSERT_EQ(kOutput.find("{\"time\":\""), 0u) << kOutput;
+  ASSERT_NE(kOutput.find(",\"level\":\"WARN\",\"msg\":\"x\","
+                         "\"quote\":\"a\\\"b\\n\",\"count\":7,"
+                         "\"caller\":\"log_encoder_test.cc:"),
+            std::string::npos) << kOutput;
+  ASSERT_EQ(kOutput.substr(kOutput.size() - 3), "\"}\n");
+}
+
+TEST_F(LogEncoderTest, FuncAndTime) {
+  static LogfmtEncoder logfmt;
+  Logger::set_encoder(&logfmt);
+  Logger(__FILE__, __LINE__, Logger::INFO, "a b\"c").stream() << "m";
+  // "20191019 12:00:00.123456Z" quoted for the space.
+  ASSERT_EQ(kOutput.find("time=\""), 0u) << kOutput;
+  ASSERT_EQ(kOutput.substr(6 + 25, 6), "\" tid=") << kOutput;
+  ASSERT_NE(kOutput.find(" func=\"a b\\\"c\" msg=m"), std::string::npos)
+      << kOutput;
+
+  static JsonEncoder json;
+  Logger::set_encoder(&json);
+  Logger(__FILE__, __LINE__, Logger::INFO, "a\"b").stream() << "m";
+  ASSERT_NE(kOutput.find(",\"level\":\"INFO\",\"func\":\"a\\\"b\","
+                         "\"msg\":\"m\""),
+            std::string::npos) << kOutput;
+}
+
+TEST_F(LogEncoderTest, TooManyFields) {
+  // Fields are allocated by the first kv() only.
+  ASSERT_LT(sizeof(LogStream), LogStream::kSizeOfLogBuffer + 64u);
+
+  const int max_fields = LogStream::kMaxFields;
+  LogStream stream;
+  for (int i = 0; i < max_fields + 4; ++i) {
+    stream.kv("k", i);
+  }
+  ASSERT_EQ(stream.fieldCount(), max_fields);
+
+  std::string big(LogStream::kSizeOfFieldData + 1, 'x');
+  stream.resetBuffer();
+  stream.kv("big", big).kv("small", "y");
+  ASSERT_EQ(stream.fieldCount(), 1);
+  ASSERT_EQ(stream.field(0).value.s.length, 1);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
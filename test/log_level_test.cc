@@ -0,0 +1,106 @@
+// Statements below INFO must be removed at compile time, whatever the
+// run-time log level is.
+#define TESLA_LOG_MIN_LEVEL 2
+
+#include "log/logging.h"
+
+#include <stdio.h>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace tesla::log;
+
+namespace {
+
+std::string kOutput;
+int kEvaluated = 0;
+
+void CaptureOutput(const char* message, int len) {
+  kOutput.append(message, len);
+}
+
+// Death tests only see what the child writes to stderr.
+void StderrOutput(const char* message, int len) {
+  fwrite(message, 1, len, stderr);
+}
+
+int Touch() {
+  return ++kEvaluated;
+}
+
+// The fixture for testing the logging macros.
+class LogLevelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    kOutput.clear();
+    kEvaluated = 0;
+    Logger::set_output(CaptureOutput);
+    Logger::set_loglevel(Logger::TRACE);
+  }
+
+  void TearDown() override {
+    Logger::set_loglevel(Logger::INFO);
+  }
+}; // class LogLevelTest
+
+TEST_F(LogLevelTest, CompiledOut) {
+  LOG_TRACE << Touch();
+  LOG_DEBUG << Touch();
+  ASSERT_EQ(kEvaluated, 0);
+  ASSERT_TRUE(kOutput.empty());
+
+  LOG_INFO << Touch();
+  ASSERT_EQ(kEvaluated, 1);
+  ASSERT_NE(kOutput.find("INFO  1 - "), std::string::npos) << kOutput;
+}
+
+TEST_F(LogLevelTest, RuntimeLevel) {
+  Logger::set_loglevel(Logger::WARN);
+  LOG_INFO << Touch();
+  ASSERT_EQ(kEvaluated, 0);
+  ASSERT_TRUE(kOutput.empty());
+}
+
+TEST_F(LogLevelTest, LogIf) {
+  TESLA_LOG_IF(INFO, false) << Touch();
+  ASSERT_EQ(kEvaluated, 0);
+  TESLA_LOG_IF(DEBUG, true) << Touch();
+  ASSERT_EQ(kEvaluated, 0);
+  TESLA_LOG_IF(WARN, true) << Touch();
+  ASSERT_EQ(kEvaluated, 1);
+  ASSERT_NE(kOutput.find("WARN  1 - "), std::string::npos) << kOutput;
+}
+
+TEST_F(LogLevelTest, Check) {
+  TESLA_CHECK(true) << Touch();
+  TESLA_CHECK_EQ(1, 1);
+  ASSERT_EQ(kEvaluated, 0);
+  ASSERT_DEATH({
+    Logger::set_output(StderrOutput);
+    TESLA_CHECK_LT(2, 1) << "context";
+  }, "Check failed: .*context");
+}
+
+TEST_F(LogLevelTest, DCheck) {
+  // Assigned only if the condition is evaluated.
+  bool evaluated = false;
+  TESLA_DCHECK((evaluated = true));
+#ifdef NDEBUG
+  ASSERT_FALSE(evaluated);
+#else
+  ASSERT_TRUE(evaluated);
+  ASSERT_DEATH({
+    Logger::set_output(StderrOutput);
+    TESLA_DCHECK(false);
+  }, "Check failed: false");
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include "log/logstream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace tesla::log;
+
+namespace {
+
+std::string Format(double v) {
+  char buf[32];
+  return std::string(buf, FormatDouble(buf, v));
+}
+
+std::string Format(float v) {
+  char buf[32];
+  return std::string(buf, FormatFloat(buf, v));
+}
+
+// The fixture for testing LogStream.
+class LogStreamTest : public ::testing::Test {
+}; // class LogStreamTest
+
+TEST_F(LogStreamTest, FormatDouble) {
+  ASSERT_EQ(Format(0.0), "0");
+  ASSERT_EQ(Format(-0.0), "-0");
+  ASSERT_EQ(Format(0.1), "0.1");
+  ASSERT_EQ(Format(0.1 + 0.2), "0.30000000000000004");
+  ASSERT_EQ(Format(-2.5), "-2.5");
+  ASSERT_EQ(Format(100.0), "100");
+  ASSERT_EQ(Format(123456.789), "123456.789");
+  ASSERT_EQ(Format(0.0001), "0.0001");
+  ASSERT_EQ(Format(1e-5), "1e-05");
+  ASSERT_EQ(Format(1e16), "10000000000000000");
+  ASSERT_EQ(Format(1e17), "1e+17");
+  ASSERT_EQ(Format(1.5e300), "1.5e+300");
+  ASSERT_EQ(Format(5e-324), "5e-324");
+  ASSERT_EQ(Format(std::numeric_limits<double>::max()),
+            "1.7976931348623157e+308");
+  ASSERT_EQ(Format(std::numeric_limits<double>::infinity()), "inf");
+  ASSERT_EQ(Format(-std::numeric_limits<double>::infinity()), "-inf");
+  ASSERT_EQ(Format(std::numeric_limits<double>::quiet_NaN()), "nan");
+}
+
+TEST_F(LogStreamTest, FormatFloat) {
+  ASSERT_EQ(Format(0.1f), "0.1");
+  ASSERT_EQ(Format(1.5f), "1.5");
+  ASSERT_EQ(Format(16777216.0f), "16777216");
+  ASSERT_EQ(Format(std::numeric_limits<float>::max()), "3.4028235e+38");
+  ASSERT_EQ(Format(std::numeric_limits<float>::denorm_min()), "1e-45");
+}
+
+TEST_F(LogStreamTest, RoundTrip) {
+  std::mt19937_64 rng(20190101);
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t bits = rng();
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    if (!std::isfinite(v)) {
+      continue;
+    }
+    const std::string s = Format(v);
+    const double r = strtod(s.c_str(), NULL);
+    ASSERT_EQ(memcmp(&r, &v, sizeof(v)), 0) << s;
+
+    const uint32_t fbits = static_cast<uint32_t>(bits);
+    float f;
+    memcpy(&f, &fbits, sizeof(f));
+    if (!std::isfinite(f)) {
+      continue;
+    }
+    const std::string fs = Format(f);
+    const float fr = strtof(fs.c_str(), NULL);
+    ASSERT_EQ(memcmp(&fr, &f, sizeof(f)), 0) << fs;
+  }
+}
+
+TEST_F(LogStreamTest, Stream) {
+  LogStream os;
+  os << 0.25 << ' ' << 0.1f << ' ' << 1e100;
+  ASSERT_STREQ(os.buffer().data(), "0.25 0.1 1e+100");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
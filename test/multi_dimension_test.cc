@@ -0,0 +1,121 @@
+#include "tvar/multi_dimension.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "tvar/prometheus_dumper.h"
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+class StringDumper : public Dumper {
+ public:
+  bool dump(const std::string& name,
+            const ::tutil::StringView& description) override {
+    out.append(name);
+    out.append(" : ");
+    out.append(description.data(), description.size());
+    out.push_back('\n');
+    return true;
+  }
+
+  std::string out;
+};
+
+// The fixture for testing MultiDimension.
+class MultiDimensionTest : public ::testing::Test {
+}; // class MultiDimensionTest
+
+TEST_F(MultiDimensionTest, GetStats) {
+  MultiDimension<Adder<int64_t>> family({"method", "peer"});
+  ASSERT_EQ(0u, family.count_stats());
+  Adder<int64_t>* get = family.get_stats({"Get", "a"});
+  ASSERT_TRUE(get != nullptr);
+  ASSERT_EQ(get, family.get_stats({"Get", "a"}));
+  Adder<int64_t>* set = family.get_stats({"Set", "a"});
+  ASSERT_TRUE(set != nullptr);
+  ASSERT_NE(get, set);
+  ASSERT_EQ(2u, family.count_stats());
+  ASSERT_TRUE(family.has_stats({"Get", "a"}));
+  ASSERT_FALSE(family.has_stats({"Get", "b"}));
+
+  // Wrong number of label values.
+  ASSERT_TRUE(family.get_stats({"Get"}) == nullptr);
+
+  family.delete_stats({"Get", "a"});
+  ASSERT_FALSE(family.has_stats({"Get", "a"}));
+  ASSERT_EQ(1u, family.count_stats());
+  family.clear_stats();
+  ASSERT_EQ(0u, family.count_stats());
+}
+
+TEST_F(MultiDimensionTest, MaxStats) {
+  MultiDimension<Adder<int64_t>> family({"id"}, 2);
+  ASSERT_TRUE(family.get_stats({"1"}) != nullptr);
+  ASSERT_TRUE(family.get_stats({"2"}) != nullptr);
+  ASSERT_TRUE(family.get_stats({"3"}) == nullptr);
+  // Existing ones are still found.
+  ASSERT_TRUE(family.get_stats({"1"}) != nullptr);
+  family.delete_stats({"1"});
+  ASSERT_TRUE(family.get_stats({"3"}) != nullptr);
+}
+
+TEST_F(MultiDimensionTest, Dump) {
+  MultiDimension<Adder<int64_t>> family("multi_dimension_test_count",
+                                        {"method", "peer"});
+  *family.get_stats({"Set", "b"}) << 2;
+  *family.get_stats({"Get", "a\"1"}) << 1;
+  ASSERT_EQ("{method=\"Get\",peer=\"a\\\"1\"} : 1, "
+            "{method=\"Set\",peer=\"b\"} : 2",
+            family.get_description());
+
+  DumpOptions options;
+  options.white_wildcards = "multi_dimension_test_*";
+  StringDumper dumper;
+  ASSERT_EQ(2, Variable::dump_exposed(dumper, &options));
+  ASSERT_EQ("multi_dimension_test_count{method=\"Get\",peer=\"a\\\"1\"} : 1\n"
+            "multi_dimension_test_count{method=\"Set\",peer=\"b\"} : 2\n",
+            dumper.out);
+
+  std::string out;
+  PrometheusDumper prometheus(&out);
+  ASSERT_EQ(2, Variable::dump_exposed(prometheus, &options));
+  ASSERT_EQ("# TYPE multi_dimension_test_count gauge\n"
+            "multi_dimension_test_count{method=\"Get\",peer=\"a\\\"1\"} 1\n"
+            "multi_dimension_test_count{method=\"Set\",peer=\"b\"} 2\n",
+            out);
+}
+
+TEST_F(MultiDimensionTest, Concurrent) {
+  MultiDimension<Adder<int64_t>> family({"id"});
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&family] {
+      for (int j = 0; j < 10000; ++j) {
+        *family.get_stats({std::to_string(j % 16)}) << 1;
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(16u, family.count_stats());
+  int64_t total = 0;
+  for (int i = 0; i < 16; ++i) {
+    total += family.get_stats({std::to_string(i)})->GetValue();
+  }
+  ASSERT_EQ(40000, total);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
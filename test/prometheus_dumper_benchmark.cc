@@ -0,0 +1,104 @@
+#include "tvar/prometheus_dumper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tutil/time.h"
+#include "tvar/latency_recorder.h"
+#include "tvar/reducer.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+// Cost of one scrape of `nvars' exposed Adders and 100 LatencyRecorders.
+int main(int argc, const char *argv[])
+{
+  int nvars = 50000;
+  int rounds = 20;
+  if (argc > 1) {
+    nvars = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    rounds = atoi(argv[2]);
+  }
+
+  std::vector<std::unique_ptr<Adder<int64_t>>> adders;
+  char name[64];
+  for (int i = 0; i < nvars; ++i) {
+    adders.emplace_back(new Adder<int64_t>);
+    snprintf(name, sizeof(name), "benchmark_service_requests_%d", i);
+    adders.back()->expose(name);
+    *adders.back() << i;
+  }
+  std::vector<std::unique_ptr<LatencyRecorder>> recorders;
+  for (int i = 0; i < 100; ++i) {
+    snprintf(name, sizeof(name), "benchmark_rpc_%d", i);
+    recorders.emplace_back(new LatencyRecorder(name));
+    *recorders.back() << i;
+  }
+
+  std::string out;
+  tesla::tutil::Timer timer;
+  // The first scrape fills the cache of rendered lines.
+  timer.start();
+  dump_prometheus_metrics(&out);
+  timer.stop();
+  cout << "first scrape:        " << timer.n_elapsed() / 1000.0
+       << "us, " << out.size() << " bytes" << endl;
+  timer.start();
+  for (int i = 0; i < rounds; ++i) {
+    out.clear();
+    dump_prometheus_metrics(&out);
+  }
+  timer.stop();
+  cout << "scrape:              " << timer.n_elapsed() / 1000.0 / rounds
+       << "us, " << out.size() << " bytes" << endl;
+  // Half of the values change between scrapes.
+  timer.start();
+  for (int i = 0; i < rounds; ++i) {
+    for (int j = i % 2; j < nvars; j += 2) {
+      *adders[j] << 1;
+    }
+    out.clear();
+    dump_prometheus_metrics(&out);
+  }
+  timer.stop();
+  cout << "scrape, half changed: " << timer.n_elapsed() / 1000.0 / rounds
+       << "us" << endl;
+
+  // Expose and hide a variable repeatedly while scraping.
+  std::atomic<bool> stop(false);
+  std::thread scraper([&stop] {
+    std::string buf;
+    while (!stop.load(std::memory_order_relaxed)) {
+      buf.clear();
+      dump_prometheus_metrics(&buf);
+    }
+  });
+  Adder<int64_t> reloaded;
+  const int reloads = 2000;
+  int64_t max_ns = 0;
+  tesla::tutil::Timer one;
+  timer.start();
+  for (int i = 0; i < reloads; ++i) {
+    one.start();
+    reloaded.expose("benchmark_reloaded");
+    reloaded.hide();
+    one.stop();
+    max_ns = std::max<int64_t>(max_ns, one.n_elapsed());
+  }
+  timer.stop();
+  stop.store(true);
+  scraper.join();
+  cout << "expose+hide, scraping: " << timer.n_elapsed() / reloads
+       << "ns avg, " << max_ns / 1000 << "us max" << endl;
+  return 0;
+}
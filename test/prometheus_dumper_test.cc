@@ -0,0 +1,172 @@
+#include "tvar/prometheus_dumper.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "tvar/latency_recorder.h"
+#include "tvar/passive_status.h"
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing PrometheusDumper.
+class PrometheusDumperTest : public ::testing::Test {
+}; // class PrometheusDumperTest
+
+TEST_F(PrometheusDumperTest, Gauge) {
+  std::string out;
+  PrometheusDumper dumper(&out);
+  ASSERT_TRUE(dumper.dump("foo", "42"));
+  ASSERT_TRUE(dumper.dump("bar", "1.5"));
+  ASSERT_TRUE(dumper.dump("inf_value", "-inf"));
+  // Skipped.
+  ASSERT_TRUE(dumper.dump("str", "\"hello\""));
+  ASSERT_TRUE(dumper.dump("empty", ""));
+  ASSERT_TRUE(dumper.dump("9lives", "1"));
+  ASSERT_EQ(out,
+            "# TYPE foo gauge\nfoo 42\n"
+            "# TYPE bar gauge\nbar 1.5\n"
+            "# TYPE inf_value gauge\ninf_value -Inf\n");
+}
+
+TEST_F(PrometheusDumperTest, Summary) {
+  std::string out;
+  PrometheusDumper dumper(&out);
+  Summary summary;
+  summary.quantile_count = 2;
+  summary.ratios[0] = 0.5;
+  summary.values[0] = 15;
+  summary.ratios[1] = 0.999;
+  summary.values[1] = 90;
+  summary.sum = 2345;
+  summary.count = 100;
+  ASSERT_TRUE(dumper.dump_summary("rpc_latency", "20", summary));
+  // Names are not guessed, these are gauges.
+  ASSERT_TRUE(dumper.dump("rpc_count", "100"));
+  ASSERT_TRUE(dumper.dump("rpc_latency_50", "15"));
+  ASSERT_TRUE(dumper.dump_summary("bad-name", "20", summary));
+  ASSERT_EQ(out,
+            "# TYPE rpc_latency summary\n"
+            "rpc_latency{quantile=\"0.5\"} 15\n"
+            "rpc_latency{quantile=\"0.999\"} 90\n"
+            "rpc_latency_sum 2345\n"
+            "rpc_latency_count 100\n"
+            "# TYPE rpc_count gauge\nrpc_count 100\n"
+            "# TYPE rpc_latency_50 gauge\nrpc_latency_50 15\n");
+}
+
+TEST_F(PrometheusDumperTest, Cache) {
+  PrometheusCache cache;
+  std::string out;
+  {
+    PrometheusDumper dumper(&out, &cache);
+    ASSERT_TRUE(dumper.dump("a", "1"));
+    ASSERT_TRUE(dumper.dump("b", "\"str\""));
+    ASSERT_TRUE(dumper.dump("c", "3"));
+    cache.Finish();
+  }
+  ASSERT_EQ(cache.size(), 3u);
+  ASSERT_EQ(out, "# TYPE a gauge\na 1\n# TYPE c gauge\nc 3\n");
+
+  // `b' is gone, `a1' is new and `c' changed.
+  out.clear();
+  {
+    PrometheusDumper dumper(&out, &cache);
+    ASSERT_TRUE(dumper.dump("a", "1"));
+    ASSERT_TRUE(dumper.dump("a1", "2"));
+    ASSERT_TRUE(dumper.dump("c", "4"));
+    ASSERT_TRUE(dumper.dump("m{k=\"v\"}", "5"));
+    cache.Finish();
+  }
+  ASSERT_EQ(cache.size(), 3u);
+  ASSERT_EQ(out,
+            "# TYPE a gauge\na 1\n"
+            "# TYPE a1 gauge\na1 2\n"
+            "# TYPE c gauge\nc 4\n"
+            "# TYPE m gauge\nm{k=\"v\"} 5\n");
+
+  // Cached lines are the same as the written ones.
+  std::string uncached;
+  PrometheusDumper dumper(&uncached);
+  out.clear();
+  PrometheusDumper cached(&out, &cache);
+  for (const char* name : {"a", "a1", "c"}) {
+    ASSERT_TRUE(dumper.dump(name, "4"));
+    ASSERT_TRUE(cached.dump(name, "4"));
+  }
+  cache.Finish();
+  ASSERT_EQ(out, uncached);
+}
+
+// Dumpers not knowing summaries get the description.
+class NameDumper : public Dumper {
+ public:
+  bool dump(const std::string& name,
+            const ::tutil::StringView& description) override {
+    out.append(name);
+    out.push_back('=');
+    out.append(description.data(), description.size());
+    out.push_back('\n');
+    return true;
+  }
+
+  std::string out;
+};
+
+int64_t GetAnswer(void*) { return 42; }
+
+TEST_F(PrometheusDumperTest, DumpExposed) {
+  Adder<int> adder;
+  adder.expose("prometheus_test_adder");
+  adder << 3;
+  PassiveStatus<int64_t> status("prometheus_test_status", GetAnswer, nullptr);
+  LatencyRecorder recorder("prometheus_test");
+  recorder << 10 << 20;
+  // Not a part of the recorder.
+  Adder<int> count;
+  count.expose("prometheus_test_request_count");
+
+  std::string out;
+  const int n = dump_prometheus_metrics(&out);
+  ASSERT_GE(n, 10);
+  ASSERT_NE(out.find("\nprometheus_test_adder 3\n"), std::string::npos) << out;
+  ASSERT_NE(out.find("\nprometheus_test_status 42\n"), std::string::npos);
+  ASSERT_NE(out.find("# TYPE prometheus_test_latency summary\n"),
+            std::string::npos) << out;
+  ASSERT_NE(out.find("\nprometheus_test_latency_sum 30\n"
+                     "prometheus_test_latency_count 2\n"),
+            std::string::npos) << out;
+  ASSERT_NE(out.find("\nprometheus_test_qps 0\n"), std::string::npos);
+  ASSERT_NE(out.find("# TYPE prometheus_test_count gauge\n"),
+            std::string::npos);
+  ASSERT_NE(out.find("# TYPE prometheus_test_request_count gauge\n"),
+            std::string::npos);
+  ASSERT_NE(out.find("\nprometheus_test_sum 30\n"), std::string::npos);
+
+  NameDumper plain;
+  DumpOptions plain_options;
+  plain_options.white_wildcards = "prometheus_test_latency";
+  ASSERT_EQ(Variable::dump_exposed(plain, &plain_options), 1);
+  ASSERT_EQ(plain.out, "prometheus_test_latency=0\n");
+
+  // The same as the sorted dump.
+  std::string sorted;
+  PrometheusDumper dumper(&sorted);
+  DumpOptions options;
+  options.quote_string = false;
+  ASSERT_EQ(Variable::dump_exposed(dumper, &options), n);
+  ASSERT_EQ(sorted.size(), out.size());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+#include "tvar/recorder.h"
+
+#include <limits>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "tvar/reducer.h"
+#include "tvar/window.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing Maxer, Miner and IntRecorder.
+class RecorderTest : public ::testing::Test {
+}; // class RecorderTest
+
+TEST_F(RecorderTest, MaxerMiner) {
+  Maxer<int> maxer;
+  Miner<int> miner;
+  ASSERT_EQ(maxer.GetValue(), std::numeric_limits<int>::lowest());
+  ASSERT_EQ(miner.GetValue(), std::numeric_limits<int>::max());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&maxer, &miner, t] {
+      for (int i = 0; i < 1000; ++i) {
+        maxer << t * 1000 + i;
+        miner << t * 1000 + i;
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(maxer.GetValue(), 3999);
+  ASSERT_EQ(miner.GetValue(), 0);
+  ASSERT_EQ(maxer.Reset(), 3999);
+  ASSERT_EQ(maxer.GetValue(), std::numeric_limits<int>::lowest());
+
+  Maxer<double> dmax;
+  dmax << -3.5 << -1.5;
+  ASSERT_EQ(dmax.GetValue(), -1.5);
+}
+
+TEST_F(RecorderTest, Compress) {
+  for (int64_t sum : {int64_t(0), int64_t(1), int64_t(-1),
+                      detail::kMaxSumPerThread,
+                      detail::kMinSumPerThread}) {
+    const uint64_t n = detail::CompressStat(12345, sum);
+    ASSERT_EQ(detail::GetSum(n), sum);
+    ASSERT_EQ(detail::GetNum(n), 12345u);
+  }
+}
+
+TEST_F(RecorderTest, Average) {
+  IntRecorder recorder;
+  ASSERT_EQ(recorder.Average(), 0);
+  recorder << 10 << 20 << 30 << -2;
+  ASSERT_EQ(recorder.GetValue().sum, 58);
+  ASSERT_EQ(recorder.GetValue().num, 4);
+  ASSERT_EQ(recorder.Average(), 14);
+  ASSERT_DOUBLE_EQ(recorder.AverageDouble(), 14.5);
+  ASSERT_EQ(recorder.get_description(), "14");
+
+  // Out of the range of int32_t.
+  recorder.Reset();
+  recorder << (1LL << 40);
+  ASSERT_EQ(recorder.Average(), std::numeric_limits<int32_t>::max());
+}
+
+TEST_F(RecorderTest, Overflow) {
+  IntRecorder recorder;
+  // The sum of one thread overflows 44 bits after 4096 of these.
+  const int64_t big = std::numeric_limits<int32_t>::max();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; ++t) {
+    threads.push_back(std::thread([&recorder, big] {
+      for (int i = 0; i < 10000; ++i) {
+        recorder << big;
+      }
+      // More values than the 20 bits of count.
+      for (int i = 0; i < (1 << 20) + 10; ++i) {
+        recorder << 1;
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const Stat s = recorder.GetValue();
+  ASSERT_EQ(s.num, 2 * (10000 + (1 << 20) + 10));
+  ASSERT_EQ(s.sum, 2 * (10000 * big + (1 << 20) + 10));
+}
+
+TEST_F(RecorderTest, Window) {
+  IntRecorder recorder;
+  Window<IntRecorder> window(&recorder, 2);
+  Maxer<int> maxer;
+  Window<Maxer<int>> max_window(&maxer, 2);
+  recorder << 1 << 3;
+  // Nothing in the window until the sampler collects the second sample.
+  ASSERT_EQ(window.GetValue(), Stat());
+  ASSERT_EQ(window.get_description(), "0");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
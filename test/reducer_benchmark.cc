@@ -0,0 +1,106 @@
+#include "tvar/reducer.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+// A composite value which does not fit in one atomic word.
+struct Pair {
+  int64_t count;
+  int64_t total;
+};
+
+struct AddPair {
+  void operator()(Pair& lhs, const Pair& rhs) const {
+    lhs.count += rhs.count;
+    lhs.total += rhs.total;
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const Pair& p) {
+  return os << p.count << '/' << p.total;
+}
+
+// Average cost of one operator<< with `nthreads' writers. If `read' is
+// true, another thread keeps calling GetValue() meanwhile.
+template <typename R, typename V>
+double Run(R* reducer, const V& value, int nthreads, size_t jobs,
+           bool read) {
+  std::atomic<bool> stop(false);
+  std::thread reader;
+  size_t reads = 0;
+  if (read) {
+    reader = std::thread([reducer, &stop, &reads] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        reducer->GetValue();
+        ++reads;
+      }
+    });
+  }
+  std::vector<double> costs(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([reducer, &value, jobs, t, &costs] {
+      tesla::tutil::Timer timer;
+      timer.start();
+      for (size_t i = 0; i < jobs; ++i) {
+        *reducer << value;
+      }
+      timer.stop();
+      costs[t] = timer.n_elapsed() / static_cast<double>(jobs);
+    }));
+  }
+  double total = 0;
+  for (int t = 0; t < nthreads; ++t) {
+    threads[t].join();
+    total += costs[t];
+  }
+  if (read) {
+    stop.store(true, std::memory_order_relaxed);
+    reader.join();
+  }
+  return total / nthreads;
+}
+
+int main(int argc, const char *argv[])
+{
+  size_t jobs = 10000000;
+  if (argc > 1) {
+    jobs = atoi(argv[1]);
+    if (jobs < 100000) {
+      jobs = 100000;
+    }
+  }
+
+  Adder<int64_t> adder;
+  Reducer<Pair, AddPair> pair_adder(Pair{0, 0});
+  Adder<std::string> string_adder;
+  const Pair pair{1, 10};
+  const std::string str("x");
+
+  for (int nthreads = 1; nthreads <= 4; nthreads *= 2) {
+    for (int read = 0; read <= 1; ++read) {
+      cout << "threads=" << nthreads << " reader=" << read
+           << " Adder<int64_t>=" << Run(&adder, int64_t(1), nthreads, jobs,
+                                        read) << "ns"
+           << " Reducer<Pair>=" << Run(&pair_adder, pair, nthreads, jobs,
+                                       read) << "ns"
+           << " Adder<string>="
+           << Run(&string_adder, str, nthreads, jobs / 100, read) << "ns"
+           << endl;
+      string_adder.Reset();
+    }
+  }
+  const Pair p = pair_adder.GetValue();
+  cout << "pairs=" << p.count << " total=" << p.total << endl;
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "tvar/detail/sampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+std::atomic<int> kSamples(0);
+std::atomic<int> kDeleted(0);
+
+class CountingSampler : public detail::Sampler {
+ public:
+  ~CountingSampler() { kDeleted.fetch_add(1); }
+  void TakeSample() override { kSamples.fetch_add(1); }
+};
+
+// The fixture for testing SamplerCollector.
+class SamplerTest : public ::testing::Test {
+}; // class SamplerTest
+
+TEST_F(SamplerTest, ScheduleAndDestroy) {
+  CountingSampler* s = new CountingSampler;
+  s->Schedule();
+  const size_t scheduled = detail::CountScheduledSamplers();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+  ASSERT_GE(kSamples.load(), 2);
+  ASSERT_LE(kSamples.load(), 3);
+
+  s->Destroy();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+  ASSERT_EQ(kDeleted.load(), 1);
+  ASSERT_EQ(detail::CountScheduledSamplers(), scheduled - 1);
+
+  ASSERT_FALSE(
+      Variable::describe_exposed("tvar_sampler_collector_round_us").empty());
+}
+
+TEST_F(SamplerTest, ReducerSeries) {
+  Adder<int> adder;
+  SeriesOptions options;
+  options.test_only = true;
+  std::ostringstream os;
+  ASSERT_EQ(adder.describe_series(os, options), 1);
+
+  ASSERT_EQ(adder.expose("sampler_test_adder"), 0);
+  adder << 7;
+  ASSERT_EQ(Variable::describe_series_exposed("sampler_test_adder", os,
+                                              options), 0);
+  ASSERT_TRUE(os.str().empty());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  options.test_only = false;
+  ASSERT_EQ(adder.describe_series(os, options), 0);
+  ASSERT_NE(os.str().find(",7]]}"), std::string::npos) << os.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+#include "tvar/detail/series.h"
+
+#include <stdint.h>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+using namespace tesla::tvar::detail;
+
+namespace {
+
+// The fixture for testing Series.
+class SeriesTest : public ::testing::Test {
+}; // class SeriesTest
+
+// Values of the `index'th point of a described series, e.g. "[3,7]".
+std::string Point(int index, int64_t value) {
+  return "[" + std::to_string(index) + "," + std::to_string(value) + "]";
+}
+
+template <typename T>
+void ExpectRoundTrip(const T* values) {
+  SeriesData<T> data;
+  T loaded[kSeriesSize];
+  for (int r = SERIES_SECOND; r <= SERIES_DAY; ++r) {
+    data.Store(r, values + kSeriesRingOffset[r]);
+  }
+  for (int r = SERIES_SECOND; r <= SERIES_DAY; ++r) {
+    data.Load(r, loaded + kSeriesRingOffset[r]);
+  }
+  for (int i = 0; i < kSeriesSize; ++i) {
+    ASSERT_EQ(values[i], loaded[i]) << i;
+  }
+}
+
+TEST_F(SeriesTest, RoundTrip) {
+  int64_t values[kSeriesSize] = {0};
+  ExpectRoundTrip(values);
+
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < kSeriesSize; ++i) {
+    values[i] = static_cast<int64_t>(rng());
+  }
+  values[3] = std::numeric_limits<int64_t>::min();
+  values[4] = std::numeric_limits<int64_t>::max();
+  values[5] = std::numeric_limits<int64_t>::min();
+  values[6] = values[7] = values[8] = 0;
+  ExpectRoundTrip(values);
+
+  uint32_t small[kSeriesSize];
+  for (int i = 0; i < kSeriesSize; ++i) {
+    small[i] = (i % 7 == 0) ? std::numeric_limits<uint32_t>::max() : i / 3;
+  }
+  ExpectRoundTrip(small);
+
+  double floating[kSeriesSize];
+  for (int i = 0; i < kSeriesSize; ++i) {
+    floating[i] = i * 0.25;
+  }
+  ExpectRoundTrip(floating);
+}
+
+TEST_F(SeriesTest, Average) {
+  Series<int64_t, AddTo<int64_t>> series((AddTo<int64_t>()));
+  for (int i = 1; i <= 120; ++i) {
+    series.Append(i);
+  }
+  std::ostringstream os;
+  series.Describe(os, nullptr);
+  const std::string s = os.str();
+  // Averages of 1..60 and 61..120 are the last two minutes.
+  ASSERT_NE(s.find(Point(30 + 24 + 58, 31) + "," + Point(30 + 24 + 59, 91)),
+            std::string::npos) << s;
+  // The last second.
+  ASSERT_NE(s.find(Point(kSeriesSize - 1, 120) + "]}"), std::string::npos)
+      << s;
+}
+
+TEST_F(SeriesTest, Max) {
+  Series<int64_t, MaxTo<int64_t>> series((MaxTo<int64_t>()));
+  for (int i = 0; i < 60; ++i) {
+    series.Append(i == 10 ? 1000 : i);
+  }
+  std::ostringstream os;
+  series.Describe(os, nullptr);
+  // The minute of a Maxer is the max of its seconds, not the average.
+  ASSERT_NE(os.str().find(Point(30 + 24 + 59, 1000)), std::string::npos)
+      << os.str();
+}
+
+TEST_F(SeriesTest, Memory) {
+  // Rings of a slowly moving counter stay in the strings themselves.
+  SeriesData<int64_t> data;
+  int64_t values[60];
+  for (int r = SERIES_SECOND; r <= SERIES_DAY; ++r) {
+    for (int i = 0; i < kSeriesRingSize[r]; ++i) {
+      values[i] = 1000000 + (i > 50);
+    }
+    data.Store(r, values);
+  }
+  ASSERT_LT(sizeof(data) * 8, sizeof(SeriesData<double>));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
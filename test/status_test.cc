@@ -0,0 +1,99 @@
+#include "tvar/status.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "tvar/passive_status.h"
+
+using namespace std;
+using namespace tesla::tvar;
+
+namespace {
+
+// The fixture for testing Status and PassiveStatus.
+class StatusTest : public ::testing::Test {
+}; // class StatusTest
+
+TEST_F(StatusTest, Status) {
+  Status<int64_t> max_connections("status_test_max_connections", 1024);
+  ASSERT_EQ(1024, max_connections.get_value());
+  ASSERT_EQ("1024",
+            Variable::describe_exposed("status_test_max_connections"));
+  max_connections.set_value(2048);
+  ASSERT_EQ("2048",
+            Variable::describe_exposed("status_test_max_connections"));
+
+  Status<std::string> state("status_test_state", "starting");
+  state.set_value("serving");
+  ASSERT_EQ("serving", state.get_value());
+  ASSERT_EQ("\"serving\"", Variable::describe_exposed("status_test_state",
+                                                      true));
+  ASSERT_EQ("serving", state.get_description());
+
+  Status<double> ratio;
+  ASSERT_EQ(0.0, ratio.get_value());
+  ratio.set_value(0.5);
+  ASSERT_EQ("0.5", ratio.get_description());
+}
+
+int64_t GetSize(void* arg) {
+  return static_cast<std::vector<int>*>(arg)->size();
+}
+
+TEST_F(StatusTest, PassiveStatus) {
+  std::vector<int> queue(3);
+  PassiveStatus<int64_t> size("status_test_size", GetSize, &queue);
+  ASSERT_EQ(3, size.GetValue());
+
+  int calls = 0;
+  PassiveStatus<int64_t> pool_size("status_test_pool_size", [&calls] {
+    return ++calls;
+  });
+  ASSERT_EQ("1", Variable::describe_exposed("status_test_pool_size"));
+  ASSERT_EQ("2", Variable::describe_exposed("status_test_pool_size"));
+
+  PassiveStatus<int64_t> empty(nullptr, nullptr);
+  ASSERT_EQ(0, empty.GetValue());
+}
+
+TEST_F(StatusTest, Cache) {
+  std::atomic<int> calls(0);
+  PassiveStatus<int64_t> depth([&calls] {
+    return calls.fetch_add(1) + 1;
+  });
+  depth.set_cache_ms(200);
+  ASSERT_EQ(1, depth.GetValue());
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&depth] {
+      for (int j = 0; j < 1000; ++j) {
+        depth.GetValue();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_LE(calls.load(), 2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  const int64_t value = depth.GetValue();
+  ASSERT_EQ(calls.load(), value);
+  ASSERT_EQ(value, depth.GetValue());
+
+  depth.set_cache_ms(0);
+  ASSERT_EQ(value + 1, depth.GetValue());
+  ASSERT_EQ(value + 2, depth.GetValue());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
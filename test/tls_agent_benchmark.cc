@@ -0,0 +1,122 @@
+#include "tvar/detail/agent_group.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "tutil/time.h"
+#include "tvar/reducer.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+namespace {
+
+struct Agent {
+  int64_t value{0};
+};
+
+// The layout AgentGroup used before: a thread_local pointer to a vector
+// of pointers to blocks of agents.
+class LegacyAgentGroup {
+ public:
+  constexpr static size_t kElementPerBlock = 4096 / sizeof(Agent);
+
+  struct ThreadBlock {
+    Agent agents[kElementPerBlock];
+  };
+
+  static Agent* GetTlsAgent(detail::AgentId id) {
+    if (id >= 0 && s_tls_blocks_) {
+      const size_t block_id = static_cast<size_t>(id) / kElementPerBlock;
+      if (block_id < s_tls_blocks_->size()) {
+        std::unique_ptr<ThreadBlock>& block = (*s_tls_blocks_)[block_id];
+        if (block) {
+          return &block->agents[id - block_id * kElementPerBlock];
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  static Agent* GetOrCreateTlsAgent(detail::AgentId id) {
+    if (s_tls_blocks_ == nullptr) {
+      s_tls_blocks_.reset(new std::vector<std::unique_ptr<ThreadBlock>>);
+    }
+    const size_t block_id = static_cast<size_t>(id) / kElementPerBlock;
+    if (block_id >= s_tls_blocks_->size()) {
+      s_tls_blocks_->resize(std::max(block_id + 1, 32ul));
+    }
+    std::unique_ptr<ThreadBlock>& block = (*s_tls_blocks_)[block_id];
+    if (block == nullptr) {
+      block.reset(new ThreadBlock);
+    }
+    return &block->agents[id - block_id * kElementPerBlock];
+  }
+
+ private:
+  static thread_local std::unique_ptr<std::vector<std::unique_ptr<ThreadBlock>>>
+      s_tls_blocks_;
+};
+
+thread_local std::unique_ptr<
+    std::vector<std::unique_ptr<LegacyAgentGroup::ThreadBlock>>>
+    LegacyAgentGroup::s_tls_blocks_;
+
+// Bump the agents of `ids' round-robin, the size of `ids' is a power of 2.
+template <typename Group>
+__attribute__((noinline)) double Run(const std::vector<detail::AgentId>& ids,
+                                     size_t jobs) {
+  for (detail::AgentId id : ids) {
+    Group::GetOrCreateTlsAgent(id);
+  }
+  const size_t mask = ids.size() - 1;
+  tesla::tutil::Timer timer;
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    Agent* agent = Group::GetTlsAgent(ids[i & mask]);
+    agent->value += 1;
+  }
+  timer.stop();
+  return timer.n_elapsed() / static_cast<double>(jobs);
+}
+
+} // namespace
+
+int main(int argc, const char *argv[])
+{
+  size_t jobs = 100000000;
+  if (argc > 1) {
+    jobs = atoi(argv[1]);
+    if (jobs < 100000) {
+      jobs = 100000;
+    }
+  }
+
+  for (size_t nids : {1, 16, 256, 4096}) {
+    std::vector<detail::AgentId> ids;
+    for (size_t i = 0; i < nids; ++i) {
+      ids.push_back(detail::AgentGroup<Agent>::CreateNewAgent());
+    }
+    cout << "ids=" << nids
+         << " legacy=" << Run<LegacyAgentGroup>(ids, jobs) << "ns"
+         << " flat=" << Run<detail::AgentGroup<Agent>>(ids, jobs) << "ns"
+         << endl;
+    for (detail::AgentId id : ids) {
+      detail::AgentGroup<Agent>::DestroyAgent(id);
+    }
+  }
+
+  Adder<int64_t> adder;
+  tesla::tutil::Timer timer;
+  timer.start();
+  for (size_t i = 0; i < jobs; ++i) {
+    adder << 1;
+  }
+  timer.stop();
+  cout << "Adder<int64_t>: " << timer.n_elapsed() / static_cast<double>(jobs)
+       << "ns/op" << endl;
+  return 0;
+}
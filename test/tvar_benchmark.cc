@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tutil/count_down_latch.h"
+#include "tutil/time.h"
+#include "tvar/recorder.h"
+#include "tvar/reducer.h"
+
+using namespace tesla::tvar;
+using namespace std;
+
+// Overhead of tvar in the hot path, to be compared between revisions. Each
+// case starts `nthreads' threads writing to `nreducers' live reducers and
+// prints:
+//   update:      ns per operator<<, spread over all the reducers, after
+//                every thread has its agents;
+//   first touch: ns per agent created by the first operator<< of a thread
+//                on a reducer;
+//   get value:   ns per GetValue(), which combines the agents of all
+//                threads;
+//   exit:        us per exiting thread, which merges its agents back.
+// Usage: tvar_benchmark [max_threads] [max_reducers] [updates_per_thread]
+
+namespace {
+
+struct Result {
+  double update_ns = 0;
+  double first_touch_ns = 0;
+  double get_value_ns = 0;
+  double exit_us = 0;
+};
+
+template <typename R>
+Result Run(int nthreads, int nreducers, size_t updates) {
+  std::vector<std::unique_ptr<R>> reducers;
+  for (int i = 0; i < nreducers; ++i) {
+    reducers.emplace_back(new R);
+  }
+
+  tesla::tutil::CountDownLatch touched(nthreads);
+  tesla::tutil::CountDownLatch go(1);
+  tesla::tutil::CountDownLatch updated(nthreads);
+  tesla::tutil::CountDownLatch exit(1);
+  std::vector<double> touch_costs(nthreads);
+  std::vector<double> update_costs(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([&, t] {
+      tesla::tutil::Timer timer;
+      timer.start();
+      for (auto& reducer : reducers) {
+        *reducer << 1;
+      }
+      timer.stop();
+      touch_costs[t] = timer.n_elapsed() / static_cast<double>(nreducers);
+      touched.CountDown();
+
+      go.Wait();
+      timer.start();
+      for (size_t i = 0, j = 0; i < updates; ++i) {
+        *reducers[j] << static_cast<int64_t>(i);
+        if (++j == reducers.size()) {
+          j = 0;
+        }
+      }
+      timer.stop();
+      update_costs[t] = timer.n_elapsed() / static_cast<double>(updates);
+      updated.CountDown();
+      exit.Wait();
+    }));
+  }
+  touched.Wait();
+  go.CountDown();
+  updated.Wait();
+
+  Result result;
+  for (int t = 0; t < nthreads; ++t) {
+    result.first_touch_ns += touch_costs[t] / nthreads;
+    result.update_ns += update_costs[t] / nthreads;
+  }
+
+  // All agents are alive while the threads wait for `exit'.
+  tesla::tutil::Timer timer;
+  const int rounds = std::max(1, 10000 / nreducers);
+  timer.start();
+  for (int r = 0; r < rounds; ++r) {
+    for (auto& reducer : reducers) {
+      reducer->GetValue();
+    }
+  }
+  timer.stop();
+  result.get_value_ns =
+      timer.n_elapsed() / static_cast<double>(rounds * nreducers);
+
+  timer.start();
+  exit.CountDown();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  timer.stop();
+  result.exit_us = timer.n_elapsed() / 1000.0 / nthreads;
+  return result;
+}
+
+template <typename R>
+void RunAll(const char* type, int max_threads, int max_reducers,
+            size_t updates) {
+  for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+    for (int nreducers = 1; nreducers <= max_reducers; nreducers *= 10) {
+      const Result r = Run<R>(nthreads, nreducers, updates);
+      printf("%-16s threads=%-3d reducers=%-6d update=%.1fns "
+             "first_touch=%.1fns get_value=%.1fns exit=%.1fus\n",
+             type, nthreads, nreducers, r.update_ns, r.first_touch_ns,
+             r.get_value_ns, r.exit_us);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, const char *argv[])
+{
+  int max_threads = 8;
+  int max_reducers = 10000;
+  size_t updates = 1000000;
+  if (argc > 1) {
+    max_threads = std::max(1, atoi(argv[1]));
+  }
+  if (argc > 2) {
+    max_reducers = std::max(1, atoi(argv[2]));
+  }
+  if (argc > 3) {
+    updates = std::max(1, atoi(argv[3]));
+  }
+
+  RunAll<Adder<int64_t>>("Adder<int64_t>", max_threads, max_reducers,
+                         updates);
+  RunAll<Maxer<int64_t>>("Maxer<int64_t>", max_threads, max_reducers,
+                         updates);
+  RunAll<IntRecorder>("IntRecorder", max_threads, max_reducers, updates);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "tutil/wildcard_matcher.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tutil/time.h"
+
+using namespace tesla::tutil;
+using namespace std;
+
+// The backtracking matcher WildcardMatcher used to try on every wildcard.
+bool LegacyWildcmp(const char* wild, const char* str, char question_mark) {
+  const char* cp = NULL;
+  const char* mp = NULL;
+  while (*str && *wild != '*') {
+    if (*wild != *str && *wild != question_mark) {
+      return false;
+    }
+    ++wild;
+    ++str;
+  }
+  while (*str) {
+    if (*wild == '*') {
+      if (!*++wild) {
+        return true;
+      }
+      mp = wild;
+      cp = str + 1;
+    } else if (*wild == *str || *wild == question_mark) {
+      ++wild;
+      ++str;
+    } else {
+      wild = mp;
+      str = cp++;
+    }
+  }
+  while (*wild == '*') {
+    ++wild;
+  }
+  return !*wild;
+}
+
+int main(int argc, const char *argv[])
+{
+  size_t rounds = 20;
+  if (argc > 1) {
+    rounds = atoi(argv[1]);
+    if (rounds < 1) {
+      rounds = 1;
+    }
+  }
+
+  // Names like the variables of a large service.
+  const char* const modules[] = {
+    "rpc_server", "rpc_client", "process", "redis", "mysql", "cache",
+    "scheduler", "storage",
+  };
+  const char* const suffixes[] = {
+    "_latency", "_latency_99", "_qps", "_count", "_error", "_max_latency",
+  };
+  std::vector<std::string> names;
+  for (int i = 0; names.size() < 50000; ++i) {
+    names.push_back(std::string(modules[i % 8]) + "_method" +
+                    std::to_string(i) + suffixes[i % 6]);
+  }
+
+  std::string wildcards;
+  std::vector<std::string> patterns;
+  for (int i = 0; i < 20; ++i) {
+    patterns.push_back(std::string(modules[i % 8]) + "_method" +
+                       std::to_string(i) + "*" + suffixes[i % 6]);
+  }
+  patterns.push_back("*_latency_99");
+  patterns.push_back("process_*");
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    wildcards.append(patterns[i]);
+    wildcards.push_back(';');
+  }
+
+  Timer timer;
+  size_t matched = 0;
+
+  timer.start();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      for (size_t j = 0; j < patterns.size(); ++j) {
+        if (LegacyWildcmp(patterns[j].c_str(), names[i].c_str(), '?')) {
+          ++matched;
+          break;
+        }
+      }
+    }
+  }
+  timer.stop();
+  const double total = static_cast<double>(rounds * names.size());
+  cout << "legacy:           " << timer.n_elapsed() / total << "ns/name"
+       << endl;
+
+  timer.start();
+  ::tutil::WildcardMatcher* matcher = nullptr;
+  for (size_t r = 0; r < rounds; ++r) {
+    delete matcher;
+    matcher = new ::tutil::WildcardMatcher(wildcards, '?', false);
+  }
+  timer.stop();
+  cout << "compile:          " << timer.u_elapsed() / rounds << "us"
+       << endl;
+
+  timer.start();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      matched += matcher->Match(names[i]);
+    }
+  }
+  timer.stop();
+  cout << "WildcardMatcher:  " << timer.n_elapsed() / total << "ns/name"
+       << endl;
+  delete matcher;
+
+  // Keep `matched' alive so that loops are not optimized out.
+  return matched == 0;
+}
@@ -59,6 +59,77 @@ TEST_F(WildcardMatcherTest, Match) {
 
 }
 
+// Plain recursive matching, as the reference.
+bool ReferenceMatch(const char* wild, const char* str, char question_mark) {
+  if (*wild == '\0') {
+    return *str == '\0';
+  }
+  if (*wild == '*') {
+    return ReferenceMatch(wild + 1, str, question_mark) ||
+           (*str != '\0' && ReferenceMatch(wild, str + 1, question_mark));
+  }
+  return *str != '\0' && (*wild == question_mark || *wild == *str) &&
+         ReferenceMatch(wild + 1, str + 1, question_mark);
+}
+
+TEST_F(WildcardMatcherTest, SameAsReference) {
+  const char* const wildcards[] = {
+    "rpc_*", "*_latency", "*_latency_9$", "process_*_count", "a*b*c",
+    "**x", "$$$", "*", "exact_name",
+  };
+  const char* const names[] = {
+    "", "rpc", "rpc_", "rpc_server_latency", "foo_latency_99",
+    "foo_latency_90", "foo_latency_9", "process_fd_count", "process_count",
+    "abc", "aXbYc", "acb", "x", "xxx", "abx", "exact_name", "exact_names",
+  };
+  std::string all;
+  for (const char* w : wildcards) {
+    // Each wildcard alone.
+    tutil::WildcardMatcher matcher(w, '$', false);
+    for (const char* name : names) {
+      ASSERT_EQ(ReferenceMatch(w, name, '$'), matcher.Match(name))
+          << w << " " << name;
+    }
+    if (strcmp(w, "*") != 0) {
+      all.append(w);
+      all.push_back(';');
+    }
+  }
+  // All wildcards but "*" together.
+  tutil::WildcardMatcher matcher(all, '$', false);
+  for (const char* name : names) {
+    bool expected = false;
+    for (const char* w : wildcards) {
+      if (strcmp(w, "*") != 0) {
+        expected = expected || ReferenceMatch(w, name, '$');
+      }
+    }
+    ASSERT_EQ(expected, matcher.Match(name)) << name;
+  }
+}
+
+TEST_F(WildcardMatcherTest, ManyStates) {
+  // Too many states for the DFA, matched one by one.
+  std::string wildcards;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    wildcards.append("*");
+    wildcards.push_back(c);
+    wildcards.append("*?*");
+    wildcards.push_back(c);
+    wildcards.append("*;");
+  }
+  tutil::WildcardMatcher matcher(wildcards, '?', false);
+  ASSERT_TRUE(matcher.Match("xaybzcxa"));
+  ASSERT_FALSE(matcher.Match("abcdefg"));
+  ASSERT_FALSE(matcher.Match("aa"));
+  ASSERT_TRUE(matcher.Match("aza"));
+}
+
+TEST_F(WildcardMatcherTest, BothEmpty) {
+  ASSERT_TRUE(tutil::WildcardMatcher("", '?', true).Match("foo"));
+  ASSERT_FALSE(tutil::WildcardMatcher("", '?', false).Match("foo"));
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,117 @@
+#include "tvar/window.h"
+
+#include <gtest/gtest.h>
+
+#include "tvar/reducer.h"
+
+using namespace std;
+using namespace tesla::tvar;
+using tesla::tutil::Duration;
+using tesla::tutil::Timestamp;
+
+namespace {
+
+// A reducer whose sampler is not scheduled, the test takes the samples
+// with a fake clock so that nothing depends on the collector thread.
+template <typename R>
+class ManualSampled : public R {
+ public:
+  using sampler_type = typename R::sampler_type;
+
+  explicit ManualSampled(Timestamp start)
+      : start_(start), sampler_(this, start) {}
+
+  // Hides R::get_sampler(), which would schedule a sampler.
+  sampler_type* get_sampler() { return &sampler_; }
+
+  // Take the sample of `seconds' after the start.
+  void TakeSampleAt(int seconds) {
+    sampler_.TakeSampleAt(start_ + Duration(seconds * Duration::kSecond));
+  }
+
+ private:
+  Timestamp start_;
+  sampler_type sampler_;
+};
+
+// The fixture for testing Window and PerSecond.
+class WindowTest : public ::testing::Test {
+}; // class WindowTest
+
+TEST_F(WindowTest, InvertibleReducer) {
+  ManualSampled<Adder<int>> adder(Timestamp::Now());
+  Window<ManualSampled<Adder<int>>> window(&adder, 3);
+  PerSecond<ManualSampled<Adder<int>>> per_second(&adder, 3);
+  ASSERT_EQ(window.window_size(), 3);
+
+  adder << 100;
+  // No sample has been taken after the first one yet.
+  ASSERT_EQ(window.GetValue(), 0);
+  ASSERT_EQ(per_second.GetValue(), 0);
+
+  adder.TakeSampleAt(1);
+  ASSERT_EQ(window.GetValue(), 100);
+  ASSERT_EQ(per_second.GetValue(), 100);
+
+  adder << 200;
+  adder.TakeSampleAt(2);
+  ASSERT_EQ(window.GetValue(), 300);
+  ASSERT_EQ(per_second.GetValue(), 150);
+  ASSERT_EQ(per_second.GetValue(1), 200);
+
+  adder.TakeSampleAt(3);
+  ASSERT_EQ(window.GetValue(), 300);
+  ASSERT_EQ(per_second.GetValue(), 100);
+
+  // The first 100 slides out of the window.
+  adder.TakeSampleAt(4);
+  ASSERT_EQ(window.GetValue(), 200);
+  ASSERT_EQ(per_second.GetValue(), 200 / 3);
+  ASSERT_EQ(window.GetValue(1), 0);
+
+  // The reducer itself is untouched.
+  ASSERT_EQ(adder.GetValue(), 300);
+}
+
+TEST_F(WindowTest, NonInvertibleReducer) {
+  using Sum = Reducer<int, detail::AddTo<int>>;
+  ManualSampled<Sum> reducer(Timestamp::Now());
+  Window<ManualSampled<Sum>> window("window_test_sum", &reducer, 3);
+
+  reducer << 5;
+  reducer.TakeSampleAt(1);
+  reducer << 7;
+  reducer.TakeSampleAt(2);
+  ASSERT_EQ(window.GetValue(), 12);
+  ASSERT_EQ(Variable::describe_exposed("window_test_sum"), "12");
+
+  reducer.TakeSampleAt(3);
+  reducer << 1;
+  reducer.TakeSampleAt(4);
+  // The second of 5 slides out of the window.
+  ASSERT_EQ(window.GetValue(), 8);
+  ASSERT_EQ(window.GetValue(1), 1);
+}
+
+TEST_F(WindowTest, Maxer) {
+  ManualSampled<Maxer<int>> maxer(Timestamp::Now());
+  Window<ManualSampled<Maxer<int>>> window(&maxer, 2);
+
+  maxer << 9;
+  maxer.TakeSampleAt(1);
+  maxer << 3;
+  maxer.TakeSampleAt(2);
+  ASSERT_EQ(window.GetValue(), 9);
+
+  maxer << 4;
+  maxer.TakeSampleAt(3);
+  ASSERT_EQ(window.GetValue(), 4);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Parses the command line for googletest flags, and removes all recognized flags.
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -20,7 +20,7 @@
 
 #include <stdint.h>
 
-#include "glog/logging.h"
+#include "log/logging.h"
 #include "tutil/compiler_specific.h"
 
 // A safe way of doing "(1 << n) - 1" -- without worrying about overflow.
@@ -54,18 +54,18 @@ class PackedCache {
   }
 
   void Put(K key, V value) {
-    CHECK(key == (key & kKeyMask)) << "The key is out of range"; 
-    CHECK(value == (value & kValueMask)) << "The value is out of range"; 
+    TESLA_CHECK(key == (key & kKeyMask)) << "The key is out of range";
+    TESLA_CHECK(value == (value & kValueMask)) << "The value is out of range";
     array_[Hash(key)] = KeyToUpper(key) | value;
   }
 
   void Invalidate(K key) {
-    CHECK(key == (key & kKeyMask)) << "The key is out of range"; 
+    TESLA_CHECK(key == (key & kKeyMask)) << "The key is out of range";
     array_[Hash(key)] = KeyToUpper(key) | kInvalidMask;
   }
 
   bool TryGet(K key, V* out) const {
-    CHECK(key == (key & kKeyMask)) << "The key is out of range"; 
+    TESLA_CHECK(key == (key & kKeyMask)) << "The key is out of range";
     T entry = array_[Hash(key)] ^ KeyToUpper(key);
     if (TESLA_UNLIKELY(entry >= (1 << kValuebits))) {
       return false;
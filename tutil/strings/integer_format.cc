@@ -0,0 +1,115 @@
+#include "tutil/strings/integer_format.h"
+
+#include <string.h>
+
+namespace tutil {
+
+namespace {
+
+const char kDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+const char kHexDigits[] = "0123456789ABCDEF";
+
+const uint64_t kPowersOf10[20] = {
+  0ULL,
+  10ULL,
+  100ULL,
+  1000ULL,
+  10000ULL,
+  100000ULL,
+  1000000ULL,
+  10000000ULL,
+  100000000ULL,
+  1000000000ULL,
+  10000000000ULL,
+  100000000000ULL,
+  1000000000000ULL,
+  10000000000000ULL,
+  100000000000000ULL,
+  1000000000000000ULL,
+  10000000000000000ULL,
+  100000000000000000ULL,
+  1000000000000000000ULL,
+  10000000000000000000ULL,
+};
+
+// Write all digits of `v' backward, the last one right before `end'.
+// The caller sizes the room with CountDecimalDigits().
+template <typename T>
+inline void WriteDigits(char* end, T v) {
+  while (v >= 100) {
+    const unsigned i = static_cast<unsigned>(v % 100) * 2;
+    v /= 100;
+    end -= 2;
+    memcpy(end, kDigitPairs + i, 2);
+  }
+  if (v >= 10) {
+    memcpy(end - 2, kDigitPairs + v * 2, 2);
+  } else {
+    end[-1] = static_cast<char>('0' + v);
+  }
+}
+
+} // namespace
+
+int CountDecimalDigits(uint64_t v) {
+  // log10(v) ~= log2(v) * 1233 / 4096, then fix it up with one compare.
+  const int t = ((64 - __builtin_clzll(v | 1)) * 1233) >> 12;
+  return t + (v >= kPowersOf10[t]);
+}
+
+size_t FormatUint32(char* buf, uint32_t v) {
+  const int len = CountDecimalDigits(v);
+  WriteDigits(buf + len, v);
+  return len;
+}
+
+size_t FormatUint64(char* buf, uint64_t v) {
+  if (v <= UINT32_MAX) {
+    return FormatUint32(buf, static_cast<uint32_t>(v));
+  }
+  const int len = CountDecimalDigits(v);
+  WriteDigits(buf + len, v);
+  return len;
+}
+
+size_t FormatInt32(char* buf, int32_t v) {
+  // Negate in unsigned arithmetic so that INT32_MIN works.
+  uint32_t u = static_cast<uint32_t>(v);
+  if (v < 0) {
+    *buf++ = '-';
+    u = 0 - u;
+  }
+  return FormatUint32(buf, u) + (v < 0);
+}
+
+size_t FormatInt64(char* buf, int64_t v) {
+  uint64_t u = static_cast<uint64_t>(v);
+  if (v < 0) {
+    *buf++ = '-';
+    u = 0 - u;
+  }
+  return FormatUint64(buf, u) + (v < 0);
+}
+
+size_t FormatHex(char* buf, uint64_t v) {
+  const int len = (64 - __builtin_clzll(v | 1) + 3) >> 2;
+  char* p = buf + len;
+  do {
+    *--p = kHexDigits[v & 0xf];
+    v >>= 4;
+  } while (p != buf);
+  return len;
+}
+
+} // namespace tutil
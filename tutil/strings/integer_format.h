@@ -0,0 +1,53 @@
+#ifndef TESLA_TUTIL_STRINGS_INTEGER_FORMAT_H_
+#define TESLA_TUTIL_STRINGS_INTEGER_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+// Integer to text conversion used by hot formatting paths (LogStream,
+// tvar). Digits are written from right to left two at a time with a
+// lookup table, after the length is computed up front, so there is no
+// reverse pass and only one division per two digits.
+//
+// This library has no dependencies, so that //log can use it as well.
+
+namespace tutil {
+
+// Number of decimal digits of `v', 1 for 0.
+int CountDecimalDigits(uint64_t v);
+
+// Write the decimal form of `v' into `buf' which must have room for 20
+// (unsigned) or 21 (signed) bytes. The result is not NUL-terminated.
+// Returns the length of the result.
+size_t FormatUint32(char* buf, uint32_t v);
+size_t FormatUint64(char* buf, uint64_t v);
+size_t FormatInt32(char* buf, int32_t v);
+size_t FormatInt64(char* buf, int64_t v);
+
+// Write `v' as upper-case hex without prefix into `buf', which must have
+// room for 16 bytes. The result is not NUL-terminated.
+// Returns the length of the result.
+size_t FormatHex(char* buf, uint64_t v);
+
+// Dispatch any integral type (except bool) to the functions above.
+template <typename T>
+inline size_t FormatInteger(char* buf, T v) {
+  static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                "FormatInteger() requires an integral type");
+  if (std::is_signed<T>::value) {
+    if (sizeof(T) <= sizeof(int32_t)) {
+      return FormatInt32(buf, static_cast<int32_t>(v));
+    }
+    return FormatInt64(buf, static_cast<int64_t>(v));
+  }
+  if (sizeof(T) <= sizeof(uint32_t)) {
+    return FormatUint32(buf, static_cast<uint32_t>(v));
+  }
+  return FormatUint64(buf, static_cast<uint64_t>(v));
+}
+
+} // namespace tutil
+
+#endif // TESLA_TUTIL_STRINGS_INTEGER_FORMAT_H_
@@ -85,53 +85,53 @@ inline struct timespec Timestamp::TimeSpec() const {
   return t;
 }
 
-int64_t Timestamp::UnixNanoseconds() const {
+inline int64_t Timestamp::UnixNanoseconds() const {
   return nanoseconds_;
 }
 
-int64_t Timestamp::UnixMicroseconds() const {
+inline int64_t Timestamp::UnixMicroseconds() const {
   return nanoseconds_ / Duration::kMicrosecond;
 }
 
-int64_t Timestamp::UnixMilliseconds() const {
+inline int64_t Timestamp::UnixMilliseconds() const {
   return nanoseconds_ / Duration::kMillisecond;
 }
 
-int64_t Timestamp::UnixSeconds() const {
+inline int64_t Timestamp::UnixSeconds() const {
   return nanoseconds_ / Duration::kSecond;
 }
 
-bool Timestamp::operator< (const Timestamp& rhs) const {
+inline bool Timestamp::operator< (const Timestamp& rhs) const {
   return nanoseconds_ < rhs.nanoseconds_;
 }
 
-bool Timestamp::operator> (const Timestamp& rhs) const {
+inline bool Timestamp::operator> (const Timestamp& rhs) const {
   return nanoseconds_ > rhs.nanoseconds_;
 }
 
-bool Timestamp::operator==(const Timestamp& rhs) const {
+inline bool Timestamp::operator==(const Timestamp& rhs) const {
   return nanoseconds_ == rhs.nanoseconds_;
 }
 
-Timestamp Timestamp::operator+ (const Duration& rhs) const {
+inline Timestamp Timestamp::operator+ (const Duration& rhs) const {
   return Timestamp(nanoseconds_ + rhs.Nanoseconds());
 }
 
-Timestamp& Timestamp::operator+=(const Duration& rhs) {
+inline Timestamp& Timestamp::operator+=(const Duration& rhs) {
   nanoseconds_ += rhs.Nanoseconds();
   return *this;
 }
 
-Timestamp Timestamp::operator- (const Duration& rhs) const {
+inline Timestamp Timestamp::operator- (const Duration& rhs) const {
   return Timestamp(nanoseconds_ - rhs.Nanoseconds());
 }
 
-Timestamp& Timestamp::operator-=(const Duration& rhs) {
+inline Timestamp& Timestamp::operator-=(const Duration& rhs) {
   nanoseconds_ -= rhs.Nanoseconds();
   return *this;
 }
 
-Duration Timestamp::operator- (const Timestamp& rhs) const {
+inline Duration Timestamp::operator- (const Timestamp& rhs) const {
   return Duration(nanoseconds_ - rhs.nanoseconds_);
 }
 
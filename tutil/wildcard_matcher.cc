@@ -1,4 +1,10 @@
 #include "tutil/wildcard_matcher.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
 #include "tutil/string_splitter.h"
 
 // Author: Michael,Tesla(michaeltesla1995@gmail.com)
@@ -46,13 +52,48 @@ inline bool wildcmp(const char* wild, const char* str, char question_mark) {
   return !*wild;
 }
 
+// Kinds of the positions in compiled wildcards.
+enum PositionKind : uint8_t {
+  kLiteral,    // the character
+  kAnyChar,    // question mark
+  kAnyString,  // *
+  kEnd,        // the whole wildcard is matched
+};
+
+struct Position {
+  PositionKind kind;
+  uint8_t c;
+};
+
+// Add `pos' and the positions reachable from it without consuming any
+// character into `set'.
+inline void AddClosure(const std::vector<Position>& positions, uint32_t pos,
+                       std::vector<uint32_t>* set, std::vector<bool>* added) {
+  while (true) {
+    if (!(*added)[pos]) {
+      (*added)[pos] = true;
+      set->push_back(pos);
+    }
+    if (positions[pos].kind != kAnyString) {
+      return;
+    }
+    ++pos;
+  }
+}
+
+// Wildcards like "a*b*c*d" may need exponentially many states, fall back to
+// wildcmp() beyond this.
+constexpr size_t kMaxDfaStates = 4096;
+
 } // namespace internal	
 
 WildcardMatcher::WildcardMatcher(const std::string& wildcards,
                                  char question_mark,
                                  bool on_both_empty)
     : question_mark_(question_mark),
-      on_both_empty_(on_both_empty) {
+      on_both_empty_(on_both_empty),
+      class_count_(0),
+      compiled_(false) {
 
   if (wildcards.empty()) {
     return;     
@@ -74,9 +115,153 @@ WildcardMatcher::WildcardMatcher(const std::string& wildcards,
       exact_names_.insert(name);
     }
   }
+  // Exact names alone are found by the set.
+  if (!wildcards_.empty()) {
+    compiled_ = Compile();
+  }
+}
+
+bool WildcardMatcher::Compile() {
+  using internal::Position;
+
+  // Every wildcard and exact name is a chain of positions ending with kEnd.
+  std::vector<Position> positions;
+  std::vector<uint32_t> starts;
+  bool literal[256] = { false };
+  auto add_chain = [&](const std::string& str, bool exact) {
+    starts.push_back(positions.size());
+    for (char ch : str) {
+      const uint8_t c = static_cast<uint8_t>(ch);
+      if (!exact && ch == '*') {
+        positions.push_back(Position{internal::kAnyString, 0});
+      } else if (!exact && ch == question_mark_) {
+        positions.push_back(Position{internal::kAnyChar, 0});
+      } else {
+        positions.push_back(Position{internal::kLiteral, c});
+        literal[c] = true;
+      }
+    }
+    positions.push_back(Position{internal::kEnd, 0});
+  };
+  for (size_t i = 0; i < wildcards_.size(); ++i) {
+    add_chain(wildcards_[i], false);
+  }
+  for (auto it = exact_names_.begin(); it != exact_names_.end(); ++it) {
+    add_chain(*it, true);
+  }
+
+  // Class 0 is for the characters not in any wildcard.
+  uint8_t representatives[256];
+  class_count_ = 1;
+  int others = -1;
+  for (int c = 0; c < 256; ++c) {
+    if (literal[c]) {
+      classes_[c] = static_cast<uint8_t>(class_count_);
+      representatives[class_count_++] = static_cast<uint8_t>(c);
+    } else {
+      classes_[c] = 0;
+      if (others < 0) {
+        others = c;
+      }
+    }
+  }
+  if (others < 0) {
+    return false;
+  }
+  representatives[0] = static_cast<uint8_t>(others);
+
+  // Subset construction, a state is a sorted set of positions.
+  std::map<std::vector<uint32_t>, int32_t> state_ids;
+  std::vector<std::vector<uint32_t>> states;
+  std::vector<bool> added(positions.size(), false);
+  std::vector<uint32_t> next;
+  for (size_t i = 0; i < starts.size(); ++i) {
+    internal::AddClosure(positions, starts[i], &next, &added);
+  }
+  std::sort(next.begin(), next.end());
+  for (uint32_t pos : next) {
+    added[pos] = false;
+  }
+  state_ids.emplace(next, 0);
+  states.push_back(next);
+
+  transitions_.clear();
+  accept_.clear();
+  for (size_t i = 0; i < states.size(); ++i) {
+    const std::vector<uint32_t> current = states[i];
+    uint8_t accept = 0;
+    for (uint32_t pos : current) {
+      if (positions[pos].kind == internal::kEnd) {
+        accept = 1;
+      }
+    }
+    for (int cls = 0; cls < class_count_; ++cls) {
+      const uint8_t c = representatives[cls];
+      next.clear();
+      for (uint32_t pos : current) {
+        const Position& p = positions[pos];
+        if (p.kind == internal::kAnyString) {
+          internal::AddClosure(positions, pos, &next, &added);
+        } else if (p.kind == internal::kAnyChar ||
+                   (p.kind == internal::kLiteral && p.c == c)) {
+          internal::AddClosure(positions, pos + 1, &next, &added);
+        }
+      }
+      for (uint32_t pos : next) {
+        added[pos] = false;
+      }
+      if (next.empty()) {
+        transitions_.push_back(kDeadState);
+        continue;
+      }
+      std::sort(next.begin(), next.end());
+      auto result = state_ids.emplace(next, static_cast<int32_t>(states.size()));
+      if (result.second) {
+        if (states.size() >= internal::kMaxDfaStates) {
+          return false;
+        }
+        states.push_back(next);
+      }
+      transitions_.push_back(result.first->second);
+    }
+    accept_.push_back(accept);
+  }
+
+  // Find the states accepting all names with their prefixes.
+  std::vector<bool> accept_all(accept_.size(), false);
+  for (size_t i = 0; i < accept_.size(); ++i) {
+    const int32_t* row = &transitions_[i * class_count_];
+    accept_all[i] =
+        accept_[i] && std::all_of(row, row + class_count_, [i](int32_t s) {
+          return s == static_cast<int32_t>(i);
+        });
+  }
+  // Replace the states with offsets of their rows to save a multiplication
+  // per character in Match().
+  for (size_t i = 0; i < transitions_.size(); ++i) {
+    const int32_t s = transitions_[i];
+    if (s >= 0) {
+      transitions_[i] = accept_all[s] ? kAcceptAllState : s * class_count_;
+    }
+  }
+  return true;
 }
 
 bool WildcardMatcher::Match(const std::string& name) const {
+  if (compiled_) {
+    int32_t offset = 0;
+    for (const char ch : name) {
+      offset = transitions_[offset + classes_[static_cast<uint8_t>(ch)]];
+      if (offset < 0) {
+        return offset == kAcceptAllState;
+      }
+    }
+    return accept_[offset / class_count_];
+  }
+  return MatchByWildcards(name);
+}
+
+bool WildcardMatcher::MatchByWildcards(const std::string& name) const {
   if (!exact_names_.empty()) {
     if (exact_names_.find(name) != exact_names_.end()) {
       return true;
@@ -4,12 +4,21 @@
 // Author: Michael,Tesla(michaeltesla1995@gmail.com)
 // Date: Mon Jan 21 23:00:30 CST 2019
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 #include <set>
 
 namespace tutil {
 
+// Match names against wildcards separated by `,' or `;', in which `*'
+// matches any characters and `question_mark' matches one character.
+// All wildcards and exact names are compiled into one DFA when the matcher
+// is constructed, so a name is matched by one pass over its characters no
+// matter how many wildcards there are. If the DFA grows too large, the
+// wildcards are tried one by one instead.
+// Match() is const and thread-safe.
 class WildcardMatcher {
  public:
   WildcardMatcher(const std::string& wildcards,
@@ -27,6 +36,30 @@ class WildcardMatcher {
   bool on_both_empty_;
   std::vector<std::string> wildcards_;
   std::set<std::string> exact_names_;  // find efficiently
+
+  // Special values of transitions_.
+  enum {
+    // No wildcard can match any more.
+    kDeadState = -1,
+    // Every name with the prefix is matched, e.g. after a trailing `*'.
+    kAcceptAllState = -2,
+  };
+
+  // Build the DFA, returns false if it has too many states.
+  bool Compile();
+
+  bool MatchByWildcards(const std::string& name) const;
+
+  // Characters which mean the same to all wildcards share a class.
+  uint8_t classes_[256];
+  int class_count_;
+  // transitions_[state * class_count_ + class] is `state * class_count_'
+  // of the next state or one of the special values above. The start state
+  // is 0.
+  std::vector<int32_t> transitions_;
+  // Whether the states are accepting.
+  std::vector<uint8_t> accept_;
+  bool compiled_;
 };
 
 } // namespace tutil
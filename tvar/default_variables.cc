@@ -0,0 +1,351 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 27 10:42:18 CST 2019
+
+#include "tvar/default_variables.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <string>
+
+#include <gflags/gflags.h>
+#include "tutil/time.h"
+#include "tvar/detail/sampler.h"
+#include "tvar/passive_status.h"
+
+namespace tesla {
+namespace tvar {
+
+DEFINE_bool(tvar_process_variables, true,
+            "Expose process_* and system_* variables read from /proc");
+
+namespace detail {
+
+namespace {
+
+struct ProcessStats {
+  double cpu_usage = 0;
+  double cpu_usage_user = 0;
+  double cpu_usage_system = 0;
+  int64_t memory_resident = 0;
+  int64_t memory_virtual = 0;
+  int64_t faults_minor = 0;
+  int64_t faults_major = 0;
+  int64_t fd_count = 0;
+  int64_t thread_count = 0;
+  int64_t context_switches_voluntary = 0;
+  int64_t context_switches_involuntary = 0;
+  int64_t io_read_bytes = 0;
+  int64_t io_write_bytes = 0;
+  int64_t disk_read_bytes = 0;
+  int64_t disk_write_bytes = 0;
+  int64_t network_receive_bytes = 0;
+  int64_t network_transmit_bytes = 0;
+};
+
+// Read the whole file of `fd' from the beginning into `buf'. Files under
+// /proc are generated again by every read from offset 0.
+bool ReadProcFile(int fd, std::string* buf) {
+  if (fd < 0) {
+    return false;
+  }
+  if (buf->size() < 4096) {
+    buf->resize(4096);
+  }
+  size_t n = 0;
+  while (true) {
+    const ssize_t nr = pread(fd, &(*buf)[n], buf->size() - n, n);
+    if (nr < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (nr == 0) {
+      break;
+    }
+    n += nr;
+    if (n == buf->size()) {
+      buf->resize(buf->size() * 2);
+    }
+  }
+  // Keep the capacity for the next read, terminate for sscanf().
+  (*buf)[n] = '\0';
+  return true;
+}
+
+// The number following `key' at the beginning of a line, 0 if absent.
+int64_t FindValue(const char* text, const char* key) {
+  const size_t key_len = strlen(key);
+  for (const char* p = text; p != nullptr && *p != '\0';) {
+    if (strncmp(p, key, key_len) == 0) {
+      return strtoll(p + key_len, nullptr, 10);
+    }
+    p = strchr(p, '\n');
+    if (p) {
+      ++p;
+    }
+  }
+  return 0;
+}
+
+// Sample /proc once per second. Files are opened once, the latest values
+// are read by the variables under a lock.
+class ProcessSampler : public Sampler {
+ public:
+  ProcessSampler()
+      : stat_fd_(open("/proc/self/stat", O_RDONLY | O_CLOEXEC)),
+        status_fd_(open("/proc/self/status", O_RDONLY | O_CLOEXEC)),
+        io_fd_(open("/proc/self/io", O_RDONLY | O_CLOEXEC)),
+        net_fd_(open("/proc/self/net/dev", O_RDONLY | O_CLOEXEC)),
+        fd_dir_(opendir("/proc/self/fd")),
+        page_size_(sysconf(_SC_PAGESIZE)),
+        ticks_per_second_(sysconf(_SC_CLK_TCK)) {
+    TakeSample();
+  }
+
+  void TakeSample() override;
+
+  template <typename T, T ProcessStats::*field>
+  static T Get(void* arg) {
+    ProcessSampler* sampler = static_cast<ProcessSampler*>(arg);
+    std::lock_guard<std::mutex> guard(sampler->stats_mutex_);
+    return sampler->stats_.*field;
+  }
+
+ private:
+  // Never destroyed, the files are closed at exit.
+  const int stat_fd_;
+  const int status_fd_;
+  const int io_fd_;
+  const int net_fd_;
+  DIR* const fd_dir_;
+  const int64_t page_size_;
+  const int64_t ticks_per_second_;
+
+  // Used by TakeSample() only.
+  std::string buf_;
+  uint64_t last_user_ticks_ = 0;
+  uint64_t last_system_ticks_ = 0;
+  int64_t last_sample_ns_ = 0;
+
+  std::mutex stats_mutex_;
+  ProcessStats stats_;  // protected by stats_mutex_
+};
+
+void ProcessSampler::TakeSample() {
+  ProcessStats s;
+  const int64_t now_ns = tutil::clock_ns();
+  if (ReadProcFile(stat_fd_, &buf_)) {
+    // The command name in parentheses may contain spaces.
+    const char* p = strrchr(buf_.c_str(), ')');
+    unsigned long minflt = 0, majflt = 0, utime = 0, stime = 0, vsize = 0;
+    long num_threads = 0, rss = 0;
+    if (p && sscanf(p + 1,
+                    " %*c %*d %*d %*d %*d %*d %*u %lu %*u %lu %*u %lu %lu"
+                    " %*d %*d %*d %*d %ld %*d %*u %lu %ld",
+                    &minflt, &majflt, &utime, &stime, &num_threads, &vsize,
+                    &rss) == 7) {
+      s.faults_minor = minflt;
+      s.faults_major = majflt;
+      s.thread_count = num_threads;
+      s.memory_virtual = vsize;
+      s.memory_resident = rss * page_size_;
+      if (last_sample_ns_ != 0 && now_ns > last_sample_ns_) {
+        const double ticks =
+            (now_ns - last_sample_ns_) / 1e9 * ticks_per_second_;
+        s.cpu_usage_user = (utime - last_user_ticks_) / ticks;
+        s.cpu_usage_system = (stime - last_system_ticks_) / ticks;
+        s.cpu_usage = s.cpu_usage_user + s.cpu_usage_system;
+      }
+      last_user_ticks_ = utime;
+      last_system_ticks_ = stime;
+      last_sample_ns_ = now_ns;
+    }
+  }
+  if (ReadProcFile(status_fd_, &buf_)) {
+    s.context_switches_voluntary =
+        FindValue(buf_.c_str(), "voluntary_ctxt_switches:");
+    s.context_switches_involuntary =
+        FindValue(buf_.c_str(), "nonvoluntary_ctxt_switches:");
+  }
+  // Not readable in some containers, left 0 then.
+  if (ReadProcFile(io_fd_, &buf_)) {
+    s.io_read_bytes = FindValue(buf_.c_str(), "rchar:");
+    s.io_write_bytes = FindValue(buf_.c_str(), "wchar:");
+    s.disk_read_bytes = FindValue(buf_.c_str(), "read_bytes:");
+    s.disk_write_bytes = FindValue(buf_.c_str(), "write_bytes:");
+  }
+  if (ReadProcFile(net_fd_, &buf_)) {
+    // Two lines of headers, then
+    //   eth0: rx_bytes rx_packets ... (8 numbers) tx_bytes ...
+    const char* line = strchr(buf_.c_str(), '\n');
+    line = line ? strchr(line + 1, '\n') : nullptr;
+    while (line != nullptr && *++line != '\0') {
+      const char* colon = strchr(line, ':');
+      if (colon == nullptr) {
+        break;
+      }
+      const char* name = line + strspn(line, " ");
+      uint64_t rx = 0, tx = 0;
+      if (!(colon - name == 2 && strncmp(name, "lo", 2) == 0) &&
+          sscanf(colon + 1, "%" SCNu64 " %*u %*u %*u %*u %*u %*u %*u %" SCNu64,
+                 &rx, &tx) == 2) {
+        s.network_receive_bytes += rx;
+        s.network_transmit_bytes += tx;
+      }
+      line = strchr(colon, '\n');
+    }
+  }
+  if (fd_dir_ != nullptr) {
+    rewinddir(fd_dir_);
+    int64_t count = 0;
+    while (struct dirent* ent = readdir(fd_dir_)) {
+      if (ent->d_name[0] != '.') {
+        ++count;
+      }
+    }
+    // Without the fd of `fd_dir_' itself.
+    s.fd_count = count - 1;
+  }
+
+  std::lock_guard<std::mutex> guard(stats_mutex_);
+  stats_ = s;
+}
+
+// Variables over one ProcessSampler.
+class DefaultVariables {
+ public:
+  DefaultVariables()
+      : sampler_(new ProcessSampler),
+        cpu_usage_(
+            "process_cpu_usage",
+            &ProcessSampler::Get<double, &ProcessStats::cpu_usage>, sampler_),
+        cpu_usage_user_(
+            "process_cpu_usage_user",
+            &ProcessSampler::Get<double, &ProcessStats::cpu_usage_user>,
+            sampler_),
+        cpu_usage_system_(
+            "process_cpu_usage_system",
+            &ProcessSampler::Get<double, &ProcessStats::cpu_usage_system>,
+            sampler_),
+        memory_resident_(
+            "process_memory_resident",
+            &ProcessSampler::Get<int64_t, &ProcessStats::memory_resident>,
+            sampler_),
+        memory_virtual_(
+            "process_memory_virtual",
+            &ProcessSampler::Get<int64_t, &ProcessStats::memory_virtual>,
+            sampler_),
+        faults_minor_(
+            "process_faults_minor",
+            &ProcessSampler::Get<int64_t, &ProcessStats::faults_minor>,
+            sampler_),
+        faults_major_(
+            "process_faults_major",
+            &ProcessSampler::Get<int64_t, &ProcessStats::faults_major>,
+            sampler_),
+        fd_count_(
+            "process_fd_count",
+            &ProcessSampler::Get<int64_t, &ProcessStats::fd_count>, sampler_),
+        thread_count_(
+            "process_thread_count",
+            &ProcessSampler::Get<int64_t, &ProcessStats::thread_count>,
+            sampler_),
+        context_switches_voluntary_(
+            "process_context_switches_voluntary",
+            &ProcessSampler::Get<int64_t,
+                                 &ProcessStats::context_switches_voluntary>,
+            sampler_),
+        context_switches_involuntary_(
+            "process_context_switches_involuntary",
+            &ProcessSampler::Get<int64_t,
+                                 &ProcessStats::context_switches_involuntary>,
+            sampler_),
+        io_read_bytes_(
+            "process_io_read_bytes",
+            &ProcessSampler::Get<int64_t, &ProcessStats::io_read_bytes>,
+            sampler_),
+        io_write_bytes_(
+            "process_io_write_bytes",
+            &ProcessSampler::Get<int64_t, &ProcessStats::io_write_bytes>,
+            sampler_),
+        disk_read_bytes_(
+            "process_disk_read_bytes",
+            &ProcessSampler::Get<int64_t, &ProcessStats::disk_read_bytes>,
+            sampler_),
+        disk_write_bytes_(
+            "process_disk_write_bytes",
+            &ProcessSampler::Get<int64_t, &ProcessStats::disk_write_bytes>,
+            sampler_),
+        network_receive_bytes_(
+            "system_network_receive_bytes",
+            &ProcessSampler::Get<int64_t,
+                                 &ProcessStats::network_receive_bytes>,
+            sampler_),
+        network_transmit_bytes_(
+            "system_network_transmit_bytes",
+            &ProcessSampler::Get<int64_t,
+                                 &ProcessStats::network_transmit_bytes>,
+            sampler_) {
+    sampler_->Schedule();
+  }
+
+ private:
+  ProcessSampler* sampler_;
+  PassiveStatus<double> cpu_usage_;
+  PassiveStatus<double> cpu_usage_user_;
+  PassiveStatus<double> cpu_usage_system_;
+  PassiveStatus<int64_t> memory_resident_;
+  PassiveStatus<int64_t> memory_virtual_;
+  PassiveStatus<int64_t> faults_minor_;
+  PassiveStatus<int64_t> faults_major_;
+  PassiveStatus<int64_t> fd_count_;
+  PassiveStatus<int64_t> thread_count_;
+  PassiveStatus<int64_t> context_switches_voluntary_;
+  PassiveStatus<int64_t> context_switches_involuntary_;
+  PassiveStatus<int64_t> io_read_bytes_;
+  PassiveStatus<int64_t> io_write_bytes_;
+  PassiveStatus<int64_t> disk_read_bytes_;
+  PassiveStatus<int64_t> disk_write_bytes_;
+  PassiveStatus<int64_t> network_receive_bytes_;
+  PassiveStatus<int64_t> network_transmit_bytes_;
+};
+
+std::once_flag kDefaultVariablesOnce;
+
+} // namespace
+
+void ExposeDefaultVariables() {
+  if (!FLAGS_tvar_process_variables) {
+    return;
+  }
+  // Exposing must call no *_exposed(), which would enter the once flag
+  // again. Names taken already are reported and left to their owners. The
+  // variables live until exit.
+  std::call_once(kDefaultVariablesOnce, [] { new DefaultVariables; });
+}
+
+} // namespace detail
+} // namespace tvar
+} // namespace tesla
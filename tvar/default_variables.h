@@ -0,0 +1,57 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 27 10:42:18 CST 2019
+
+#ifndef TESLA_TVAR_DEFAULT_VARIABLES_H_
+#define TESLA_TVAR_DEFAULT_VARIABLES_H_
+
+namespace tesla {
+namespace tvar {
+
+// Health of the process, read from /proc and exposed as soon as variables
+// are listed, described or dumped, unless --tvar_process_variables is
+// false:
+//   process_cpu_usage                     cores used in the last second
+//   process_cpu_usage_user                ... in user mode
+//   process_cpu_usage_system              ... in kernel mode
+//   process_memory_resident               resident set in bytes
+//   process_memory_virtual                virtual memory in bytes
+//   process_faults_minor                  page faults since the start
+//   process_faults_major                  ... which needed disk I/O
+//   process_fd_count                      open file descriptors
+//   process_thread_count
+//   process_context_switches_voluntary    since the start
+//   process_context_switches_involuntary  since the start
+//   process_io_read_bytes                 read by syscalls, e.g. sockets
+//   process_io_write_bytes
+//   process_disk_read_bytes               fetched from the storage
+//   process_disk_write_bytes
+//   system_network_receive_bytes          of all interfaces but lo
+//   system_network_transmit_bytes
+// The sampler thread refreshes all of them once per second from /proc
+// files kept open, so dumping them reads no file.
+
+namespace detail {
+
+// Expose the variables above once. Called by Variable::*_exposed().
+void ExposeDefaultVariables();
+
+} // namespace detail
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_DEFAULT_VARIABLES_H_
@@ -18,13 +18,16 @@
 #ifndef TESLA_TVAR_DETAIL_AGENT_GROUP_H_
 #define TESLA_TVAR_DETAIL_AGENT_GROUP_H_
 
+#include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <deque>
-#include <mutex>
+#include <atomic>
 #include <memory>
+#include <new>
 #include <vector>
 
 #include "tutil/compiler_specific.h"
+#include "tutil/containers/linked_list.h"
 #include "log/logging.h"
 
 namespace tesla {
@@ -32,8 +35,6 @@ namespace tvar {
 namespace detail {
 
 using AgentId = int;
-using AgentIdQueue = std::deque<AgentId>;
-using AgentIdQueuePtr = std::unique_ptr<AgentIdQueue>;
 
 template <typename Agent>
 class AgentGroup {
@@ -58,43 +59,55 @@ class AgentGroup {
     Agent agents_[kElementPerBlock];
   };
 
+  // Ids are allocated without locks. New ids come from a counter, ids given
+  // back by DestroyAgent() are kept in a stack and reused last in first out
+  // to improve cache hit. The stack links the ids through slots which are
+  // never freed, its head carries a version against ABA:
+  //   | version (32 bits) | id + 1 (32 bits, 0 if the stack is empty) |
   inline static AgentId CreateNewAgent() {
-    std::lock_guard<std::mutex> lock(s_mutex_);
-    AgentId agent_id = 0;
-    if (!GetFreeIds().empty()) {
-      // Last in first out to improve cache hit.
-      agent_id = GetFreeIds().back();
-      GetFreeIds().pop_back();
-    } else {
-      agent_id = s_agent_kinds_++; 
-    }
-    return agent_id;
+    uint64_t head = s_free_head_.load(std::memory_order_acquire);
+    while (head & kFreeIdMask) {
+      const AgentId id = static_cast<AgentId>((head & kFreeIdMask) - 1);
+      // The slot may be changed once `id' is popped by another thread,
+      // the version of the head makes the CAS fail then.
+      const uint64_t next = GetFreeSlot(id)->load(std::memory_order_relaxed);
+      if (s_free_head_.compare_exchange_weak(head, NextVersion(head) | next,
+                                             std::memory_order_acquire,
+                                             std::memory_order_acquire)) {
+        return id;
+      }
+    }
+    const AgentId id = s_agent_kinds_.fetch_add(1, std::memory_order_relaxed);
+    if (id >= kMaxAgentKinds || GetOrCreateFreeSlot(id) == nullptr) {
+      LOG_ERROR << "Fail to create agent id=" << id;
+      return -1;
+    }
+    return id;
   }
 
   inline static int DestroyAgent(AgentId id) {
-    std::lock_guard<std::mutex> lock(s_mutex_);
-    if (id < 0 || id >= s_agent_kinds_) {
+    if (id < 0 || id >= s_agent_kinds_.load(std::memory_order_relaxed) ||
+        id >= kMaxAgentKinds) {
       errno = EINVAL;
       return -1;
     }
-    GetFreeIds().push_back(id);
+    std::atomic<uint64_t>* slot = GetFreeSlot(id);
+    uint64_t head = s_free_head_.load(std::memory_order_relaxed);
+    do {
+      slot->store(head & kFreeIdMask, std::memory_order_relaxed);
+    } while (!s_free_head_.compare_exchange_weak(
+        head, NextVersion(head) | static_cast<uint64_t>(id + 1),
+        std::memory_order_release, std::memory_order_relaxed));
     return 0;
   }
 
-  // Calculates location of the agent by its id:
-  //   block_id = id / kElementPerBlock;
-  //   agent_id = id - block_id * kElementPerBlock;
+  // The hot path: agents of the calling thread are indexed by id in a flat
+  // array, so this is one load of thread_local and one indexed load.
+  // The thread_locals are trivial, which saves the call to the TLS wrapper.
   inline static Agent* GetTlsAgent(AgentId id) {
-    if (TESLA_LIKELY(id >= 0)) {
-      if (s_tls_blocks_) {
-        const size_t block_id = static_cast<size_t>(id) / kElementPerBlock;
-        if (block_id < s_tls_blocks_->size()) {
-          std::unique_ptr<ThreadBlock>& block = (*s_tls_blocks_)[block_id];       
-          if (block) {
-            return block->at(id - block_id * kElementPerBlock);
-          }
-        }
-      } 
+    // A negative id becomes a huge index.
+    if (TESLA_LIKELY(static_cast<size_t>(id) < s_tls_agent_count_)) {
+      return s_tls_agents_[id];
     }
     return nullptr;
   }
@@ -105,67 +118,163 @@ class AgentGroup {
       LOG_ERROR << "Invalid id=" << id;
       return NULL;
     }
+    Agent* agent = GetTlsAgent(id);
+    if (agent) {
+      return agent;
+    }
 
-    if (s_tls_blocks_ == nullptr) {
-      s_tls_blocks_ = std::make_unique<std::vector<std::unique_ptr<ThreadBlock>>>();
-      if (__builtin_expect(s_tls_blocks_ == nullptr, 0)) {
-        LOG_ERROR << "Fail to create vector";
+    if (s_tls_owner_ == nullptr) {
+      s_tls_owner_.reset(new (std::nothrow) ThreadAgents);
+      if (s_tls_owner_ == nullptr) {
+        LOG_ERROR << "Fail to create thread agents";
         return NULL;
       }
-      //LOG_INFO << "The address of s_tls_blocks_ is " << s_tls_blocks_.get();
     }
+    ThreadAgents* owner = s_tls_owner_.get();
 
     const size_t block_id = size_t(id) / kElementPerBlock;
-    if (block_id >= s_tls_blocks_->size()) {
+    if (block_id >= owner->blocks.size()) {
       // The 32ul avoid pointless small resizes.
-      s_tls_blocks_->resize(std::max(block_id + 1, 32ul));
+      owner->blocks.resize(std::max(block_id + 1, 32ul));
     }
-    std::unique_ptr<ThreadBlock>& block = (*s_tls_blocks_)[block_id];
+    std::unique_ptr<ThreadBlock>& block = owner->blocks[block_id];
     if (block == nullptr) {
-      std::unique_ptr<ThreadBlock> new_block = std::make_unique<ThreadBlock>();
-      if (__builtin_expect(new_block == nullptr, 0)) {
+      block.reset(new (std::nothrow) ThreadBlock);
+      if (block == nullptr) {
         LOG_ERROR << "Fail to create thread block";
         return NULL;
       }
-      block = std::move(new_block);
-      //LOG_INFO << "The address of block is " << block.get();
     }
-    return block->at(id - block_id * kElementPerBlock);
+    // Index all agents of the block.
+    const size_t first = block_id * kElementPerBlock;
+    if (first + kElementPerBlock > owner->index.size()) {
+      owner->index.resize(std::max(first + kElementPerBlock,
+                                   owner->index.size() * 2));
+    }
+    for (size_t i = 0; i < kElementPerBlock; ++i) {
+      owner->index[first + i] = block->at(i);
+    }
+    s_tls_agents_ = owner->index.data();
+    s_tls_agent_count_ = owner->index.size();
+    return block->at(id - first);
   }
 
  private:
+  constexpr static size_t kFreeSlotsPerBlock = 1024;
+  constexpr static size_t kMaxFreeSlotBlocks = 1024;
+  constexpr static AgentId kMaxAgentKinds =
+      kFreeSlotsPerBlock * kMaxFreeSlotBlocks;
+  constexpr static uint64_t kFreeIdMask = 0xFFFFFFFFULL;
+
+  inline static uint64_t NextVersion(uint64_t head) {
+    return ((head >> 32) + 1) << 32;
+  }
 
-  inline static AgentIdQueue& GetFreeIds() {
-    if (__builtin_expect(s_free_ids_ == nullptr, 0)) {
-      s_free_ids_.reset(new AgentIdQueue());
-      if (s_free_ids_ == nullptr) {
-        abort();
+  // The slot of an id which has been created.
+  inline static std::atomic<uint64_t>* GetFreeSlot(AgentId id) {
+    std::atomic<uint64_t>* block =
+        s_free_slots_[id / kFreeSlotsPerBlock].load(std::memory_order_acquire);
+    return block + id % kFreeSlotsPerBlock;
+  }
+
+  inline static std::atomic<uint64_t>* GetOrCreateFreeSlot(AgentId id) {
+    std::atomic<std::atomic<uint64_t>*>& entry =
+        s_free_slots_[id / kFreeSlotsPerBlock];
+    std::atomic<uint64_t>* block = entry.load(std::memory_order_acquire);
+    if (block == nullptr) {
+      std::atomic<uint64_t>* new_block =
+          new (std::nothrow) std::atomic<uint64_t>[kFreeSlotsPerBlock]();
+      if (new_block == nullptr) {
+        return nullptr;
+      }
+      if (entry.compare_exchange_strong(block, new_block,
+                                        std::memory_order_acq_rel)) {
+        block = new_block;
+      } else {
+        // Another thread installed the block first.
+        delete[] new_block;
       }
     }
-    return *s_free_ids_;
+    return block + id % kFreeSlotsPerBlock;
   }
-  
-  using ThreadBlockPtr = std::unique_ptr<ThreadBlock>;
-  using ThreadBlockVectorPtr = std::unique_ptr<std::vector<ThreadBlockPtr>>;
-
-  static std::mutex                           s_mutex_;
-  static AgentId                              s_agent_kinds_;
-  static AgentIdQueuePtr                      s_free_ids_;
-  static thread_local ThreadBlockVectorPtr    s_tls_blocks_;
+
+  // Owns the agents of one thread, destroyed when the thread exits.
+  struct ThreadAgents {
+    ~ThreadAgents() {
+      // Lookups from now on find no agent of this thread.
+      s_tls_agents_ = nullptr;
+      s_tls_agent_count_ = 0;
+      blocks.clear();
+    }
+
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+    // Agents of `blocks' by id, nullptr for ids whose block is not created.
+    std::vector<Agent*> index;
+  };
+
+  static std::atomic<AgentId>                 s_agent_kinds_;
+  static std::atomic<uint64_t>                s_free_head_;
+  static std::atomic<std::atomic<uint64_t>*>  s_free_slots_[kMaxFreeSlotBlocks];
+  static thread_local Agent**                 s_tls_agents_;
+  static thread_local size_t                  s_tls_agent_count_;
+  static thread_local std::unique_ptr<ThreadAgents> s_tls_owner_;
 };
 
 template <typename Agent>
-std::mutex AgentGroup<Agent>::s_mutex_;
+std::atomic<AgentId> AgentGroup<Agent>::s_agent_kinds_{0};
+
+template <typename Agent>
+std::atomic<uint64_t> AgentGroup<Agent>::s_free_head_{0};
+
+template <typename Agent>
+std::atomic<std::atomic<uint64_t>*>
+AgentGroup<Agent>::s_free_slots_[AgentGroup<Agent>::kMaxFreeSlotBlocks];
+
+template <typename Agent>
+thread_local Agent** AgentGroup<Agent>::s_tls_agents_ = nullptr;
 
 template <typename Agent>
-AgentId AgentGroup<Agent>::s_agent_kinds_ = 0;
+thread_local size_t AgentGroup<Agent>::s_tls_agent_count_ = 0;
 
 template <typename Agent>
-AgentIdQueuePtr AgentGroup<Agent>::s_free_ids_ = nullptr;
+thread_local std::unique_ptr<typename AgentGroup<Agent>::ThreadAgents>
+AgentGroup<Agent>::s_tls_owner_;
 
+// Agents which threads registered without taking the lock of their
+// combiner. They are moved into the list of the combiner by whoever holds
+// that lock next, so registration is one CAS while readers, exiting
+// threads and the destructor keep working on a plain list.
+// Agent needs a member `Agent* next_pending'.
 template <typename Agent>
-thread_local typename AgentGroup<Agent>::ThreadBlockVectorPtr
-AgentGroup<Agent>::s_tls_blocks_ = nullptr;
+class PendingAgents {
+ public:
+  void Push(Agent* agent) {
+    Agent* head = head_.load(std::memory_order_relaxed);
+    do {
+      agent->next_pending = head;
+    } while (!head_.compare_exchange_weak(head, agent,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  // Must be called with the lock of the combiner held.
+  void MoveTo(tutil::LinkedList<Agent>* list) {
+    // Mostly nothing is pending, avoid writing the cache line then.
+    if (head_.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+    Agent* agent = head_.exchange(nullptr, std::memory_order_acquire);
+    while (agent) {
+      Agent* next = agent->next_pending;
+      agent->next_pending = nullptr;
+      list->Append(agent);
+      agent = next;
+    }
+  }
+
+ private:
+  std::atomic<Agent*> head_{nullptr};
+};
 
 } // namespace detail
 } // namespace tvar
@@ -26,7 +26,7 @@ namespace detail {
 // set the result to the first parameter in-place. Namely to add two values,
 // "+=" should be implemented rather than "+".
 template <typename Operator, typename T1, typename T2>
-inline void call_op_returning_void(const Operator& op, T1& v1, T2& v2) {
+inline void call_op_returning_void(const Operator& op, T1& v1, const T2& v2) {
   return op(v1, v2);
 }
 
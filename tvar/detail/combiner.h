@@ -18,9 +18,12 @@
 #ifndef TESLA_TVAR_DETAIL_COMBINER_H_
 #define TESLA_TVAR_DETAIL_COMBINER_H_
 
+#include <string.h>     // memcpy
+
 #include <atomic>       // std::atomic
 #include <mutex>        // std::mutex std::lock_guard
-#include <type_traits>  // std::enable_if
+#include <thread>       // std::this_thread::yield
+#include <type_traits>  // std::enable_if std::is_integral
 
 #include "log/logging.h"
 #include "tutil/containers/linked_list.h"
@@ -33,6 +36,11 @@ namespace tesla {
 namespace tvar {
 namespace detail {
 
+// True if applying Op to a T is the same as one atomic fetch_add, e.g.
+// AddTo<int>. Specialized next to such ops.
+template <typename Op, typename T>
+struct IsAtomicAdd : std::false_type {};
+
 // Parameter to merge_global.
 template <typename Combiner>
 class GlobalValue {
@@ -69,6 +77,13 @@ class GlobalValue {
   Combiner* combiner_{nullptr};
 };
 
+// Composite values which can be copied bytewise, e.g. a struct of two
+// counters.
+template <typename T>
+struct is_seqlockable
+    : std::integral_constant<bool, (!is_atomical<T>::value &&
+                                    std::is_trivially_copyable<T>::value)> {};
+
 // Abstraction of tls element whose operations are all atomic.
 template <typename T, typename Enable = void>
 class ElementContainer {
@@ -124,22 +139,33 @@ class ElementContainer<T,
   }
 
   void exchange(T* old_value, T new_value) {
-    *old_value = value_.exchage(new_value, std::memory_order_relaxed);
+    *old_value = value_.exchange(new_value, std::memory_order_relaxed);
   }
 
   // Note: we must ensure that modify is a atomic operation.
   template <typename Op, typename T2>
   void modify(const Op& op, const T2& v2) {
-    T old_value;
+    if constexpr (IsAtomicAdd<Op, T>::value) {
+      value_.fetch_add(v2, std::memory_order_relaxed);
+      return;
+    }
+    T old_value = value_.load(std::memory_order_relaxed);
     T new_value;
     // There's a contention with the reset operation of combiner,
     // if the tls valus has been modified during op_, the
-    // compare_exchange_weak operation will fail and recalculation
-    // is to be processed according to the new version of value.
+    // compare_exchange_weak operation will fail (and reload `old_value')
+    // and recalculation is to be processed according to the new version
+    // of value.
     do {
-      old_value = value_.load(std::memory_order_relaxed);
       new_value = old_value;
       call_op_returning_void(op, new_value, v2);
+      // Nothing to write, e.g. Maxer with a smaller value. Floating
+      // points just take the CAS, == on them is not an identity test.
+      if constexpr (std::is_integral<T>::value) {
+        if (new_value == old_value) {
+          return;
+        }
+      }
     } while (!value_.compare_exchange_weak(old_value, new_value,
                                            std::memory_order_relaxed));
   }
@@ -154,6 +180,104 @@ class ElementContainer<T,
   std::atomic<T> value_;
 };
 
+// For composite values a seqlock replaces the mutex. Readers copy the value
+// optimistically and retry if a writer was active meanwhile, so
+// CombineAllAgents() never blocks the thread owning the agent. The owner is
+// the only writer except for resets, so making the sequence odd is an
+// uncontended compare-and-swap in practice.
+template <typename T>
+class ElementContainer<
+    T, typename std::enable_if<is_seqlockable<T>::value>::type> {
+ public:
+  ElementContainer() : seq_(0) { Write(T()); }
+
+  void load(T* out) {
+    for (;;) {
+      const uint64_t seq = seq_.load(std::memory_order_acquire);
+      if ((seq & 1) == 0) {
+        Read(out);
+        // Keep the loads of words above the check below.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == seq) {
+          return;
+        }
+      } else {
+        // The writer may have been preempted.
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void store(const T& new_value) {
+    const uint64_t seq = BeginWrite();
+    Write(new_value);
+    EndWrite(seq);
+  }
+
+  void exchange(T* old_value, const T& new_value) {
+    const uint64_t seq = BeginWrite();
+    Read(old_value);
+    Write(new_value);
+    EndWrite(seq);
+  }
+
+  template <typename Op, typename T2>
+  void modify(const Op& op, const T2& v2) {
+    const uint64_t seq = BeginWrite();
+    T value;
+    Read(&value);
+    call_op_returning_void(op, value, v2);
+    Write(value);
+    EndWrite(seq);
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+
+  // Make the sequence odd. Returns the odd sequence.
+  uint64_t BeginWrite() {
+    uint64_t seq = seq_.load(std::memory_order_relaxed);
+    for (;;) {
+      if (seq & 1) {
+        std::this_thread::yield();
+        seq = seq_.load(std::memory_order_relaxed);
+      } else if (seq_.compare_exchange_weak(seq, seq + 1,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    // Readers must not see the words below before the odd sequence.
+    std::atomic_thread_fence(std::memory_order_release);
+    return seq + 1;
+  }
+
+  void EndWrite(uint64_t seq) {
+    seq_.store(seq + 1, std::memory_order_release);
+  }
+
+  // The words are atomics so that racing with a writer is not undefined,
+  // a torn copy is thrown away by the sequence check.
+  void Read(T* out) const {
+    uint64_t buf[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+      buf[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    memcpy(out, buf, sizeof(T));
+  }
+
+  void Write(const T& value) {
+    uint64_t buf[kWords] = {0};
+    memcpy(buf, &value, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> seq_;
+  std::atomic<uint64_t> words_[kWords];
+};
+
 template <typename ResultTp, typename ElementTp, typename BinaryOp>
 class AgentCombiner {
  public:
@@ -188,6 +312,8 @@ class AgentCombiner {
 
     self_type* combiner{nullptr};
     ElementContainer<ElementTp> element;
+    // Link of PendingAgents.
+    Agent* next_pending{nullptr};
   };  // struct Agent
 
   using AgentGroup = detail::AgentGroup<Agent>;
@@ -241,10 +367,7 @@ class AgentCombiner {
       return agent;
     }
     agent->reset(element_identity_, this);
-    {
-      std::lock_guard<std::mutex> guard(lock_);
-      agents_.Append(agent);
-    }
+    pending_agents_.Push(agent);
     return agent;
   }
 
@@ -256,6 +379,8 @@ class AgentCombiner {
 
     ElementTp local;
     std::lock_guard<std::mutex> guard(lock_);
+    // The agent may be still pending.
+    pending_agents_.MoveTo(&agents_);
     agent->element.load(&local);
     call_op_returning_void(op_, global_result_, local);
     agent->RemoveFromList();
@@ -271,7 +396,7 @@ class AgentCombiner {
 
     ElementTp prev;
     std::lock_guard<std::mutex> guard(lock_);
-    agent->element.exchage(&prev, element_identity_);
+    agent->element.exchange(&prev, element_identity_);
     call_op_returning_void(op_, global_result_, prev);
   }
 
@@ -279,6 +404,7 @@ class AgentCombiner {
   ResultTp CombineAllAgents() const {
     ElementTp tls_value;
     std::lock_guard<std::mutex> guard(lock_);
+    pending_agents_.MoveTo(&agents_);
     // If there's a thread exiting before destructing AgentCombiner, it's
     // Agent will be added to `global_result_' by call_op_returning_void.
     ResultTp ret = global_result_;
@@ -291,9 +417,10 @@ class AgentCombiner {
   }
 
   // [Threadsafe] May be called from anywhere.
-  ResultTp ResetAllAgents() const {
+  ResultTp ResetAllAgents() {
     ElementTp prev;
     std::lock_guard<std::mutex> guard(lock_);
+    pending_agents_.MoveTo(&agents_);
     ResultTp ret = global_result_;
     global_result_ = result_identity_;
     for (tutil::LinkNode<Agent>* node = agents_.head(); node != agents_.end();
@@ -306,6 +433,7 @@ class AgentCombiner {
 
   void ClearAllAgents() {
     std::lock_guard<std::mutex> guard(lock_);
+    pending_agents_.MoveTo(&agents_);
     // Reseting agents is necessary because the agent object may be reused.
     // Set element to be default-constructed so that if it's non-pod,
     // internal allocations should be released.
@@ -325,8 +453,11 @@ class AgentCombiner {
   ResultTp result_identity_;
   ElementTp element_identity_;
   mutable std::mutex lock_;
-  tutil::LinkedList<Agent>
-      agents_;  // A double linked list contained all using agents.
+  // A double linked list contained all using agents, guarded by lock_.
+  // Newly registered agents wait in pending_agents_ until the next holder
+  // of lock_ moves them in.
+  mutable tutil::LinkedList<Agent> agents_;
+  mutable PendingAgents<Agent> pending_agents_;
 };
 
 }  // namespace detail
@@ -0,0 +1,56 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Oct 19 10:12:31 CST 2019
+
+#ifndef TESLA_TVAR_DETAIL_DESCRIBE_VALUE_H_
+#define TESLA_TVAR_DETAIL_DESCRIBE_VALUE_H_
+
+#include <ostream>
+#include <type_traits>
+
+#include "log/logstream.h"
+#include "tutil/strings/integer_format.h"
+
+namespace tesla {
+namespace tvar {
+namespace detail {
+
+// Print `value' into `os'. Floating point values are printed with the
+// shortest digits which read back to the same value (same as LogStream),
+// instead of the 6 significant digits of std::ostream. Integers skip the
+// locale machinery of std::ostream. bool and char-sized types keep the
+// std::ostream behavior.
+template <typename T>
+inline void DescribeValue(std::ostream& os, const T& value) {
+  if constexpr (std::is_integral<T>::value && sizeof(T) > 1) {
+    char buf[24];
+    os.write(buf, ::tutil::FormatInteger(buf, value));
+  } else if constexpr (std::is_same<T, double>::value) {
+    char buf[32];
+    os.write(buf, log::FormatDouble(buf, value));
+  } else if constexpr (std::is_same<T, float>::value) {
+    char buf[32];
+    os.write(buf, log::FormatFloat(buf, value));
+  } else {
+    os << value;
+  }
+}
+
+} // namespace detail
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_DETAIL_DESCRIBE_VALUE_H_
@@ -0,0 +1,159 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 21 20:12:37 CST 2019
+
+#include "tvar/detail/percentile.h"
+
+#include <math.h>
+
+#include "log/logging.h"
+
+namespace tesla {
+namespace tvar {
+namespace detail {
+
+uint32_t PercentileHistogram::GetNumber(double ratio) const {
+  // num_ is loaded from the threads apart from the buckets, do not mix.
+  uint64_t total = 0;
+  for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+    total += counts_[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  if (ratio < 0) {
+    ratio = 0;
+  } else if (ratio > 1) {
+    ratio = 1;
+  }
+  uint64_t rank = static_cast<uint64_t>(ceil(ratio * total));
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return GetBucketLowerBound(i) + (GetBucketWidth(i) - 1) / 2;
+    }
+  }
+  return std::numeric_limits<uint32_t>::max();
+}
+
+Percentile::Percentile()
+    : id_(AgentGroup::CreateNewAgent()), sampler_(nullptr) {}
+
+Percentile::~Percentile() {
+  if (sampler_) {
+    sampler_->Destroy();
+    sampler_ = nullptr;
+  }
+  if (id_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pending_agents_.MoveTo(&agents_);
+    // The agents may be reused by the next owner of id_.
+    for (tutil::LinkNode<Agent>* node = agents_.head();
+         node != agents_.end();) {
+      node->value()->owner = nullptr;
+      tutil::LinkNode<Agent>* const saved_next = node->next();
+      node->RemoveFromList();
+      node = saved_next;
+    }
+  }
+  AgentGroup::DestroyAgent(id_);
+  id_ = -1;
+}
+
+Percentile::Agent* Percentile::GetOrCreateTlsAgent() {
+  Agent* agent = AgentGroup::GetOrCreateTlsAgent(id_);
+  if (agent == nullptr) {
+    LOG_ERROR << "Fail to create agent";
+    return nullptr;
+  }
+  if (agent->owner) {
+    return agent;
+  }
+  // Nobody else reads the agent before it is pushed.
+  agent->num.store(0, std::memory_order_relaxed);
+  agent->sum.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+    agent->counts[i].store(0, std::memory_order_relaxed);
+  }
+  agent->owner = this;
+  pending_agents_.Push(agent);
+  return agent;
+}
+
+void Percentile::CommitAndErase(Agent* agent) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // The agent may be still pending.
+  pending_agents_.MoveTo(&agents_);
+  AddAgent(*agent, &global_);
+  agent->RemoveFromList();
+}
+
+void Percentile::AddAgent(const Agent& agent, PercentileHistogram* histogram) {
+  for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+    histogram->Add(i, agent.counts[i].load(std::memory_order_relaxed));
+  }
+  histogram->AddTotal(agent.num.load(std::memory_order_relaxed),
+                      agent.sum.load(std::memory_order_relaxed));
+}
+
+PercentileHistogram Percentile::GetValue() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  pending_agents_.MoveTo(&agents_);
+  PercentileHistogram result = global_;
+  for (tutil::LinkNode<Agent>* node = agents_.head(); node != agents_.end();
+       node = node->next()) {
+    AddAgent(*node->value(), &result);
+  }
+  return result;
+}
+
+uint64_t Percentile::GetNum() const {
+  uint64_t num = 0;
+  uint64_t sum = 0;
+  GetTotal(&num, &sum);
+  return num;
+}
+
+void Percentile::GetTotal(uint64_t* num, uint64_t* sum) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  pending_agents_.MoveTo(&agents_);
+  *num = global_.num();
+  *sum = global_.sum();
+  for (tutil::LinkNode<Agent>* node = agents_.head(); node != agents_.end();
+       node = node->next()) {
+    *num += node->value()->num.load(std::memory_order_relaxed);
+    *sum += node->value()->sum.load(std::memory_order_relaxed);
+  }
+}
+
+Percentile::sampler_type* Percentile::get_sampler() {
+  if (sampler_ == nullptr) {
+    sampler_ = new sampler_type(this);
+    sampler_->Schedule();
+  }
+  return sampler_;
+}
+
+} // namespace detail
+} // namespace tvar
+} // namespace tesla
@@ -0,0 +1,238 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 21 20:12:37 CST 2019
+
+#ifndef TESLA_TVAR_DETAIL_PERCENTILE_H_
+#define TESLA_TVAR_DETAIL_PERCENTILE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+#include "tutil/compiler_specific.h"
+#include "tutil/containers/linked_list.h"
+#include "tvar/detail/agent_group.h"
+#include "tvar/detail/sampler.h"
+
+namespace tesla {
+namespace tvar {
+namespace detail {
+
+// Values are put into log-linear buckets like HdrHistogram: values below
+// 32 have a bucket each, every larger power of two [2^e, 2^(e+1)) is split
+// into 32 buckets of the same width. So the relative error of a
+// percentile is at most 1/64 (the middle of a bucket is reported) while
+// the whole uint32_t range needs 896 buckets.
+constexpr int kSubBucketBits = 5;
+constexpr uint32_t kSubBucketCount = 1u << kSubBucketBits;
+constexpr size_t kPercentileBucketCount =
+    (32 - kSubBucketBits + 1) * kSubBucketCount;
+
+inline size_t GetBucketIndex(uint32_t value) {
+  if (value < kSubBucketCount) {
+    return value;
+  }
+  const int e = 31 - __builtin_clz(value);
+  return (e - kSubBucketBits + 1) * kSubBucketCount +
+         ((value >> (e - kSubBucketBits)) - kSubBucketCount);
+}
+
+// The smallest value in bucket `index'.
+inline uint32_t GetBucketLowerBound(size_t index) {
+  if (index < kSubBucketCount) {
+    return static_cast<uint32_t>(index);
+  }
+  const int shift = static_cast<int>(index / kSubBucketCount) - 1;
+  return (kSubBucketCount + index % kSubBucketCount) << shift;
+}
+
+inline uint32_t GetBucketWidth(size_t index) {
+  return index < 2 * kSubBucketCount
+             ? 1u
+             : 1u << (index / kSubBucketCount - 1);
+}
+
+// Counts of values in every bucket, plus the number and the sum of all
+// values. Counters may wrap around, but the difference of two snapshots is
+// right as long as less than 2^32 values fall into one bucket in between,
+// which is all windows need.
+class PercentileHistogram {
+ public:
+  PercentileHistogram() : num_(0), sum_(0) {
+    memset(counts_, 0, sizeof(counts_));
+  }
+
+  uint32_t count(size_t index) const { return counts_[index]; }
+
+  uint64_t num() const { return num_; }
+
+  uint64_t sum() const { return sum_; }
+
+  // Average of all values, 0 if the histogram is empty.
+  int64_t GetAverage() const { return num_ == 0 ? 0 : sum_ / num_; }
+
+  void Add(size_t index, uint32_t n) { counts_[index] += n; }
+
+  void AddTotal(uint64_t num, uint64_t sum) {
+    num_ += num;
+    sum_ += sum;
+  }
+
+  void Merge(const PercentileHistogram& rhs) {
+    for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+      counts_[i] += rhs.counts_[i];
+    }
+    num_ += rhs.num_;
+    sum_ += rhs.sum_;
+  }
+
+  void Subtract(const PercentileHistogram& rhs) {
+    for (size_t i = 0; i < kPercentileBucketCount; ++i) {
+      counts_[i] -= rhs.counts_[i];
+    }
+    num_ -= rhs.num_;
+    sum_ -= rhs.sum_;
+  }
+
+  // Get the value which is greater than or equal to `ratio' (in [0, 1]) of
+  // all values, e.g. 0.99 for p99. Returns 0 if the histogram is empty.
+  uint32_t GetNumber(double ratio) const;
+
+ private:
+  uint32_t counts_[kPercentileBucketCount];
+  uint64_t num_;
+  uint64_t sum_;
+};
+
+struct HistogramAdd {
+  void operator()(PercentileHistogram& lhs,
+                  const PercentileHistogram& rhs) const {
+    lhs.Merge(rhs);
+  }
+};
+
+struct HistogramMinus {
+  void operator()(PercentileHistogram& lhs,
+                  const PercentileHistogram& rhs) const {
+    lhs.Subtract(rhs);
+  }
+};
+
+// Records values into histograms of the calling threads. Recording is a
+// relaxed load and store of three counters since only the owning thread
+// writes them, readers merge all threads under the lock. The histogram is
+// never reset, windows (see ReducerSampler) subtract the samples.
+class Percentile {
+ public:
+  using value_type   = PercentileHistogram;
+  using op_type      = HistogramAdd;
+  using sampler_type = ReducerSampler<Percentile, PercentileHistogram,
+                                      HistogramAdd, HistogramMinus>;
+
+  struct Agent : public tutil::LinkNode<Agent> {
+    Agent() = default;
+
+    ~Agent() {
+      if (owner) {
+        owner->CommitAndErase(this);
+        owner = nullptr;
+      }
+    }
+
+    Percentile* owner{nullptr};
+    // Link of PendingAgents.
+    Agent* next_pending{nullptr};
+    std::atomic<uint64_t> num;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint32_t> counts[kPercentileBucketCount];
+  };
+
+  using AgentGroup = detail::AgentGroup<Agent>;
+
+  Percentile();
+  ~Percentile();
+
+  // Negative values are counted as 0, too large ones as UINT32_MAX.
+  Percentile& operator<<(int64_t value);
+
+  // All values recorded so far.
+  PercentileHistogram GetValue() const;
+
+  // Same as GetValue().num() without merging the buckets.
+  uint64_t GetNum() const;
+
+  // Number and sum of all values recorded so far, read together.
+  void GetTotal(uint64_t* num, uint64_t* sum) const;
+
+  const HistogramAdd& op() const { return op_; }
+  const HistogramMinus& inv_op() const { return inv_op_; }
+
+  // See Reducer::get_sampler().
+  sampler_type* get_sampler();
+
+ private:
+  Agent* GetOrCreateTlsAgent();
+
+  // Called from the thread owning `agent' when it exits.
+  void CommitAndErase(Agent* agent);
+
+  static void AddAgent(const Agent& agent, PercentileHistogram* histogram);
+
+  AgentId id_;
+  HistogramAdd op_;
+  HistogramMinus inv_op_;
+  mutable std::mutex mutex_;
+  // Values of exited threads.
+  PercentileHistogram global_;
+  // See AgentCombiner.
+  mutable tutil::LinkedList<Agent> agents_;
+  mutable PendingAgents<Agent> pending_agents_;
+  sampler_type* sampler_;
+};
+
+inline Percentile& Percentile::operator<<(int64_t value) {
+  Agent* agent = AgentGroup::GetTlsAgent(id_);
+  if (TESLA_UNLIKELY(agent == nullptr || agent->owner == nullptr)) {
+    agent = GetOrCreateTlsAgent();
+    if (agent == nullptr) {
+      return *this;
+    }
+  }
+  uint32_t v;
+  if (TESLA_UNLIKELY(value < 0)) {
+    v = 0;
+  } else if (TESLA_UNLIKELY(value > std::numeric_limits<uint32_t>::max())) {
+    v = std::numeric_limits<uint32_t>::max();
+  } else {
+    v = static_cast<uint32_t>(value);
+  }
+  std::atomic<uint32_t>& c = agent->counts[GetBucketIndex(v)];
+  c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  agent->num.store(agent->num.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  agent->sum.store(agent->sum.load(std::memory_order_relaxed) + v,
+                   std::memory_order_relaxed);
+  return *this;
+}
+
+} // namespace detail
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_DETAIL_PERCENTILE_H_
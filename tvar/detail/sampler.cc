@@ -0,0 +1,185 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Oct 19 15:02:37 CST 2019
+
+#include "tvar/detail/sampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "tutil/get_leaky_singleton.h"
+#include "tutil/time.h"
+#include "tvar/variable.h"
+
+namespace tesla {
+namespace tvar {
+namespace detail {
+
+namespace {
+
+// Print an atomic counter owned by somebody else.
+class CounterVariable : public Variable {
+ public:
+  explicit CounterVariable(const std::atomic<int64_t>* value)
+      : value_(value) {}
+  ~CounterVariable() { hide(); }
+
+  void describe(std::ostream& os, bool /*quote_string*/) const override {
+    os << value_->load(std::memory_order_relaxed);
+  }
+
+ private:
+  const std::atomic<int64_t>* value_;
+};
+
+} // namespace
+
+// Call TakeSample() of all scheduled samplers once per second in one
+// dedicated thread.
+//   - Schedule() only appends to a pending list under a lock, the thread
+//     moves the pending list into its own list once per round, so the
+//     walk itself takes no global lock.
+//   - Rounds start at absolute deadlines 1s apart, so the time spent in
+//     TakeSample() does not accumulate into drift. Rounds which cannot be
+//     kept up with (e.g. the process was stopped) are skipped instead of
+//     being run back to back.
+//   - Destroy()ed samplers are deleted by the next round.
+class SamplerCollector {
+ public:
+  SamplerCollector()
+      : stop_(false),
+        round_us_(0),
+        count_(0),
+        round_us_var_(&round_us_),
+        count_var_(&count_) {
+    round_us_var_.expose("tvar_sampler_collector_round_us");
+    count_var_.expose("tvar_sampler_collector_samplers");
+    thread_ = std::thread(&SamplerCollector::Run, this);
+  }
+
+  ~SamplerCollector() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  void Schedule(Sampler* sampler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.Append(sampler);
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t count() const { return count_.load(std::memory_order_relaxed); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void Run();
+  void RunRound();
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_;                           // protected by mutex_
+  tutil::LinkedList<Sampler> pending_;  // protected by mutex_
+  tutil::LinkedList<Sampler> samplers_; // used by thread_ only
+
+  std::atomic<int64_t> round_us_;  // cost of the last round
+  std::atomic<int64_t> count_;
+  CounterVariable round_us_var_;
+  CounterVariable count_var_;
+
+  std::thread thread_;
+};
+
+void SamplerCollector::Run() {
+  const Clock::duration kInterval = std::chrono::seconds(1);
+  Clock::time_point deadline = Clock::now() + kInterval;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait_until(lock, deadline, [this] { return stop_; });
+      if (stop_) {
+        return;
+      }
+      // Take newly scheduled samplers in one batch.
+      while (!pending_.empty()) {
+        tutil::LinkNode<Sampler>* node = pending_.head();
+        node->RemoveFromList();
+        samplers_.Append(node);
+      }
+    }
+
+    const int64_t begin = tutil::clock_ns();
+    RunRound();
+    round_us_.store((tutil::clock_ns() - begin) / 1000,
+                    std::memory_order_relaxed);
+
+    deadline += kInterval;
+    const Clock::time_point now = Clock::now();
+    if (deadline <= now) {
+      deadline = now + kInterval;
+    }
+  }
+}
+
+void SamplerCollector::RunRound() {
+  tutil::LinkNode<Sampler>* node = samplers_.head();
+  while (node != samplers_.end()) {
+    Sampler* sampler = node->value();
+    node = node->next();
+
+    bool destroyed = false;
+    {
+      std::lock_guard<std::mutex> lock(sampler->mutex_);
+      if (sampler->used_) {
+        sampler->TakeSample();
+      } else {
+        destroyed = true;
+      }
+    }
+    if (destroyed) {
+      sampler->RemoveFromList();
+      delete sampler;
+      count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+Sampler::Sampler() : used_(true) {}
+
+Sampler::~Sampler() {}
+
+void Sampler::Schedule() {
+  tutil::GetLeakySingleton<SamplerCollector>().Schedule(this);
+}
+
+void Sampler::Destroy() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  used_ = false;
+}
+
+size_t CountScheduledSamplers() {
+  return tutil::GetLeakySingleton<SamplerCollector>().count();
+}
+
+} // namespace detail
+} // namespace tvar
+} // namespace tesla
@@ -19,9 +19,13 @@
 #define TESLA_TVAR_DETAIL_SAMPLER_H_
 
 #include <mutex>
+#include <type_traits>
+#include <vector>
 
 #include "tutil/timestamp.h"
+#include "tutil/containers/bounded_queue.h"
 #include "tutil/containers/linked_list.h"
+#include "tvar/detail/call_op_returning_void.h"
 #include "log/logging.h"
 
 namespace tesla {
@@ -55,6 +59,7 @@ class Sampler : public tutil::LinkNode<Sampler> {
 
   // Call this function instead of delete operator to destroy the sampler.
   // Deletion of the sampler may be delayed for seconds.
+  // The sampler must have been scheduled.
   void Destroy();
 
  protected:
@@ -62,6 +67,10 @@ class Sampler : public tutil::LinkNode<Sampler> {
   std::mutex mutex_; // used to synchronize Destroy() and TakeSample().
 };
 
+// Number of samplers waiting for TakeSample() in the collector thread,
+// destroyed ones are included until they are reclaimed.
+size_t CountScheduledSamplers();
+
 // Representing a non-existing operator so that we can test
 // is_same<Op, VoidOp>::value to write code for different branches.
 // The false branch should be removed by compiler at compile-time.
@@ -72,6 +81,112 @@ struct VoidOp {
   };
 };
 
+// Windows are limited to one hour.
+constexpr time_t kMaxWindowSize = 3600;
+
+// Sample a reducer once per second and keep the samples of the largest
+// window which was asked for, so that the reduced value of the last N
+// seconds can be computed from two samples:
+//   - If the reducer has an inverse operator (e.g. Adder), the samples
+//     are the accumulated values and the window is latest - oldest.
+//   - Otherwise (e.g. Maxer) the reducer is reset every second and the
+//     samples inside the window are combined by Op.
+template <typename R, typename T, typename Op, typename InvOp>
+class ReducerSampler : public Sampler {
+ public:
+  static constexpr bool kInvertible = !std::is_same<InvOp, VoidOp>::value;
+
+  // `now' is the time of the first sample, see TakeSampleAt().
+  explicit ReducerSampler(R* reducer,
+                          tutil::Timestamp now = tutil::Timestamp::Now())
+      : reducer_(reducer),
+        window_size_(1),
+        q_(window_size_ + 1) {
+    // Invertible reducers have to be sampled once before the first
+    // window, others start from zero after the reset.
+    TakeSampleAt(now);
+  }
+
+  ~ReducerSampler() = default;
+
+  // Called by the collector with mutex_ held.
+  void TakeSample() override { TakeSampleAt(tutil::Timestamp::Now()); }
+
+  // Take a sample as if it were `now'. Besides TakeSample(), it may only
+  // be called on a sampler which is not scheduled, e.g. to drive a window
+  // with a fake clock in tests.
+  void TakeSampleAt(tutil::Timestamp now) {
+    if (q_.capacity() < static_cast<size_t>(window_size_ + 1)) {
+      Grow(window_size_ + 1);
+    }
+    Sample<T> latest;
+    if constexpr (kInvertible) {
+      latest.data = reducer_->GetValue();
+    } else {
+      latest.data = reducer_->Reset();
+    }
+    latest.time = now;
+    q_.eliminate_push(latest);
+  }
+
+  // Get the reduced value of the last `window_size' seconds into `value'
+  // and the real time it covers into `span'.
+  // Returns false if there are less than two samples.
+  bool GetValue(time_t window_size, T* value, tutil::Duration* span) {
+    if (window_size <= 0) {
+      LOG_ERROR << "Invalid window_size=" << window_size;
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (q_.size() <= 1) {
+      return false;
+    }
+    Sample<T>* oldest = q_.back(window_size);
+    if (oldest == nullptr) {
+      oldest = q_.front();
+    }
+    Sample<T>* latest = q_.back();
+    *value = latest->data;
+    if constexpr (kInvertible) {
+      call_op_returning_void(reducer_->inv_op(), *value, oldest->data);
+    } else {
+      // `oldest' was reset before the window begins, so it is excluded.
+      for (size_t i = 1; q_.back(i) != oldest; ++i) {
+        call_op_returning_void(reducer_->op(), *value, q_.back(i)->data);
+      }
+    }
+    *span = latest->time - oldest->time;
+    return true;
+  }
+
+  // Keep enough samples for `window_size' seconds.
+  int SetWindowSize(time_t window_size) {
+    if (window_size <= 0 || window_size > kMaxWindowSize) {
+      LOG_ERROR << "Invalid window_size=" << window_size;
+      return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (window_size > window_size_) {
+      window_size_ = window_size;
+    }
+    return 0;
+  }
+
+ private:
+  void Grow(size_t capacity) {
+    tutil::BoundedQueue<Sample<T>> q(capacity);
+    Sample<T> sample;
+    while (q_.pop_front(sample)) {
+      q.push_back(sample);
+    }
+    q.swap(q_);
+  }
+
+  R* reducer_;
+  time_t window_size_;
+  tutil::BoundedQueue<Sample<T>> q_;
+};
+
 } // namespace detail
 } // namespace tvar
 } // namespace tesla
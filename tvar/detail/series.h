@@ -19,10 +19,17 @@
 #define TESLA_TVAR_DETAIL_SERIES_H_
 
 #include <math.h>
-#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
 #include <mutex>
 #include <ostream>
+#include <string>
+#include <type_traits>
+
 #include "tvar/detail/call_op_returning_void.h"
+#include "tvar/detail/describe_value.h"
 
 namespace tesla {
 namespace tvar {
@@ -35,12 +42,25 @@ struct ProbablyAddition {
   ProbablyAddition(const Op& op) {
     T res(32); 
     call_op_returning_void(op, res, T(64));
-    ok_ = (res == T(96));
+    ok_ = Equals(res, T(96));
   };
 
   operator bool() const { return ok_; }
 
  private:
+  // Floating points are compared with a tolerance instead of ==.
+  template <typename U>
+  static typename std::enable_if<std::is_floating_point<U>::value, bool>::type
+  Equals(U a, U b) {
+    return fabs(a - b) < 1e-6;
+  }
+
+  template <typename U>
+  static typename std::enable_if<!std::is_floating_point<U>::value, bool>::type
+  Equals(const U& a, const U& b) {
+    return a == b;
+  }
+
   bool ok_{false};
 };
 
@@ -58,7 +78,7 @@ struct DivideOnAddition <T, Op, typename std::enable_if<
   static void inplace_divide(T& obj, const Op* op, int number) {
     // static object is to avoid constructing or destructing
     // the same obj repeatly.
-    static ProbablyAddition<T, Op> probably_add(op);
+    static ProbablyAddition<T, Op> probably_add(*op);
     if (probably_add) {
       obj = (T)round(obj / (double)number);
     }
@@ -72,7 +92,7 @@ struct DivideOnAddition <T, Op, typename std::enable_if<
   static void inplace_divide(T& obj, const Op* op, int number) {
     // static object is to avoid constructing or destructing
     // the same obj repeatly.
-    static ProbablyAddition<T, Op> probably_add(op);
+    static ProbablyAddition<T, Op> probably_add(*op);
     if (probably_add) {
       obj /= number;
     }
@@ -83,109 +103,183 @@ struct DivideOnAddition <T, Op, typename std::enable_if<
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 
-template <typename T, typename Op>
-class SeriesBase {
+// A series keeps four rings of values: the last 60 seconds, 60 minutes,
+// 24 hours and 30 days.
+enum SeriesRing {
+  SERIES_SECOND = 0,
+  SERIES_MINUTE = 1,
+  SERIES_HOUR   = 2,
+  SERIES_DAY    = 3,
+};
+
+constexpr int kSeriesRingSize[] = {60, 60, 24, 30};
+constexpr int kSeriesRingOffset[] = {0, 60, 120, 144};
+constexpr int kSeriesSize = 60 + 60 + 24 + 30;
+
+// Values of a series stored as they are.
+template <typename T, typename Enable = void>
+class SeriesData {
  public:
-  explicit SeriesBase(const Op& op) : op_(op) {}
-  ~SeriesBase() = default;
+  SeriesData() {
+    if constexpr (std::is_pod<T>::value) {
+      memset(array_, 0, sizeof(array_));
+    }
+  }
 
-  void Append(const T& value) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    AppendSecond(value); 
+  // Copy all values of `ring' into `values'.
+  void Load(int ring, T* values) const {
+    const T* begin = array_ + kSeriesRingOffset[ring];
+    std::copy(begin, begin + kSeriesRingSize[ring], values);
   }
-  
+
+  void Store(int ring, const T* values) {
+    std::copy(values, values + kSeriesRingSize[ring],
+              array_ + kSeriesRingOffset[ring]);
+  }
+
  private:
-  void AppendSecond(const T& value);
-  void AppendMinute(const T& value);
-  void AppendHour(const T& value);
-  void AppendDay(const T& value);
-
-  class Data {
-   public:
-    Data() {
-      if (std::is_pod<T>::value) {
-        memset(array_, 0, sizeof(array_));
+  T array_[kSeriesSize];
+};
+
+// Integral values are delta encoded, since most series move slowly or not
+// at all. Each ring is a byte string of tokens:
+//   - the varint of the zigzag of (value - previous value) if they differ,
+//     the value before the first one is 0;
+//   - a 0 byte followed by the varint of N for N values equal to the
+//     previous one.
+// Values missing at the end equal the last decoded one, so a ring of
+// zeros is an empty string and a constant ring is one token, both kept in
+// the string itself without allocation. A series of an idle int64_t takes
+// about 1/10 of the memory of the plain array, a busy one about 1/4.
+template <typename T>
+class SeriesData<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+ public:
+  void Load(int ring, T* values) const {
+    const std::string& buf = rings_[ring];
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buf.data());
+    const uint8_t* const end = p + buf.size();
+    const int n = kSeriesRingSize[ring];
+    uint64_t prev = 0;
+    int i = 0;
+    while (p < end && i < n) {
+      if (*p == 0) {
+        ++p;
+        uint64_t count = DecodeVarint(&p, end);
+        for (; count > 0 && i < n; --count) {
+          values[i++] = static_cast<T>(prev);
+        }
+      } else {
+        const uint64_t zigzag = DecodeVarint(&p, end);
+        prev += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+        values[i++] = static_cast<T>(prev);
       }
     }
+    for (; i < n; ++i) {
+      values[i] = static_cast<T>(prev);
+    }
+  }
 
-    T& Second(int index) { return array_[index]; }
-    const T& Second(int index) const { return array_[index]; }
+  void Store(int ring, const T* values) {
+    uint8_t buf[kMaxRingSize * kMaxVarintSize];
+    uint8_t* p = buf;
+    const int n = kSeriesRingSize[ring];
+    uint64_t prev = 0;
+    uint64_t repeated = 0;
+    for (int i = 0; i < n; ++i) {
+      const uint64_t value = static_cast<uint64_t>(values[i]);
+      if (value == prev) {
+        ++repeated;
+        continue;
+      }
+      if (repeated > 0) {
+        *p++ = 0;
+        p = EncodeVarint(p, repeated);
+        repeated = 0;
+      }
+      // Modular difference, zigzagged so that small negative ones are
+      // short too.
+      const uint64_t delta = value - prev;
+      p = EncodeVarint(p, (delta << 1) ^ (~(delta >> 63) + 1));
+      prev = value;
+    }
+    // The trailing repeats are implied.
+    rings_[ring].assign(reinterpret_cast<const char*>(buf), p - buf);
+  }
 
-    T& Minute(int index) { return array_[60 + index]; }
-    const T& Minute(int index) const { return array_[60 + index]; }
+ private:
+  static constexpr int kMaxRingSize = 60;
+  static constexpr int kMaxVarintSize = 10;
 
-    T& Hour(int index) { return array_[120 + index]; }
-    const T& Hour(int index) const { return array_[120 + index]; }
+  static uint8_t* EncodeVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+      *p++ = static_cast<uint8_t>(v | 0x80);
+      v >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(v);
+    return p;
+  }
 
-    T& Day(int index) { return array_[144 + index]; }
-    const T& Day(int index) const { return array_[144 + index]; }
+  static uint64_t DecodeVarint(const uint8_t** p, const uint8_t* end) {
+    uint64_t v = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+      const uint8_t b = *(*p)++;
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if (b < 0x80) {
+        break;
+      }
+    }
+    return v;
+  }
 
-   private:
-    T array_[60 + 60 + 24 + 30];
-  };
+  std::string rings_[4];
+};
+
+template <typename T, typename Op>
+class SeriesBase {
+ public:
+  explicit SeriesBase(const Op& op) : op_(op) {}
+  ~SeriesBase() = default;
+
+  void Append(const T& value) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Append(SERIES_SECOND, value);
+  }
+
+ private:
+  // Put `value' into `ring', reducing the ring into the next one when it
+  // is full. Minutes and hours are averages of additive values (Adder,
+  // IntRecorder), and reduced by the op otherwise, e.g. the max of the
+  // seconds for a Maxer.
+  void Append(int ring, const T& value);
 
  protected:
   Op op_;
   mutable std::mutex mutex_;
-  char next_second_{0};  // 0 ~ 59 
-  char next_minute_{0};  // 0 ~ 59
-  char next_hour_{0};    // 0 ~ 23
-  char next_day_{0};     // 0 ~ 29
-  Data data_;
+  // Where the next value of each ring goes, also the oldest value.
+  char next_[4] = {0, 0, 0, 0};
+  SeriesData<T> data_;
 };
 
 template <typename T, typename Op>
-void SeriesBase<T, Op>::AppendSecond(const T& value) {
-  data_.Second(next_second_) = value;
-  ++next_second_;
-  if (next_second_ >= 60) {
-    next_second_ = 0;
-    T result = data_.Second(0);
-    for (int i = 1; i < 60; ++i) {
-      call_op_returning_void(op_, result, data_.Second(i));
-    }
-    DivideOnAddition<T, Op>::inplace_divide(result, op_, 60);
-    AppendMinute(result, op_);
-  }
-}
-
-template <typename T, typename Op>
-void SeriesBase<T, Op>::AppendMinute(const T& value) {
-  data_.Minute(next_minute_) = value; 
-  ++next_minute_;
-  if (next_minute_ >= 60) {
-    next_minute_ = 0;
-    T result = data_.Minute(0);
-    for (int i = 1; i < 60; ++i) {
-      call_op_returning_void(op_, result, data_.Minute(i));
-    }
-    DivideOnAddition<T, Op>::inplace_divide(result, op_, 60);
-    AppendHour(result, op_); 
+void SeriesBase<T, Op>::Append(int ring, const T& value) {
+  const int n = kSeriesRingSize[ring];
+  T values[kSeriesRingSize[SERIES_SECOND]];
+  data_.Load(ring, values);
+  values[static_cast<int>(next_[ring])] = value;
+  data_.Store(ring, values);
+  if (++next_[ring] < n) {
+    return;
   }
-}
-
-template <typename T, typename Op>
-void SeriesBase<T, Op>::AppendHour(const T& value) {
-  data_.Hour(next_hour_) = value;
-  ++next_hour_;
-  if (next_hour_ >= 24) {
-    next_hour_ = 0;
-    T result = data_.Hour(0);
-    for (int i = 1; i < 24; ++i) {
-      call_op_returning_void(op_, result, data_.Hour(i));
-    }
-    DivideOnAddition<T, Op>::inplace_divide(result, op_, 24);
-    AppendDay(result, op_); 
+  next_[ring] = 0;
+  if (ring == SERIES_DAY) {
+    return;
   }
-}
-
-template <typename T, typename Op>
-void SeriesBase<T, Op>::AppendDay(const T& value) {
-  data_.Day(next_day_) = value;
-  ++next_day_;
-  if (next_day_ >= 30) {
-    next_day_ = 0;
+  T result = values[0];
+  for (int i = 1; i < n; ++i) {
+    call_op_returning_void(op_, result, values[i]);
   }
+  DivideOnAddition<T, Op>::inplace_divide(result, &op_, n);
+  Append(ring + 1, result);
 }
 
 template <typename T, typename Op>
@@ -201,43 +295,32 @@ class Series : public SeriesBase<T, Op> {
 template <typename T, typename Op>
 void Series<T, Op>::Describe(std::ostream& os,
                              const std::string* name) const {
-  // TODO(tesla): check name not null ? 
-  
-  this->mutex_.lock();
-  const int second_begin = this->next_second_;
-  const int minute_begin = this->next_minute_;
-  const int hour_begin = this->next_hour_;
-  const int day_begin = this->next_day_;
-  this->mutex_.unlock();
-
-  int c = 0;
-  os << "{\"label\":\"trend\",\"data\":[";
-  for (int i = 0; i < 30; ++i, ++c) {
-    if (c) {
-      os << ',';
+  // TODO(tesla): check name not null ?
+
+  T values[kSeriesSize];
+  char begin[4];
+  {
+    std::lock_guard<std::mutex> guard(this->mutex_);
+    for (int r = SERIES_SECOND; r <= SERIES_DAY; ++r) {
+      this->data_.Load(r, values + kSeriesRingOffset[r]);
+      begin[r] = this->next_[r];
     }
-    os << '['  << c << ',' << this->data_.Day((i + day_begin) % 30) << ']';
   }
 
-  for (int i = 0; i < 24; ++i, ++c) {
-    if (c) {
-      os << ',';
-    }
-    os << '['  << c << ',' << this->data_.Hour((i + hour_begin) % 24) << ']';
-  }
-
-  for (int i = 0; i < 60; ++i, ++c) {
-    if (c) {
-      os << ',';
-    }
-    os << '['  << c << ',' << this->data_.Minute((i + minute_begin) % 60) << ']';
-  }
-
-  for (int i = 0; i < 60; ++i, ++c) {
-    if (c) {
-      os << ',';
+  int c = 0;
+  os << "{\"label\":\"trend\",\"data\":[";
+  // From the oldest day to the latest second.
+  for (int r = SERIES_DAY; r >= SERIES_SECOND; --r) {
+    const int n = kSeriesRingSize[r];
+    const T* ring = values + kSeriesRingOffset[r];
+    for (int i = 0; i < n; ++i, ++c) {
+      if (c) {
+        os << ',';
+      }
+      os << '[' << c << ',';
+      DescribeValue(os, ring[(i + begin[r]) % n]);
+      os << ']';
     }
-    os << '['  << c << ',' << this->data_.Second((i + second_begin) % 60) << ']';
   }
   os << "]}";
 }
@@ -0,0 +1,530 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Thu Oct 24 21:05:44 CST 2019
+
+#include "tvar/http_server.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "log/logging.h"
+#include "tvar/prometheus_dumper.h"
+#include "tvar/variable.h"
+
+namespace tesla {
+namespace tvar {
+
+namespace {
+
+// Requests with longer headers are rejected.
+constexpr size_t kMaxHeaderSize = 8192;
+// Bodies are not used by any page, but still have to be skipped.
+constexpr size_t kMaxBodySize = 1024 * 1024;
+constexpr int kMaxEvents = 64;
+
+// Write "name : value" per line.
+class PlainTextDumper : public Dumper {
+ public:
+  explicit PlainTextDumper(std::string* out) : out_(out) {}
+
+  bool dump(const std::string& name,
+            const ::tutil::StringView& description) override {
+    out_->append(name);
+    out_->append(" : ");
+    out_->append(description.data(), description.size());
+    out_->push_back('\n');
+    return true;
+  }
+
+ private:
+  std::string* out_;
+};
+
+int FromHex(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Decode %XX of a path or a query component, append to `out'. '+' stands
+// for a space only in queries, set `plus_as_space' for them.
+void DecodeUri(const char* begin, const char* end, bool plus_as_space,
+               std::string* out) {
+  for (const char* p = begin; p != end; ++p) {
+    if (*p == '%' && end - p >= 3 && FromHex(p[1]) >= 0 &&
+        FromHex(p[2]) >= 0) {
+      out->push_back(static_cast<char>(FromHex(p[1]) * 16 + FromHex(p[2])));
+      p += 2;
+    } else if (*p == '+' && plus_as_space) {
+      out->push_back(' ');
+    } else {
+      out->push_back(*p);
+    }
+  }
+}
+
+// Find value of `key' in the query string `query', returns false if the
+// key is absent.
+bool FindQuery(const std::string& query, const char* key,
+               std::string* value) {
+  const size_t key_len = strlen(key);
+  size_t pos = 0;
+  while (pos < query.size()) {
+    size_t end = query.find('&', pos);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    if (end - pos >= key_len &&
+        query.compare(pos, key_len, key) == 0 &&
+        (end - pos == key_len || query[pos + key_len] == '=')) {
+      value->clear();
+      if (end - pos > key_len) {
+        DecodeUri(query.data() + pos + key_len + 1, query.data() + end, true,
+                  value);
+      }
+      return true;
+    }
+    pos = end + 1;
+  }
+  return false;
+}
+
+const char* StatusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    default:  return "Internal Server Error";
+  }
+}
+
+void AppendResponse(int status, const std::string& content_type,
+                    const std::string& body, bool with_body,
+                    bool keep_alive, std::string* out) {
+  char header[256];
+  const int n = snprintf(header, sizeof(header),
+                         "HTTP/1.1 %d %s\r\n"
+                         "Content-Type: %s\r\n"
+                         "Content-Length: %zu\r\n"
+                         "Connection: %s\r\n\r\n",
+                         status, StatusText(status), content_type.c_str(),
+                         body.size(), keep_alive ? "keep-alive" : "close");
+  out->append(header, n);
+  if (with_body) {
+    out->append(body);
+  }
+}
+
+// Case-insensitive comparison of the header name in [begin, colon).
+bool IsHeader(const char* begin, const char* colon, const char* name) {
+  const size_t len = strlen(name);
+  return static_cast<size_t>(colon - begin) == len &&
+         strncasecmp(begin, name, len) == 0;
+}
+
+} // namespace
+
+struct HttpServer::Connection {
+  explicit Connection(int fd_in)
+      : fd(fd_in), output_pos(0), close_after_write(false),
+        want_write(false) {}
+
+  int fd;
+  std::string input;
+  std::string output;
+  size_t output_pos;
+  // The last response was written with "Connection: close".
+  bool close_after_write;
+  // EPOLLOUT is registered.
+  bool want_write;
+  // Reused by the requests of this connection.
+  std::string content_type;
+  std::string body;
+};
+
+HttpServer::HttpServer()
+    : listen_fd_(-1), epoll_fd_(-1), wakeup_fd_(-1), port_(-1),
+      stop_(false) {}
+
+HttpServer::~HttpServer() {
+  Stop();
+}
+
+int HttpServer::Start(int port) {
+  if (thread_.joinable()) {
+    LOG_ERROR << "HttpServer is already started on port " << port_;
+    return -1;
+  }
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    LOG_SYSERR << "Fail to create socket";
+    return -1;
+  }
+  const int on = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) != 0 ||
+      listen(listen_fd_, SOMAXCONN) != 0 ||
+      getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+                  &addr_len) != 0) {
+    LOG_SYSERR << "Fail to listen on port " << port;
+    Stop();
+    return -1;
+  }
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wakeup_fd_ < 0) {
+    LOG_SYSERR << "Fail to create epoll or eventfd";
+    Stop();
+    return -1;
+  }
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  event.data.fd = wakeup_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event);
+
+  port_ = ntohs(addr.sin_port);
+  stop_.store(false, std::memory_order_relaxed);
+  thread_ = std::thread(&HttpServer::Run, this);
+  return 0;
+}
+
+void HttpServer::Stop() {
+  if (thread_.joinable()) {
+    stop_.store(true, std::memory_order_relaxed);
+    const uint64_t one = 1;
+    ssize_t rc = write(wakeup_fd_, &one, sizeof(one));
+    (void)rc;
+    thread_.join();
+  }
+  for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+    close(it->first);
+  }
+  connections_.clear();
+  for (int* fd : {&listen_fd_, &epoll_fd_, &wakeup_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  port_ = -1;
+}
+
+void HttpServer::Run() {
+  struct epoll_event events[kMaxEvents];
+  while (!stop_.load(std::memory_order_relaxed)) {
+    const int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_SYSERR << "Fail to epoll_wait";
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == wakeup_fd_) {
+        return;
+      }
+      if (fd == listen_fd_) {
+        Accept();
+        continue;
+      }
+      auto it = connections_.find(fd);
+      if (it == connections_.end()) {
+        continue;
+      }
+      Connection* conn = it->second.get();
+      bool ok = true;
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        ok = false;
+      }
+      if (ok && (events[i].events & EPOLLIN)) {
+        ok = OnReadable(conn);
+      }
+      if (ok && (events[i].events & EPOLLOUT)) {
+        ok = OnWritable(conn);
+      }
+      if (!ok) {
+        Close(conn);
+      }
+    }
+  }
+}
+
+void HttpServer::Accept() {
+  while (true) {
+    const int fd = accept4(listen_fd_, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        LOG_SYSERR << "Fail to accept";
+      }
+      return;
+    }
+    const int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      LOG_SYSERR << "Fail to add fd=" << fd << " into epoll";
+      close(fd);
+      continue;
+    }
+    connections_[fd].reset(new Connection(fd));
+  }
+}
+
+void HttpServer::Close(Connection* conn) {
+  const int fd = conn->fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections_.erase(fd);
+}
+
+bool HttpServer::OnReadable(Connection* conn) {
+  char buf[16384];
+  while (true) {
+    const ssize_t n = read(conn->fd, buf, sizeof(buf));
+    if (n > 0) {
+      conn->input.append(buf, n);
+      continue;
+    }
+    if (n == 0) {
+      return false;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    return false;
+  }
+  if (conn->close_after_write) {
+    // Requests after "Connection: close" are ignored.
+    conn->input.clear();
+    return true;
+  }
+  const bool keep_alive = ProcessRequests(conn);
+  if (!keep_alive) {
+    conn->close_after_write = true;
+  }
+  return OnWritable(conn);
+}
+
+bool HttpServer::OnWritable(Connection* conn) {
+  while (conn->output_pos < conn->output.size()) {
+    const ssize_t n = write(conn->fd, conn->output.data() + conn->output_pos,
+                            conn->output.size() - conn->output_pos);
+    if (n >= 0) {
+      conn->output_pos += n;
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+    if (!conn->want_write) {
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN | EPOLLOUT;
+      event.data.fd = conn->fd;
+      epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &event);
+      conn->want_write = true;
+    }
+    return true;
+  }
+  // clear() keeps the capacity for the next response.
+  conn->output.clear();
+  conn->output_pos = 0;
+  if (conn->close_after_write) {
+    return false;
+  }
+  if (conn->want_write) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = conn->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->want_write = false;
+  }
+  return true;
+}
+
+bool HttpServer::ProcessRequests(Connection* conn) {
+  std::string& input = conn->input;
+  size_t consumed = 0;
+  bool keep_alive = true;
+  while (keep_alive) {
+    const size_t header_end = input.find("\r\n\r\n", consumed);
+    if (header_end == std::string::npos) {
+      if (input.size() - consumed > kMaxHeaderSize) {
+        conn->body.clear();
+        AppendResponse(431, "text/plain", conn->body, true, false,
+                       &conn->output);
+        keep_alive = false;
+      }
+      break;
+    }
+    const char* const begin = input.data() + consumed;
+    const char* const end = input.data() + header_end;
+    const char* line_end =
+        static_cast<const char*>(memmem(begin, end - begin + 2, "\r\n", 2));
+
+    // Request line: METHOD SP URI SP VERSION
+    const char* sp1 =
+        static_cast<const char*>(memchr(begin, ' ', line_end - begin));
+    const char* sp2 = sp1 ? static_cast<const char*>(
+                                memchr(sp1 + 1, ' ', line_end - sp1 - 1))
+                          : nullptr;
+    if (sp1 == nullptr || sp2 == nullptr) {
+      conn->body.clear();
+      AppendResponse(400, "text/plain", conn->body, true, false,
+                     &conn->output);
+      keep_alive = false;
+      break;
+    }
+    const std::string method(begin, sp1);
+    const std::string uri(sp1 + 1, sp2);
+    keep_alive = (line_end - sp2 - 1 == 8 &&
+                  memcmp(sp2 + 1, "HTTP/1.1", 8) == 0);
+
+    size_t content_length = 0;
+    for (const char* p = line_end + 2; p < end;) {
+      const char* eol =
+          static_cast<const char*>(memmem(p, end + 2 - p, "\r\n", 2));
+      const char* colon = static_cast<const char*>(memchr(p, ':', eol - p));
+      if (colon != nullptr) {
+        const char* value = colon + 1;
+        while (value < eol && (*value == ' ' || *value == '\t')) {
+          ++value;
+        }
+        if (IsHeader(p, colon, "Connection")) {
+          if (eol - value == 5 && strncasecmp(value, "close", 5) == 0) {
+            keep_alive = false;
+          } else if (eol - value == 10 &&
+                     strncasecmp(value, "keep-alive", 10) == 0) {
+            keep_alive = true;
+          }
+        } else if (IsHeader(p, colon, "Content-Length")) {
+          content_length = strtoull(value, nullptr, 10);
+        }
+      }
+      p = eol + 2;
+    }
+    if (content_length > kMaxBodySize) {
+      conn->body.clear();
+      AppendResponse(413, "text/plain", conn->body, true, false,
+                     &conn->output);
+      keep_alive = false;
+      break;
+    }
+    const size_t request_end = header_end + 4 + content_length;
+    if (request_end > input.size()) {
+      // Wait for the body.
+      break;
+    }
+
+    int status = 200;
+    HandleRequest(method, uri, &conn->content_type, &conn->body, &status);
+    AppendResponse(status, conn->content_type, conn->body, method != "HEAD",
+                   keep_alive, &conn->output);
+    consumed = request_end;
+  }
+  input.erase(0, consumed);
+  return keep_alive;
+}
+
+void HttpServer::HandleRequest(const std::string& method,
+                               const std::string& uri,
+                               std::string* content_type,
+                               std::string* body, int* status) {
+  content_type->assign("text/plain");
+  body->clear();
+  if (method != "GET" && method != "HEAD") {
+    *status = 405;
+    return;
+  }
+  const size_t question = uri.find('?');
+  const std::string path(uri, 0, question);
+  const std::string query =
+      question == std::string::npos ? std::string() : uri.substr(question + 1);
+
+  DumpOptions options;
+  options.quote_string = false;
+  options.question_mark = '$';
+  FindQuery(query, "filter", &options.white_wildcards);
+
+  if (path == "/metrics") {
+    content_type->assign("text/plain; version=0.0.4");
+    if (dump_prometheus_metrics(body, options) < 0) {
+      *status = 500;
+      return;
+    }
+  } else if (path == "/vars" || path.compare(0, 6, "/vars/") == 0) {
+    if (path.size() > 6) {
+      options.white_wildcards.clear();
+      DecodeUri(path.data() + 6, path.data() + path.size(), false,
+                &options.white_wildcards);
+    }
+    PlainTextDumper dumper(body);
+    if (Variable::dump_exposed(dumper, &options) < 0) {
+      *status = 500;
+      return;
+    }
+  } else {
+    *status = 404;
+    return;
+  }
+  *status = 200;
+}
+
+} // namespace tvar
+} // namespace tesla
@@ -0,0 +1,91 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Thu Oct 24 21:05:44 CST 2019
+
+#ifndef TESLA_TVAR_HTTP_SERVER_H_
+#define TESLA_TVAR_HTTP_SERVER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "tutil/macros.h"
+
+namespace tesla {
+namespace tvar {
+
+// A minimal HTTP/1.1 server running in one thread with epoll, for the
+// binaries which have no RPC framework to show the variables:
+//   GET /vars                      "name : value" of all variables
+//   GET /vars/rpc_*;process_*      variables matched by the wildcards
+//   GET /vars?filter=rpc_*         same as above
+//   GET /metrics                   Prometheus format, filter works too
+// In wildcards `$' stands for a single character since `?' is reserved in
+// URL. Connections are kept alive unless the client asks otherwise, and
+// the buffers of a connection are reused by its following requests.
+// Example:
+//   tvar::HttpServer server;
+//   if (server.Start(8888) != 0) {
+//     LOG_ERROR << "Fail to start tvar http server";
+//   }
+class HttpServer {
+ public:
+  HttpServer();
+  ~HttpServer();
+
+  DISALLOW_COPY_AND_ASSIGN(HttpServer);
+
+  // Listen on `port' of all addresses, 0 picks an unused port. Returns 0
+  // on success, -1 otherwise.
+  int Start(int port);
+
+  // Close all connections and join the thread. Called by the destructor.
+  void Stop();
+
+  // The port listened on, -1 if the server is not started.
+  int port() const { return port_; }
+
+ private:
+  struct Connection;
+
+  void Run();
+  void Accept();
+  // Returns false if the connection should be closed.
+  bool OnReadable(Connection* conn);
+  bool OnWritable(Connection* conn);
+  void Close(Connection* conn);
+  // Handle the complete requests in the input buffer of `conn', returns
+  // false if the connection should be closed after the responses.
+  bool ProcessRequests(Connection* conn);
+  void HandleRequest(const std::string& method, const std::string& uri,
+                     std::string* content_type, std::string* body,
+                     int* status);
+
+  int listen_fd_;
+  int epoll_fd_;
+  int wakeup_fd_;
+  int port_;
+  std::atomic<bool> stop_;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+  std::thread thread_;
+};
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_HTTP_SERVER_H_
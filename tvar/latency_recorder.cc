@@ -0,0 +1,202 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 21 21:40:18 CST 2019
+
+#include "tvar/latency_recorder.h"
+
+#include <math.h>
+
+#include <string>
+
+namespace tesla {
+namespace tvar {
+
+namespace {
+
+int64_t GetCount(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->count();
+}
+
+int64_t GetSum(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->sum();
+}
+
+int64_t GetLatency(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->latency();
+}
+
+int64_t GetMaxLatency(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->max_latency();
+}
+
+int64_t GetQps(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->qps();
+}
+
+template <int kRatioInThousandths>
+int64_t GetPercentile(void* arg) {
+  return static_cast<LatencyRecorder*>(arg)->latency_percentile(
+      kRatioInThousandths / 1000.0);
+}
+
+// Quantiles of the summary, the same as the exposed percentiles.
+const double kSummaryRatios[] = {0.5, 0.9, 0.99, 0.999};
+
+} // namespace
+
+LatencyRecorder::LatencyStatus::LatencyStatus(LatencyRecorder* recorder)
+    : PassiveStatus<int64_t>(GetLatency, recorder), recorder_(recorder) {}
+
+bool LatencyRecorder::LatencyStatus::get_summary(Summary* summary) const {
+  recorder_->get_summary(summary);
+  return true;
+}
+
+LatencyRecorder::LatencyRecorder(time_t window_size)
+    : window_size_(window_size > 0 ? window_size : kDefaultWindowSize),
+      max_latency_window_(&max_latency_, window_size_),
+      percentile_sampler_(percentile_.get_sampler()),
+      latency_status_(this),
+      max_latency_status_(GetMaxLatency, this),
+      count_(GetCount, this),
+      sum_(GetSum, this),
+      qps_(GetQps, this),
+      latency_50_(GetPercentile<500>, this),
+      latency_90_(GetPercentile<900>, this),
+      latency_99_(GetPercentile<990>, this),
+      latency_999_(GetPercentile<999>, this) {
+  percentile_sampler_->SetWindowSize(window_size_);
+}
+
+LatencyRecorder::LatencyRecorder(const ::tutil::StringView& prefix,
+                                 time_t window_size)
+    : LatencyRecorder(window_size) {
+  expose(prefix);
+}
+
+LatencyRecorder::LatencyRecorder(const ::tutil::StringView& prefix1,
+                                 const ::tutil::StringView& prefix2,
+                                 time_t window_size)
+    : LatencyRecorder(window_size) {
+  expose(prefix1, prefix2);
+}
+
+int LatencyRecorder::expose(const ::tutil::StringView& prefix) {
+  if (prefix.empty()) {
+    LOG_ERROR << "Parameter[prefix] is empty";
+    return -1;
+  }
+  int rc = 0;
+  rc |= latency_status_.expose_as(prefix, "latency");
+  rc |= max_latency_status_.expose_as(prefix, "max_latency");
+  rc |= qps_.expose_as(prefix, "qps");
+  rc |= count_.expose_as(prefix, "count");
+  rc |= sum_.expose_as(prefix, "sum");
+  rc |= latency_50_.expose_as(prefix, "latency_50");
+  rc |= latency_90_.expose_as(prefix, "latency_90");
+  rc |= latency_99_.expose_as(prefix, "latency_99");
+  rc |= latency_999_.expose_as(prefix, "latency_999");
+  return rc == 0 ? 0 : -1;
+}
+
+int LatencyRecorder::expose(const ::tutil::StringView& prefix1,
+                            const ::tutil::StringView& prefix2) {
+  std::string prefix;
+  to_underscored_name(prefix, prefix1);
+  if (!prefix.empty() && prefix.back() != '_') {
+    prefix.push_back('_');
+  }
+  to_underscored_name(prefix, prefix2);
+  return expose(::tutil::StringView(prefix.data(), prefix.size()));
+}
+
+void LatencyRecorder::hide() {
+  latency_status_.hide();
+  max_latency_status_.hide();
+  qps_.hide();
+  count_.hide();
+  sum_.hide();
+  latency_50_.hide();
+  latency_90_.hide();
+  latency_99_.hide();
+  latency_999_.hide();
+}
+
+bool LatencyRecorder::GetWindow(time_t window_size,
+                                detail::PercentileHistogram* histogram,
+                                tutil::Duration* span) const {
+  return percentile_sampler_->GetValue(window_size, histogram, span);
+}
+
+int64_t LatencyRecorder::latency(time_t window_size) const {
+  detail::PercentileHistogram histogram;
+  tutil::Duration span;
+  if (!GetWindow(window_size, &histogram, &span)) {
+    return 0;
+  }
+  return histogram.GetAverage();
+}
+
+int64_t LatencyRecorder::max_latency() const {
+  const int64_t value = max_latency_window_.GetValue();
+  // Maxer starts from the lowest int64_t when nothing is recorded.
+  return value < 0 ? 0 : value;
+}
+
+int64_t LatencyRecorder::qps(time_t window_size) const {
+  detail::PercentileHistogram histogram;
+  tutil::Duration span;
+  if (!GetWindow(window_size, &histogram, &span) || span.IsZero()) {
+    return 0;
+  }
+  return static_cast<int64_t>(round(histogram.num() / span.Seconds()));
+}
+
+int64_t LatencyRecorder::sum() const {
+  uint64_t num = 0;
+  uint64_t sum = 0;
+  percentile_.GetTotal(&num, &sum);
+  return static_cast<int64_t>(sum);
+}
+
+void LatencyRecorder::get_summary(Summary* summary) const {
+  detail::PercentileHistogram histogram;
+  tutil::Duration span;
+  const bool ready = GetWindow(window_size_, &histogram, &span);
+  summary->quantile_count = 0;
+  for (double ratio : kSummaryRatios) {
+    const int i = summary->quantile_count++;
+    summary->ratios[i] = ratio;
+    summary->values[i] = ready ? histogram.GetNumber(ratio) : 0;
+  }
+  uint64_t num = 0;
+  uint64_t sum = 0;
+  percentile_.GetTotal(&num, &sum);
+  summary->count = static_cast<int64_t>(num);
+  summary->sum = static_cast<int64_t>(sum);
+}
+
+int64_t LatencyRecorder::latency_percentile(double ratio) const {
+  detail::PercentileHistogram histogram;
+  tutil::Duration span;
+  if (!GetWindow(window_size_, &histogram, &span)) {
+    return 0;
+  }
+  return histogram.GetNumber(ratio);
+}
+
+} // namespace tvar
+} // namespace tesla
@@ -0,0 +1,149 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 21 21:40:18 CST 2019
+
+#ifndef TESLA_TVAR_LATENCY_RECORDER_H_
+#define TESLA_TVAR_LATENCY_RECORDER_H_
+
+#include <stdint.h>
+
+#include "tutil/macros.h"
+#include "tvar/passive_status.h"
+#include "tvar/reducer.h"
+#include "tvar/window.h"
+#include "tvar/detail/percentile.h"
+
+namespace tesla {
+namespace tvar {
+
+// Record latencies and expose the statistics of the last `window_size'
+// seconds as:
+//   <prefix>_latency         average latency
+//   <prefix>_max_latency     max latency
+//   <prefix>_qps             latencies recorded per second
+//   <prefix>_count           latencies recorded since the start
+//   <prefix>_sum             sum of the latencies recorded since the start
+//   <prefix>_latency_50      median
+//   <prefix>_latency_90, <prefix>_latency_99, <prefix>_latency_999
+// Example:
+//   tvar::LatencyRecorder rpc_latency("rpc");
+//   ...
+//   rpc_latency << elapsed_us;
+//
+// Recording touches only the agents of the calling thread: a histogram
+// which also counts and sums the latencies, and a Maxer.
+//
+// <prefix>_latency has a summary (see Variable::get_summary()) of the
+// percentiles above plus the count and the sum, which dumpers like
+// PrometheusDumper write as one metric.
+class LatencyRecorder {
+ public:
+  explicit LatencyRecorder(time_t window_size = kDefaultWindowSize);
+
+  explicit LatencyRecorder(const ::tutil::StringView& prefix,
+                           time_t window_size = kDefaultWindowSize);
+
+  LatencyRecorder(const ::tutil::StringView& prefix1,
+                  const ::tutil::StringView& prefix2,
+                  time_t window_size = kDefaultWindowSize);
+
+  ~LatencyRecorder() { hide(); }
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyRecorder);
+
+  // Record a latency, in whatever unit the user chooses (microseconds
+  // usually). Negative latencies are counted as 0.
+  LatencyRecorder& operator<<(int64_t latency) {
+    percentile_ << latency;
+    max_latency_ << latency;
+    return *this;
+  }
+
+  // Expose all variables with names starting with `prefix'.
+  // Returns 0 on success, -1 if any of them failed.
+  int expose(const ::tutil::StringView& prefix);
+
+  // Same as expose(prefix1 + "_" + prefix2).
+  int expose(const ::tutil::StringView& prefix1,
+             const ::tutil::StringView& prefix2);
+
+  // Hide all variables.
+  void hide();
+
+  // Average latency of the last `window_size' seconds.
+  int64_t latency(time_t window_size) const;
+  int64_t latency() const { return latency(window_size_); }
+
+  // Max latency of the window.
+  int64_t max_latency() const;
+
+  // Latencies recorded per second in the last `window_size' seconds.
+  int64_t qps(time_t window_size) const;
+  int64_t qps() const { return qps(window_size_); }
+
+  // Number of latencies recorded since the start.
+  int64_t count() const { return percentile_.GetNum(); }
+
+  // Sum of the latencies recorded since the start.
+  int64_t sum() const;
+
+  // Latency which is greater than or equal to `ratio' of the latencies
+  // in the window, e.g. latency_percentile(0.99) for p99.
+  int64_t latency_percentile(double ratio) const;
+
+  time_t window_size() const { return window_size_; }
+
+  // Percentiles of the window, the count and the sum.
+  void get_summary(Summary* summary) const;
+
+ private:
+  // The average latency, which gives the summary of the recorder.
+  class LatencyStatus : public PassiveStatus<int64_t> {
+   public:
+    explicit LatencyStatus(LatencyRecorder* recorder);
+
+    bool get_summary(Summary* summary) const override;
+
+   private:
+    const LatencyRecorder* recorder_;
+  };
+
+  // Get the window of the histogram, false if it is not ready.
+  bool GetWindow(time_t window_size, detail::PercentileHistogram* histogram,
+                 tutil::Duration* span) const;
+
+  time_t window_size_;
+  detail::Percentile percentile_;
+  Maxer<int64_t> max_latency_;
+  Window<Maxer<int64_t>> max_latency_window_;
+  detail::Percentile::sampler_type* percentile_sampler_;
+
+  LatencyStatus latency_status_;
+  // The window of Maxer shows the lowest int64_t when it is empty.
+  PassiveStatus<int64_t> max_latency_status_;
+  PassiveStatus<int64_t> count_;
+  PassiveStatus<int64_t> sum_;
+  PassiveStatus<int64_t> qps_;
+  PassiveStatus<int64_t> latency_50_;
+  PassiveStatus<int64_t> latency_90_;
+  PassiveStatus<int64_t> latency_99_;
+  PassiveStatus<int64_t> latency_999_;
+};
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_LATENCY_RECORDER_H_
@@ -0,0 +1,345 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Oct 26 15:20:09 CST 2019
+
+#ifndef TESLA_TVAR_MULTI_DIMENSION_H_
+#define TESLA_TVAR_MULTI_DIMENSION_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "log/logging.h"
+#include "tutil/compiler_specific.h"
+#include "tutil/containers/doubly_buffered_data.h"
+#include "tutil/macros.h"
+#include "tutil/streambuf.h"
+#include "tvar/variable.h"
+
+namespace tesla {
+namespace tvar {
+
+// A family of variables of type T told apart by label values, exposed as
+// one variable and dumped as one value per label values:
+//   tvar::MultiDimension<tvar::Adder<int64_t>> rpc_count(
+//       "rpc_count", {"method", "peer"});
+//   ...
+//   tvar::Adder<int64_t>* count = rpc_count.get_stats({"Get", "10.0.0.1"});
+//   if (count) {
+//     *count << 1;
+//   }
+// is dumped as
+//   rpc_count{method="Get",peer="10.0.0.1"} : 1
+// T is a Variable which is default constructible, e.g. Adder, Maxer,
+// IntRecorder. The stats are never exposed themselves.
+//
+// get_stats() of existing label values only reads a snapshot of the stats
+// (see DoublyBufferedData), taking no lock shared with other threads, so
+// callers may look up the stats on every request. Creating stats is
+// serialized and bounded by `max_stats' to keep the number of values
+// dumped under control.
+template <typename T>
+class MultiDimension : public Variable {
+ public:
+  using key_type = std::vector<std::string>;
+
+  static constexpr size_t kDefaultMaxStats = 1024;
+
+  // `labels' are names of the dimensions, e.g. {"method", "peer"}.
+  explicit MultiDimension(const key_type& labels,
+                          size_t max_stats = kDefaultMaxStats)
+      : labels_(labels), max_stats_(max_stats) {}
+
+  MultiDimension(const ::tutil::StringView& name, const key_type& labels,
+                 size_t max_stats = kDefaultMaxStats)
+      : labels_(labels), max_stats_(max_stats) {
+    expose(name);
+  }
+
+  MultiDimension(const ::tutil::StringView& prefix,
+                 const ::tutil::StringView& name, const key_type& labels,
+                 size_t max_stats = kDefaultMaxStats)
+      : labels_(labels), max_stats_(max_stats) {
+    expose_as(prefix, name);
+  }
+
+  ~MultiDimension() {
+    hide();
+    clear_stats();
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(MultiDimension);
+
+  // Get the stats of `label_values', which are created if absent.
+  // Returns nullptr if the number of label values differs from the number
+  // of labels, or `max_stats' stats exist already.
+  T* get_stats(const key_type& label_values);
+
+  bool has_stats(const key_type& label_values) const {
+    return find_stats(label_values) != nullptr;
+  }
+
+  // Delete the stats of `label_values'. CAUTION: pointers returned by
+  // get_stats() for them become invalid.
+  void delete_stats(const key_type& label_values);
+
+  // Delete all stats, with the same caution as delete_stats().
+  void clear_stats();
+
+  size_t count_stats() const;
+
+  // Get label values of all stats.
+  void list_stats(std::vector<key_type>* label_values) const;
+
+  const key_type& labels() const { return labels_; }
+
+  size_t max_stats() const { return max_stats_; }
+
+  // Print all values like `{method="Get"} : 1, {method="Set"} : 2'.
+  void describe(std::ostream& os, bool quote_string) const override;
+
+  bool has_labels() const override { return true; }
+
+  int dump_labeled(Dumper& dumper, const std::string& name,
+                   bool quote_string) const override;
+
+ private:
+  struct KeyHash {
+    size_t operator()(const key_type& key) const {
+      size_t h = 0;
+      for (const std::string& s : key) {
+        h = h * 31 + std::hash<std::string>()(s);
+      }
+      return h;
+    }
+  };
+
+  // Both buffers point to the same stats.
+  using StatsMap = std::unordered_map<key_type, T*, KeyHash>;
+  using Registry = tutil::DoublyBufferedData<StatsMap>;
+
+  T* find_stats(const key_type& label_values) const;
+
+  // Entries of `m' sorted by label values.
+  static void sort_stats(
+      const StatsMap& m,
+      std::vector<const typename StatsMap::value_type*>* stats);
+
+  // Append `{label="value",...}' to `out', escaping the values like
+  // Prometheus does.
+  void append_labels(const key_type& label_values, std::string* out) const;
+
+  const key_type labels_;
+  const size_t max_stats_;
+  // Serialize creation and deletion of stats.
+  std::mutex modify_mutex_;
+  // Read() of DoublyBufferedData is not const.
+  mutable Registry stats_;
+};
+
+template <typename T>
+T* MultiDimension<T>::find_stats(const key_type& label_values) const {
+  typename Registry::ScopedPtr ptr;
+  if (stats_.Read(ptr) != 0) {
+    return nullptr;
+  }
+  auto it = ptr->find(label_values);
+  return it == ptr->end() ? nullptr : it->second;
+}
+
+template <typename T>
+T* MultiDimension<T>::get_stats(const key_type& label_values) {
+  T* stats = find_stats(label_values);
+  if (TESLA_LIKELY(stats != nullptr)) {
+    return stats;
+  }
+  if (label_values.size() != labels_.size()) {
+    LOG_ERROR << "Fail to get stats of " << name() << ": "
+              << label_values.size() << " label values for "
+              << labels_.size() << " labels";
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> guard(modify_mutex_);
+  // Created by another thread meanwhile.
+  stats = find_stats(label_values);
+  if (stats != nullptr) {
+    return stats;
+  }
+  if (count_stats() >= max_stats_) {
+    LOG_ERROR << "Fail to create stats of " << name() << ": reached "
+              << max_stats_ << " stats";
+    return nullptr;
+  }
+  stats = new T;
+  stats_.Modify([&label_values, stats](StatsMap& m) {
+    m.emplace(label_values, stats);
+    return 1;
+  });
+  return stats;
+}
+
+template <typename T>
+void MultiDimension<T>::delete_stats(const key_type& label_values) {
+  std::lock_guard<std::mutex> guard(modify_mutex_);
+  T* stats = nullptr;
+  stats_.Modify([&label_values, &stats](StatsMap& m) {
+    auto it = m.find(label_values);
+    if (it == m.end()) {
+      return 0;
+    }
+    stats = it->second;
+    m.erase(it);
+    return 1;
+  });
+  // No reader sees `stats' after Modify() returns.
+  delete stats;
+}
+
+template <typename T>
+void MultiDimension<T>::clear_stats() {
+  std::lock_guard<std::mutex> guard(modify_mutex_);
+  StatsMap old;
+  stats_.Modify([&old](StatsMap& m) {
+    if (old.empty()) {
+      old = m;
+    }
+    m.clear();
+    return 1;
+  });
+  for (auto it = old.begin(); it != old.end(); ++it) {
+    delete it->second;
+  }
+}
+
+template <typename T>
+size_t MultiDimension<T>::count_stats() const {
+  typename Registry::ScopedPtr ptr;
+  if (stats_.Read(ptr) != 0) {
+    return 0;
+  }
+  return ptr->size();
+}
+
+template <typename T>
+void MultiDimension<T>::list_stats(std::vector<key_type>* label_values) const {
+  label_values->clear();
+  typename Registry::ScopedPtr ptr;
+  if (stats_.Read(ptr) != 0) {
+    return;
+  }
+  label_values->reserve(ptr->size());
+  for (auto it = ptr->begin(); it != ptr->end(); ++it) {
+    label_values->push_back(it->first);
+  }
+}
+
+template <typename T>
+void MultiDimension<T>::sort_stats(
+    const StatsMap& m,
+    std::vector<const typename StatsMap::value_type*>* stats) {
+  stats->clear();
+  stats->reserve(m.size());
+  for (auto it = m.begin(); it != m.end(); ++it) {
+    stats->push_back(&*it);
+  }
+  std::sort(stats->begin(), stats->end(),
+            [](const typename StatsMap::value_type* lhs,
+               const typename StatsMap::value_type* rhs) {
+              return lhs->first < rhs->first;
+            });
+}
+
+template <typename T>
+void MultiDimension<T>::append_labels(const key_type& label_values,
+                                      std::string* out) const {
+  out->push_back('{');
+  for (size_t i = 0; i < labels_.size(); ++i) {
+    if (i != 0) {
+      out->push_back(',');
+    }
+    out->append(labels_[i]);
+    out->append("=\"");
+    for (char c : label_values[i]) {
+      if (c == '\\' || c == '"') {
+        out->push_back('\\');
+        out->push_back(c);
+      } else if (c == '\n') {
+        out->append("\\n");
+      } else {
+        out->push_back(c);
+      }
+    }
+    out->push_back('"');
+  }
+  out->push_back('}');
+}
+
+template <typename T>
+void MultiDimension<T>::describe(std::ostream& os, bool quote_string) const {
+  // Deleted stats are freed after the snapshot is released.
+  typename Registry::ScopedPtr ptr;
+  if (stats_.Read(ptr) != 0) {
+    return;
+  }
+  std::vector<const typename StatsMap::value_type*> stats;
+  sort_stats(*ptr.get(), &stats);
+  std::string labels;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    labels.clear();
+    append_labels(stats[i]->first, &labels);
+    if (i != 0) {
+      os << ", ";
+    }
+    os << labels << " : ";
+    stats[i]->second->describe(os, quote_string);
+  }
+}
+
+template <typename T>
+int MultiDimension<T>::dump_labeled(Dumper& dumper, const std::string& name,
+                                    bool quote_string) const {
+  typename Registry::ScopedPtr ptr;
+  if (stats_.Read(ptr) != 0) {
+    return 0;
+  }
+  std::vector<const typename StatsMap::value_type*> stats;
+  sort_stats(*ptr.get(), &stats);
+  ::tutil::CharArrayStreamBuf streambuf;
+  std::ostream os(&streambuf);
+  std::string labeled_name;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    labeled_name.assign(name);
+    append_labels(stats[i]->first, &labeled_name);
+    stats[i]->second->describe(os, quote_string);
+    if (!dumper.dump(labeled_name, streambuf.data())) {
+      return -1;
+    }
+    streambuf.reset();
+  }
+  return static_cast<int>(stats.size());
+}
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_MULTI_DIMENSION_H_
@@ -0,0 +1,136 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 21 21:03:50 CST 2019
+
+#ifndef TESLA_TVAR_PASSIVE_STATUS_H_
+#define TESLA_TVAR_PASSIVE_STATUS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include "tutil/time.h"
+#include "tvar/variable.h"
+#include "tvar/detail/describe_value.h"
+
+namespace tesla {
+namespace tvar {
+
+// Display a value which is computed by a callback only when needed.
+// Example:
+//   static int64_t GetQueueSize(void* arg) {
+//     return static_cast<Queue*>(arg)->size();
+//   }
+//   tvar::PassiveStatus<int64_t> queue_size("queue_size",
+//                                           GetQueueSize, &queue);
+// or with any callable:
+//   tvar::PassiveStatus<int64_t> pool_size(
+//       "pool_size", [&pool] { return pool.size(); });
+//
+// Values which are expensive to compute can be cached, so that scrapes
+// and dumps in a row call the callback once:
+//   queue_size.set_cache_ms(1000);
+template <typename T>
+class PassiveStatus : public Variable {
+ public:
+  using value_type = T;
+  using Getter = T (*)(void*);
+  using Callback = std::function<T()>;
+
+  PassiveStatus(Getter getfn, void* arg) : callback_(Bind(getfn, arg)) {}
+
+  PassiveStatus(const ::tutil::StringView& name, Getter getfn, void* arg)
+      : callback_(Bind(getfn, arg)) {
+    expose(name);
+  }
+
+  PassiveStatus(const ::tutil::StringView& prefix,
+                const ::tutil::StringView& name, Getter getfn, void* arg)
+      : callback_(Bind(getfn, arg)) {
+    expose_as(prefix, name);
+  }
+
+  explicit PassiveStatus(Callback callback) : callback_(std::move(callback)) {}
+
+  PassiveStatus(const ::tutil::StringView& name, Callback callback)
+      : callback_(std::move(callback)) {
+    expose(name);
+  }
+
+  PassiveStatus(const ::tutil::StringView& prefix,
+                const ::tutil::StringView& name, Callback callback)
+      : callback_(std::move(callback)) {
+    expose_as(prefix, name);
+  }
+
+  ~PassiveStatus() { hide(); }
+
+  // Reuse the value computed in the last `cache_ms' milliseconds instead of
+  // calling the callback again. 0 (default) disables caching.
+  void set_cache_ms(int64_t cache_ms) {
+    std::lock_guard<std::mutex> guard(cache_mutex_);
+    cache_ns_.store(cache_ms * 1000000, std::memory_order_relaxed);
+    cached_ns_ = 0;
+  }
+
+  T GetValue() const;
+
+  void describe(std::ostream& os, bool /*quote_string*/) const override {
+    detail::DescribeValue(os, GetValue());
+  }
+
+ private:
+  static Callback Bind(Getter getfn, void* arg) {
+    if (getfn == nullptr) {
+      return Callback();
+    }
+    return [getfn, arg] { return getfn(arg); };
+  }
+
+  T Compute() const { return callback_ ? callback_() : T(); }
+
+  const Callback callback_;
+
+  std::atomic<int64_t> cache_ns_{0};
+  mutable std::mutex cache_mutex_;
+  mutable int64_t cached_ns_{0};  // when cached_ was computed, 0 if never
+  mutable T cached_{};            // protected by cache_mutex_
+};
+
+template <typename T>
+T PassiveStatus<T>::GetValue() const {
+  const int64_t cache_ns = cache_ns_.load(std::memory_order_relaxed);
+  if (cache_ns <= 0) {
+    return Compute();
+  }
+  // Computed with the lock held, so concurrent readers of an expired
+  // value wait for one computation instead of starting their own.
+  std::lock_guard<std::mutex> guard(cache_mutex_);
+  const int64_t now = tutil::clock_ns();
+  if (cached_ns_ == 0 || now - cached_ns_ >= cache_ns) {
+    cached_ = Compute();
+    cached_ns_ = now;
+  }
+  return cached_;
+}
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_PASSIVE_STATUS_H_
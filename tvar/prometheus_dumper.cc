@@ -0,0 +1,222 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Wed Oct 23 20:31:07 CST 2019
+
+#include "tvar/prometheus_dumper.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mutex>
+
+#include "log/logstream.h"
+#include "tutil/strings/integer_format.h"
+
+namespace tesla {
+namespace tvar {
+
+namespace {
+
+// Metric names are [a-zA-Z_:][a-zA-Z0-9_:]*.
+bool IsValidName(const ::tutil::StringView& name) {
+  if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+    return false;
+  }
+  for (char c : name) {
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+          (c >= '0' && c <= '9') || c == '_' || c == ':')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parse the whole `s' as a number.
+bool ParseNumber(const ::tutil::StringView& s, double* value) {
+  char buf[64];
+  if (s.empty() || s.size() >= sizeof(buf)) {
+    return false;
+  }
+  memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  char* end = nullptr;
+  *value = strtod(buf, &end);
+  return end == buf + s.size();
+}
+
+void AppendValue(std::string* out, const ::tutil::StringView& text,
+                 double value) {
+  if (isnan(value)) {
+    out->append("NaN");
+  } else if (isinf(value)) {
+    out->append(value > 0 ? "+Inf" : "-Inf");
+  } else {
+    out->append(text.data(), text.size());
+  }
+}
+
+} // namespace
+
+bool PrometheusDumper::dump(const std::string& name,
+                            const ::tutil::StringView& description) {
+  // Values of MultiDimension depend on the family written before them,
+  // they are not cached.
+  if (cache_ == nullptr || name.empty() || name.back() == '}') {
+    DumpUncached(name, description);
+    return true;
+  }
+  PrometheusCache::Entry* entry = cache_->Find(name);
+  if (entry->description.size() == description.size() &&
+      memcmp(entry->description.data(), description.data(),
+             description.size()) == 0) {
+    out_->append(entry->text);
+    return true;
+  }
+  const size_t begin = out_->size();
+  DumpUncached(name, description);
+  entry->description.assign(description.data(), description.size());
+  entry->text.assign(*out_, begin, std::string::npos);
+  return true;
+}
+
+void PrometheusDumper::DumpUncached(const std::string& name,
+                                    const ::tutil::StringView& description) {
+  const ::tutil::StringView name_view(name.data(), name.size());
+  double value = 0;
+  const size_t brace = name.find('{');
+  if (brace != std::string::npos) {
+    // A value of MultiDimension, whose labels are already in the format.
+    if (name.back() == '}' && IsValidName(name_view.substr(0, brace)) &&
+        ParseNumber(description, &value)) {
+      WriteLabeled(name_view, brace, description, value);
+    }
+    return;
+  }
+  if (!IsValidName(name_view) || !ParseNumber(description, &value)) {
+    return;
+  }
+  WriteGauge(name_view, description, value);
+}
+
+bool PrometheusDumper::dump_summary(const std::string& name,
+                                    const ::tutil::StringView& description,
+                                    const Summary& summary) {
+  if (!IsValidName(::tutil::StringView(name.data(), name.size()))) {
+    return true;
+  }
+  char buf[32];
+  out_->append("# TYPE ");
+  out_->append(name);
+  out_->append(" summary\n");
+  for (int i = 0; i < summary.quantile_count; ++i) {
+    out_->append(name);
+    out_->append("{quantile=\"");
+    out_->append(buf, log::FormatDouble(buf, summary.ratios[i]));
+    out_->append("\"} ");
+    out_->append(buf, ::tutil::FormatInteger(buf, summary.values[i]));
+    out_->push_back('\n');
+  }
+  out_->append(name);
+  out_->append("_sum ");
+  out_->append(buf, ::tutil::FormatInteger(buf, summary.sum));
+  out_->push_back('\n');
+  out_->append(name);
+  out_->append("_count ");
+  out_->append(buf, ::tutil::FormatInteger(buf, summary.count));
+  out_->push_back('\n');
+  return true;
+}
+
+void PrometheusDumper::WriteGauge(const ::tutil::StringView& name,
+                                  const ::tutil::StringView& text,
+                                  double value) {
+  out_->append("# TYPE ");
+  out_->append(name.data(), name.size());
+  out_->append(" gauge\n");
+  out_->append(name.data(), name.size());
+  out_->push_back(' ');
+  AppendValue(out_, text, value);
+  out_->push_back('\n');
+}
+
+void PrometheusDumper::WriteLabeled(const ::tutil::StringView& name,
+                                    size_t brace,
+                                    const ::tutil::StringView& text,
+                                    double value) {
+  // Values of a family are dumped one after another, type them once.
+  if (family_.size() != brace || family_.compare(0, brace, name.data(),
+                                                 brace) != 0) {
+    family_.assign(name.data(), brace);
+    out_->append("# TYPE ");
+    out_->append(family_);
+    out_->append(" gauge\n");
+  }
+  out_->append(name.data(), name.size());
+  out_->push_back(' ');
+  AppendValue(out_, text, value);
+  out_->push_back('\n');
+}
+
+PrometheusCache::Entry* PrometheusCache::Find(const std::string& name) {
+  if (next_entries_.capacity() < entries_.size()) {
+    next_entries_.reserve(entries_.size());
+  }
+  // Skip the variables gone since the last scrape.
+  int cmp = -1;
+  while (cursor_ < entries_.size() &&
+         (cmp = entries_[cursor_].name.compare(name)) < 0) {
+    ++cursor_;
+  }
+  if (cmp == 0) {
+    next_entries_.push_back(std::move(entries_[cursor_++]));
+  } else {
+    next_entries_.emplace_back();
+    next_entries_.back().name = name;
+  }
+  return &next_entries_.back();
+}
+
+void PrometheusCache::Finish() {
+  entries_.swap(next_entries_);
+  next_entries_.clear();
+  cursor_ = 0;
+}
+
+int dump_prometheus_metrics(std::string* out) {
+  DumpOptions options;
+  options.quote_string = false;
+  return dump_prometheus_metrics(out, options);
+}
+
+int dump_prometheus_metrics(std::string* out, const DumpOptions& options) {
+  static std::mutex cache_mutex;
+  static PrometheusCache* cache = new PrometheusCache;
+  // A filtered dump would make the cache forget the others. Concurrent
+  // scrapes go without the cache rather than wait.
+  std::unique_lock<std::mutex> lock(cache_mutex, std::defer_lock);
+  const bool use_cache = options.white_wildcards.empty() &&
+                         options.black_wildcards.empty() && lock.try_lock();
+  PrometheusDumper dumper(out, use_cache ? cache : nullptr);
+  const int rc = Variable::dump_exposed(dumper, &options);
+  if (use_cache) {
+    cache->Finish();
+  }
+  return rc;
+}
+
+} // namespace tvar
+} // namespace tesla
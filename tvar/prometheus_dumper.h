@@ -0,0 +1,129 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Wed Oct 23 20:31:07 CST 2019
+
+#ifndef TESLA_TVAR_PROMETHEUS_DUMPER_H_
+#define TESLA_TVAR_PROMETHEUS_DUMPER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "tvar/variable.h"
+
+namespace tesla {
+namespace tvar {
+
+// Write variables in the text exposition format of Prometheus:
+//   # TYPE process_uptime gauge
+//   process_uptime 3600
+// Variables whose values are not numbers are skipped. Variables having a
+// summary (see Variable::get_summary()), e.g. <prefix>_latency of
+// LatencyRecorder, are written as summaries:
+//   # TYPE rpc_latency summary
+//   rpc_latency{quantile="0.5"} 120
+//   ...
+//   rpc_latency_sum 1200000
+//   rpc_latency_count 10000
+// Values of a MultiDimension keep their labels:
+//   # TYPE rpc_count gauge
+//   rpc_count{method="Get"} 12
+//   rpc_count{method="Set"} 3
+// Example:
+//   std::string out;  // keep it to reuse the memory
+//   out.clear();
+//   tvar::PrometheusDumper dumper(&out);
+//   tvar::Variable::dump_exposed(dumper, &options);
+class PrometheusCache;
+class PrometheusDumper : public Dumper {
+ public:
+  // Append to `out', which is not cleared. Lines of gauges are taken from
+  // `cache' if it's not NULL and their values did not change.
+  explicit PrometheusDumper(std::string* out,
+                            PrometheusCache* cache = nullptr)
+      : out_(out), cache_(cache) {}
+
+  bool dump(const std::string& name,
+            const ::tutil::StringView& description) override;
+
+  bool dump_summary(const std::string& name,
+                    const ::tutil::StringView& description,
+                    const Summary& summary) override;
+
+ private:
+  void DumpUncached(const std::string& name,
+                    const ::tutil::StringView& description);
+
+  // `text' is written unless `value' is NaN or infinite.
+  void WriteGauge(const ::tutil::StringView& name,
+                  const ::tutil::StringView& text, double value);
+
+  // Write `name' like `rpc_count{method="Get"}' whose family name ends
+  // at `brace'.
+  void WriteLabeled(const ::tutil::StringView& name, size_t brace,
+                    const ::tutil::StringView& text, double value);
+
+  std::string* out_;
+  PrometheusCache* cache_;
+  // Name of the family whose values were written last.
+  std::string family_;
+};
+
+// Lines written for each gauge by the last scrape, so that a gauge whose
+// description did not change is copied instead of parsed and formatted
+// again. Values are still described every scrape, which is most of the
+// remaining cost. Variables are expected in the order of names, as
+// dump_exposed() gives them, the cache is merged with them like sorted
+// lists. Not thread-safe, give it to one dumper at a time.
+class PrometheusCache {
+ public:
+  PrometheusCache() : cursor_(0) {}
+
+  // Call after each complete scrape with this cache. Variables which
+  // were not dumped, e.g. hidden ones, are forgotten.
+  void Finish();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  friend class PrometheusDumper;
+
+  struct Entry {
+    std::string name;
+    std::string description;
+    std::string text;  // empty if the variable is skipped
+  };
+
+  // Entry of `name' for the current scrape. It's taken from the last
+  // scrape if there, otherwise it has an empty description.
+  Entry* Find(const std::string& name);
+
+  std::vector<Entry> entries_;       // of the last scrape
+  size_t cursor_;                    // in `entries_'
+  std::vector<Entry> next_entries_;  // of the current scrape
+};
+
+// Dump all exposed variables in the Prometheus format into `out', which is
+// not cleared. Returns number of dumped variables, -1 on error.
+// Unfiltered dumps share a global PrometheusCache.
+int dump_prometheus_metrics(std::string* out);
+int dump_prometheus_metrics(std::string* out, const DumpOptions& options);
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_PROMETHEUS_DUMPER_H_
@@ -0,0 +1,220 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 20 10:41:26 CST 2019
+
+#ifndef TESLA_TVAR_RECORDER_H_
+#define TESLA_TVAR_RECORDER_H_
+
+#include <stdint.h>
+
+#include <limits>
+#include <ostream>
+
+#include "tvar/variable.h"
+#include "tvar/detail/combiner.h"
+#include "tvar/detail/sampler.h"
+
+#include "tutil/compiler_specific.h"
+
+#include "log/logging.h"
+
+namespace tesla {
+namespace tvar {
+
+// Sum and number of recorded values.
+struct Stat {
+  Stat() : sum(0), num(0) {}
+  Stat(int64_t sum2, int64_t num2) : sum(sum2), num(num2) {}
+
+  int64_t sum;
+  int64_t num;
+
+  int64_t GetAverageInt() const {
+    return num == 0 ? 0 : sum / num;
+  }
+
+  double GetAverageDouble() const {
+    return num == 0 ? 0.0 : static_cast<double>(sum) / num;
+  }
+
+  bool operator==(const Stat& rhs) const {
+    return sum == rhs.sum && num == rhs.num;
+  }
+};
+
+// Printed as the integral average.
+inline std::ostream& operator<<(std::ostream& os, const Stat& s) {
+  return os << s.GetAverageInt();
+}
+
+namespace detail {
+
+// One thread keeps its sum and count in a single uint64_t, so that the
+// atomic specialization of ElementContainer applies and recording a value
+// is one relaxed compare-and-swap:
+//   | num (20 bits) | sum (44 bits, two's complement) |
+// When either part would overflow, the thread commits its value into the
+// global result first.
+constexpr int kSumBits = 44;
+constexpr uint64_t kMaxNumPerThread = (1ULL << (64 - kSumBits)) - 1;
+constexpr int64_t kMaxSumPerThread = (1LL << (kSumBits - 1)) - 1;
+constexpr int64_t kMinSumPerThread = -(1LL << (kSumBits - 1));
+constexpr uint64_t kSumMask = (1ULL << kSumBits) - 1;
+
+inline uint64_t CompressStat(uint64_t num, int64_t sum) {
+  return (num << kSumBits) | (static_cast<uint64_t>(sum) & kSumMask);
+}
+
+inline uint64_t GetNum(uint64_t n) { return n >> kSumBits; }
+
+inline int64_t GetSum(uint64_t n) {
+  // Move the sign bit of the sum to the top and shift it back.
+  return static_cast<int64_t>(n << (64 - kSumBits)) >> (64 - kSumBits);
+}
+
+struct AddStat {
+  void operator()(Stat& lhs, const Stat& rhs) const {
+    lhs.sum += rhs.sum;
+    lhs.num += rhs.num;
+  }
+
+  void operator()(Stat& lhs, uint64_t rhs) const {
+    lhs.sum += GetSum(rhs);
+    lhs.num += GetNum(rhs);
+  }
+};
+
+struct MinusStat {
+  void operator()(Stat& lhs, const Stat& rhs) const {
+    lhs.sum -= rhs.sum;
+    lhs.num -= rhs.num;
+  }
+};
+
+} // namespace detail
+
+// For calculating average of numbers.
+// Example:
+//   tvar::IntRecorder latency("latency_us");
+//   latency << 10 << 20 << 30;
+//   latency.Average();  // 20
+//
+// Values are clamped into the range of int32_t.
+class IntRecorder : public Variable {
+ public:
+  using value_type    = Stat;
+  using op_type       = detail::AddStat;
+  using inv_op_type   = detail::MinusStat;
+  using combiner_type = detail::AgentCombiner<Stat, uint64_t, detail::AddStat>;
+  using agent_type    = combiner_type::Agent;
+  using sampler_type  = detail::ReducerSampler<IntRecorder, Stat,
+                                               detail::AddStat,
+                                               detail::MinusStat>;
+
+  IntRecorder() : sampler_(nullptr) {}
+
+  explicit IntRecorder(const ::tutil::StringView& name) : sampler_(nullptr) {
+    expose(name);
+  }
+
+  IntRecorder(const ::tutil::StringView& prefix,
+              const ::tutil::StringView& name)
+      : sampler_(nullptr) {
+    expose_as(prefix, name);
+  }
+
+  ~IntRecorder() {
+    hide();
+    if (sampler_) {
+      sampler_->Destroy();
+      sampler_ = nullptr;
+    }
+  }
+
+  // Note: The input type is actually int. Use int64_t to check overflow.
+  IntRecorder& operator<<(int64_t value);
+
+  int64_t Average() const { return GetValue().GetAverageInt(); }
+
+  double AverageDouble() const { return GetValue().GetAverageDouble(); }
+
+  // Walks through all threads which ever recorded values.
+  Stat GetValue() const { return combiner_.CombineAllAgents(); }
+
+  Stat Reset() { return combiner_.ResetAllAgents(); }
+
+  const detail::AddStat& op() const { return combiner_.op(); }
+  const detail::MinusStat& inv_op() const { return inv_op_; }
+
+  void describe(std::ostream& os, bool /*quote_string*/) const override {
+    os << Average();
+  }
+
+  bool Valid() const { return combiner_.Valid(); }
+
+  // See Reducer::get_sampler().
+  sampler_type* get_sampler() {
+    if (sampler_ == nullptr) {
+      sampler_ = new sampler_type(this);
+      sampler_->Schedule();
+    }
+    return sampler_;
+  }
+
+ private:
+  combiner_type combiner_;
+  detail::MinusStat inv_op_;
+  sampler_type* sampler_;
+};
+
+inline IntRecorder& IntRecorder::operator<<(int64_t value) {
+  if (TESLA_UNLIKELY(value > std::numeric_limits<int32_t>::max())) {
+    value = std::numeric_limits<int32_t>::max();
+  } else if (TESLA_UNLIKELY(value < std::numeric_limits<int32_t>::min())) {
+    value = std::numeric_limits<int32_t>::min();
+  }
+  agent_type* agent = combiner_.GetOrCreateTlsAgent();
+  if (TESLA_UNLIKELY(agent == nullptr)) {
+    LOG_ERROR << "Fail to create agent";
+    return *this;
+  }
+  uint64_t n;
+  agent->element.load(&n);
+  uint64_t num;
+  int64_t sum;
+  do {
+    num = detail::GetNum(n);
+    sum = detail::GetSum(n);
+    if (TESLA_UNLIKELY(num + 1 > detail::kMaxNumPerThread ||
+                       sum + value > detail::kMaxSumPerThread ||
+                       sum + value < detail::kMinSumPerThread)) {
+      // Flush the value of this thread into the global result. The agent
+      // is zero afterwards unless a Reset() runs concurrently, which the
+      // compare-and-swap below notices.
+      combiner_.CommitAndClear(agent);
+      agent->element.load(&n);
+      num = detail::GetNum(n);
+      sum = detail::GetSum(n);
+    }
+  } while (!agent->element.compare_exchange_weak(
+      n, detail::CompressStat(num + 1, sum + value)));
+  return *this;
+}
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_RECORDER_H_
@@ -22,22 +22,30 @@
 #include "tvar/detail/sampler.h"
 #include "tvar/detail/series.h"
 #include "tvar/detail/combiner.h"
+#include "tvar/detail/describe_value.h"
 
 #include "tutil/type_traits.h"
 #include "tutil/compiler_specific.h"
 
 #include "log/logging.h"
 
+#include <limits>
+
+#include <gflags/gflags.h>
+
 namespace tesla {
 namespace tvar {
 
+DECLARE_bool(tvar_save_series);
+
 template <typename T, typename Op, typename InvOp = detail::VoidOp>
 class Reducer : public Variable {
  public:
   using combiner_type = typename detail::AgentCombiner<T, T, Op>;
   using agent_type    = typename combiner_type::Agent;
-  // TODO(tesla): implement ReducerSampler.
-  //using sampler_type  = detail::ReducerSampler<Reducer, T, Op, InvOp>;
+  using sampler_type  = detail::ReducerSampler<Reducer, T, Op, InvOp>;
+  using value_type    = T;
+  using op_type       = Op;
   
   class SeriesSampler : public detail::Sampler {
    public:
@@ -48,7 +56,7 @@ class Reducer : public Variable {
 
     void TakeSample() { series_.Append(owner_->GetValue()); }
 
-    void Describe(std::ostream& os) { series_.Describe(os); }
+    void Describe(std::ostream& os) { series_.Describe(os, nullptr); }
 
    private:
     Reducer* owner_{nullptr};
@@ -60,16 +68,22 @@ class Reducer : public Variable {
           const Op& op = Op(),
           const InvOp& inv_op = InvOp())
       : combiner_(identity, identity, op),
+        sampler_(nullptr),
         series_sampler_(NULL),
         inv_op_(inv_op) {
   } 
 
   ~Reducer() {
-    //hide();
-    //if (series_sampler_) {
-    //  series_sampler_->Destroy();
-    //  series_sampler_ = nullptr;
-    //}
+    // Calling hide() manually is a MUST required by Variable.
+    hide();
+    if (sampler_) {
+      sampler_->Destroy();
+      sampler_ = nullptr;
+    }
+    if (series_sampler_) {
+      series_sampler_->Destroy();
+      series_sampler_ = nullptr;
+    }
   }
 
   // Add a value.
@@ -84,7 +98,8 @@ class Reducer : public Variable {
     return combiner_.CombineAllAgents();
   }
 
-  // Reset the reduced value to T().
+  // Reset the reduced value to the identity given to the constructor,
+  // e.g. 0 for Adder and the lowest value of T for Maxer.
   // Returns the reduced value before reset.
   T Reset() { return combiner_.ResetAllAgents(); }
 
@@ -93,8 +108,30 @@ class Reducer : public Variable {
     if (std::is_same<T, std::string>::value && quote_string) {
       os << '"' << GetValue() << '"';
     } else {
-      os << GetValue();
+      detail::DescribeValue(os, GetValue());
+    }
+  }
+
+  int describe_series(std::ostream& os,
+                      const SeriesOptions& options) const override {
+    if (series_sampler_ == nullptr) {
+      return 1;
+    }
+    if (!options.test_only) {
+      series_sampler_->Describe(os);
+    }
+    return 0;
+  }
+
+  // Get the sampler which Window/PerSecond read from, it is created and
+  // scheduled on the first call. Not thread-safe, windows are expected to
+  // be created at initialization.
+  sampler_type* get_sampler() {
+    if (sampler_ == nullptr) {
+      sampler_ = new sampler_type(this);
+      sampler_->Schedule();
     }
+    return sampler_;
   }
 
   // True if this reducer is constructed successfully.
@@ -104,9 +141,26 @@ class Reducer : public Variable {
   const Op& op() const { return combiner_.op(); }
   const InvOp& inv_op() const { return inv_op_; }
 
+ protected:
+  int expose_impl(const ::tutil::StringView& prefix,
+                  const ::tutil::StringView& name,
+                  DisplayFilter display_filter) override {
+    const int rc = Variable::expose_impl(prefix, name, display_filter);
+    // Series only make sense for reducers which can be inverted, e.g.
+    // Adder, and whose values can be averaged.
+    if constexpr (!std::is_same<InvOp, detail::VoidOp>::value &&
+                  !std::is_same<T, std::string>::value) {
+      if (rc == 0 && series_sampler_ == nullptr && FLAGS_tvar_save_series) {
+        series_sampler_ = new SeriesSampler(this, combiner_.op());
+        series_sampler_->Schedule();
+      }
+    }
+    return rc;
+  }
+
  private:
   combiner_type combiner_;
-  //sampler_type* sampler_;
+  sampler_type* sampler_;
   SeriesSampler* series_sampler_;
   InvOp inv_op_;
 }; // class Reducer
@@ -142,6 +196,30 @@ struct MinusFrom {
   }
 };
 
+// Adder of integers is a single fetch_add per operator<<.
+template <typename T>
+struct IsAtomicAdd<AddTo<T>, T> : std::is_integral<T> {};
+
+template <typename T>
+struct MaxTo {
+  void operator()(T& lhs,
+      typename tutil::add_cr_non_integral<T>::type rhs) const {
+    if (lhs < rhs) {
+      lhs = rhs;
+    }
+  }
+};
+
+template <typename T>
+struct MinTo {
+  void operator()(T& lhs,
+      typename tutil::add_cr_non_integral<T>::type rhs) const {
+    if (rhs < lhs) {
+      lhs = rhs;
+    }
+  }
+};
+
 }  // namespace detail
 
 template <typename T>
@@ -154,6 +232,35 @@ class Adder : public Reducer<T, detail::AddTo<T>, detail::MinusFrom<T>> {
   ~Adder() {}
 };
 
+// Get the maximum of values.
+// Values which did not change the maximum of the thread cost one relaxed
+// load, others one compare-and-swap.
+//   tvar::Maxer<int64_t> max_latency;
+//   max_latency << 1 << 3 << 2;
+//   max_latency.GetValue();  // 3
+// Combined with Window, the maximum of last N seconds is exported, in
+// which case the Maxer is reset by the sampler every second.
+template <typename T>
+class Maxer : public Reducer<T, detail::MaxTo<T>> {
+ public:
+  using Base = Reducer<T, detail::MaxTo<T>>;
+  using value_type = T;
+ public:
+  Maxer() : Base(std::numeric_limits<T>::lowest()) {}
+  ~Maxer() {}
+};
+
+// Get the minimum of values.
+template <typename T>
+class Miner : public Reducer<T, detail::MinTo<T>> {
+ public:
+  using Base = Reducer<T, detail::MinTo<T>>;
+  using value_type = T;
+ public:
+  Miner() : Base(std::numeric_limits<T>::max()) {}
+  ~Miner() {}
+};
+
 }  // namespace tvar
 }  // namespace tesla
 
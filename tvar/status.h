@@ -0,0 +1,119 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 27 16:05:31 CST 2019
+
+#ifndef TESLA_TVAR_STATUS_H_
+#define TESLA_TVAR_STATUS_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include "tvar/variable.h"
+#include "tvar/detail/describe_value.h"
+#include "tvar/detail/is_atomical.h"
+
+namespace tesla {
+namespace tvar {
+
+// Display a value which is set explicitly, e.g. a configuration or the
+// state of a component:
+//   tvar::Status<int64_t> max_connections("max_connections", 1024);
+//   ...
+//   max_connections.set_value(2048);
+// Unlike reducers, the last set_value() wins. Integral and floating point
+// values are atomic, other values are copied under a lock.
+template <typename T, typename Enable = void>
+class Status : public Variable {
+ public:
+  using value_type = T;
+
+  Status() = default;
+
+  Status(const ::tutil::StringView& name, const T& value) : value_(value) {
+    expose(name);
+  }
+
+  Status(const ::tutil::StringView& prefix, const ::tutil::StringView& name,
+         const T& value)
+      : value_(value) {
+    expose_as(prefix, name);
+  }
+
+  ~Status() { hide(); }
+
+  T get_value() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return value_;
+  }
+
+  void set_value(const T& value) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    value_ = value;
+  }
+
+  void describe(std::ostream& os, bool quote_string) const override {
+    if (std::is_same<T, std::string>::value && quote_string) {
+      os << '"' << get_value() << '"';
+    } else {
+      detail::DescribeValue(os, get_value());
+    }
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  T value_{};
+};
+
+template <typename T>
+class Status<T, typename std::enable_if<detail::is_atomical<T>::value>::type>
+    : public Variable {
+ public:
+  using value_type = T;
+
+  Status() : value_(T()) {}
+
+  Status(const ::tutil::StringView& name, const T& value) : value_(value) {
+    expose(name);
+  }
+
+  Status(const ::tutil::StringView& prefix, const ::tutil::StringView& name,
+         const T& value)
+      : value_(value) {
+    expose_as(prefix, name);
+  }
+
+  ~Status() { hide(); }
+
+  T get_value() const { return value_.load(std::memory_order_relaxed); }
+
+  void set_value(const T& value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  void describe(std::ostream& os, bool /*quote_string*/) const override {
+    detail::DescribeValue(os, get_value());
+  }
+
+ private:
+  std::atomic<T> value_;
+};
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_STATUS_H_
@@ -17,22 +17,29 @@
 
 #include "tvar/variable.h"
 
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <algorithm>      // std::sort
+#include <algorithm>      // std::lower_bound
+#include <chrono>         // std::chrono::steady_clock
+#include <map>            // std::map
 #include <memory>         // std::unique_ptr
-#include <mutex>          // std::mutex
-#include <set>            // std::set
+#include <mutex>          // std::once_flag
 #include <sstream>        // std::ostringstream
-#include <thread>         // std::once_flag
+#include <thread>         // std::thread
 #include <unordered_map>  // std::unorder_map
 
-//#include <glog/logging.h>
 #include <gflags/gflags.h>
 #include "log/logging.h"
 
+#include "tutil/containers/doubly_buffered_data.h"
+#include "tutil/get_leaky_singleton.h"
 #include "tutil/streambuf.h"
 #include "tutil/wildcard_matcher.h"
+#include "tvar/default_variables.h"
 
 namespace tesla {
 namespace tvar {
@@ -56,62 +63,33 @@ DEFINE_bool(tvar_log_dumpped, false,
             "[For debugging] print dumpped info"
             " into logstream before call Dumpper");
 
-// -------------------------------------------------------------------------
-
-constexpr static int kSubMapCount = 32;  // must be power of 2
-static_assert(!(kSubMapCount & (kSubMapCount - 1)),
-              "number of submap must be power of 2");
+DEFINE_bool(tvar_save_series, true,
+            "Save values of last 60 seconds, last 60 minutes,"
+            " last 24 hours and last 30 days for ploting");
 
-struct VarMapWithLock {
-  struct VarEntry {
-    Variable* var{nullptr};
-    DisplayFilter display_filter{DISPLAY_ON_ALL};
-  };
-
-  // The expose_name used as key is not need to be ordered, so
-  // we select unordered_map rather than map. In addition, the
-  // performance of unordered_map is higher than map typically.
-  using VarMap = std::unordered_map<std::string, VarEntry>;
+// -------------------------------------------------------------------------
 
-  VarMap map;
-  std::mutex mutex;
+struct VarEntry {
+  Variable* var{nullptr};
+  DisplayFilter display_filter{DISPLAY_ON_ALL};
+  bool has_labels{false};  // cached var->has_labels()
 };
 
-static std::unique_ptr<VarMapWithLock[]> kVarMaps = nullptr;
-static std::once_flag kVarMapsInitOnce;
+// Exposed variables by names. Readers iterate a snapshot without taking any
+// shared lock, in the order of names, expose() and hide() modify both
+// copies and wait until the readers of the old snapshot are gone. So a
+// variable can be destroyed safely once hide() returns.
+using VarMap = std::map<std::string, VarEntry>;
+using VarRegistry = tutil::DoublyBufferedData<VarMap>;
 
-// Allocate a fixed-size VarMapWithLock array.
-static void InitVarMaps() {
-  kVarMaps = std::make_unique<VarMapWithLock[]>(kSubMapCount);
+inline VarRegistry& GetVarRegistry() {
+  return tutil::GetLeakySingleton<VarRegistry>();
 }
 
-// Initialize ONCE.
-// TODO(tesla): Check the type of return value whether is
-// std::unique_ptr<VarMapWithLock[]>&.
-inline decltype(auto) GetVarMaps() {
-  std::call_once(kVarMapsInitOnce, InitVarMaps);
-  return (kVarMaps);
-}
-
-// Calculate the sequence number of VarMapWithLock by `str'.
-inline size_t SubMapIndex(const std::string& str) {
-  if (str.empty()) {
-    return 0;
-  }
-
-  size_t h = 0;
-  for (const char* p = str.c_str(); *p; ++p) {
-    h = h * 5 + *p;
-  }
-  return h & (kSubMapCount - 1);
-}
-
-// Get VarMapWithLock by `name'.
-// TODO(tesla): Check the type of return value whether is VarMapWithLock&.
-inline decltype(auto) GetVarMap(const std::string& name) {
-  auto& m = GetVarMaps()[SubMapIndex(name)];
-  return m;
-}
+// dump_exposed() gives up the snapshot after describing so many variables
+// and goes on with a new one, so that expose() and hide() never wait for a
+// whole dump.
+constexpr static size_t kDumpBatchSize = 256;
 
 // -------------------------------------------------------------------------
 
@@ -121,8 +99,8 @@ Variable::~Variable() {
   //       " dtors to avoid displaying a variable that is just destructing";
 }
 
-int Variable::expose_impl(const tutil::StringView& prefix,
-                          const tutil::StringView& name,
+int Variable::expose_impl(const ::tutil::StringView& prefix,
+                          const ::tutil::StringView& name,
                           DisplayFilter display_filter) {
   if (name.empty()) {
     LOG_ERROR << "Parameter[name] is empty";
@@ -143,17 +121,15 @@ int Variable::expose_impl(const tutil::StringView& prefix,
   }
   to_underscored_name(name_, name);
 
-  auto& m = GetVarMap(name_);
-  {
-    std::lock_guard<std::mutex> lock(m.mutex);
-    auto entry = m.map.find(name_);
-    if (entry == m.map.end()) {
-      // `name_` does not exist, so we insert it.
-      auto& new_entry = m.map[name_];
-      new_entry.var = this;
-      new_entry.display_filter = display_filter;
-      return 0;
-    }
+  const VarEntry entry{this, display_filter, has_labels()};
+  bool inserted = false;
+  // Called once on each copy with the same result.
+  GetVarRegistry().Modify([this, &entry, &inserted](VarMap& m) {
+    inserted = m.emplace(name_, entry).second;
+    return inserted ? 1 : 0;
+  });
+  if (inserted) {
+    return 0;
   }
 
   if (FLAGS_tvar_abort_on_same_name) {
@@ -167,8 +143,20 @@ int Variable::expose_impl(const tutil::StringView& prefix,
     kTvarMayAbort = true;
   }
 
+  // Not describe_exposed(), which may be called by the exposing thread in
+  // ExposeDefaultVariables() already.
+  std::ostringstream value;
+  {
+    VarRegistry::ScopedPtr ptr;
+    if (GetVarRegistry().Read(ptr) == 0) {
+      auto it = ptr->find(name_);
+      if (it != ptr->end()) {
+        it->second.var->describe(value, false);
+      }
+    }
+  }
   LOG_ERROR << "Already exposed `" << name_ << "' whose value is `"
-            << describe_exposed(name_) << '\'';
+            << value.str() << '\'';
   name_.clear();
   return -1;
 }
@@ -178,57 +166,54 @@ bool Variable::hide() {
     return false;
   }
 
-  auto& m = GetVarMap(name_);
-  std::lock_guard<std::mutex> lock(m.mutex);
-  auto it = m.map.find(name_);
-  if (it == m.map.end()) {
-    //CHECK(false) << "`" << name_ << "' must exist";
-  } else {
-    //CHECK(1UL == m.map.erase(name_));
-  }
+  size_t erased = 0;
+  GetVarRegistry().Modify([this, &erased](VarMap& m) {
+    erased = m.erase(name_);
+    return static_cast<int>(erased);
+  });
+  TESLA_DCHECK(erased == 1) << "`" << name_ << "' must exist";
   name_.clear();
   return true;
 }
 
 void Variable::list_exposed(std::vector<std::string>& names,
                             DisplayFilter display_filter) {
+  detail::ExposeDefaultVariables();
   names.clear();
   if (names.size() < 32) {
     names.reserve(count_exposed());
   }
 
-  auto& var_maps = GetVarMaps();
-  for (size_t i = 0; i < kSubMapCount; ++i) {
-    auto& m = var_maps[i];
-    std::lock_guard<std::mutex> lock(m.mutex);
-    for (auto it = m.map.begin(); it != m.map.end(); ++it) {
-      // TODO(tesla): limit max iterated one pass.
-      if (it->second.display_filter & display_filter) {
-        names.push_back(it->first);
-      }
+  VarRegistry::ScopedPtr ptr;
+  if (GetVarRegistry().Read(ptr) != 0) {
+    return;
+  }
+  for (auto it = ptr->begin(); it != ptr->end(); ++it) {
+    if (it->second.display_filter & display_filter) {
+      names.push_back(it->first);
     }
   }
 }
 
 size_t Variable::count_exposed() {
-  size_t n = 0;
-  auto& var_maps = GetVarMaps();
-  for (size_t i = 0; i < kSubMapCount; ++i) {
-    auto& m = var_maps[i];
-    // TODO(tesla): lock may be required here if reading a size_t
-    // variable is not a atomic operation.
-    n += m.map.size();
-  }
-  return n;
+  detail::ExposeDefaultVariables();
+  VarRegistry::ScopedPtr ptr;
+  if (GetVarRegistry().Read(ptr) != 0) {
+    return 0;
+  }
+  return ptr->size();
 }
 
 int Variable::describe_exposed(const std::string& name, std::ostream& os,
                                bool quote_string,
                                DisplayFilter display_filter) {
-  auto& m = GetVarMap(name);
-  std::lock_guard<std::mutex> lock(m.mutex);
-  auto it = m.map.find(name);
-  if (it == m.map.end()) {
+  detail::ExposeDefaultVariables();
+  VarRegistry::ScopedPtr ptr;
+  if (GetVarRegistry().Read(ptr) != 0) {
+    return -1;
+  }
+  auto it = ptr->find(name);
+  if (it == ptr->end()) {
     return -1;
   }
 
@@ -240,6 +225,21 @@ int Variable::describe_exposed(const std::string& name, std::ostream& os,
   return 0;
 }
 
+int Variable::describe_series_exposed(const std::string& name,
+                                      std::ostream& os,
+                                      const SeriesOptions& options) {
+  detail::ExposeDefaultVariables();
+  VarRegistry::ScopedPtr ptr;
+  if (GetVarRegistry().Read(ptr) != 0) {
+    return -1;
+  }
+  auto it = ptr->find(name);
+  if (it == ptr->end()) {
+    return -1;
+  }
+  return it->second.var->describe_series(os, options);
+}
+
 std::string Variable::describe_exposed(const std::string& name,
                                        bool quote_string,
                                        DisplayFilter display_filter) {
@@ -256,7 +256,7 @@ std::string Variable::get_description() const {
   return os.str();
 }
 
-void to_underscored_name(std::string& name, const tutil::StringView& src) {
+void to_underscored_name(std::string& name, const ::tutil::StringView& src) {
   name.reserve(name.size() + src.size() + 8 /*just guess*/);
   for (auto p = src.begin(); p != src.end(); ++p) {
     if (isalpha(*p)) {
@@ -284,19 +284,62 @@ DumpOptions::DumpOptions()
       question_mark('?'),
       display_filter(DISPLAY_ON_PLAIN_TEXT) {}
 
+// Send the values of `entry' to `dumper', `os' writes into `streambuf'.
+// Return number of dumped values, -1 if `dumper' failed.
+static int DumpEntry(const std::string& name, const VarEntry& entry,
+                     const DumpOptions& opt, Dumper& dumper,
+                     ::tutil::CharArrayStreamBuf* streambuf, std::ostream& os,
+                     std::ostringstream* dumpped_info) {
+  if (entry.has_labels) {
+    return entry.var->dump_labeled(dumper, name, opt.quote_string);
+  }
+  entry.var->describe(os, opt.quote_string);
+  if (dumpped_info) {
+    *dumpped_info << '\n' << name << ": " << streambuf->data();
+  }
+  Summary summary;
+  const bool ok = entry.var->get_summary(&summary)
+                      ? dumper.dump_summary(name, streambuf->data(), summary)
+                      : dumper.dump(name, streambuf->data());
+  streambuf->reset();
+  return ok ? 1 : -1;
+}
+
+// Send the values of the exposed variable `name' to `dumper' if it's not
+// filtered out by `opt.display_filter'.
+// Return number of dumped values, -1 if `dumper' failed.
+static int DumpExposedEntry(const std::string& name, const DumpOptions& opt,
+                            Dumper& dumper,
+                            ::tutil::CharArrayStreamBuf* streambuf,
+                            std::ostream& os,
+                            std::ostringstream* dumpped_info) {
+  VarRegistry::ScopedPtr ptr;
+  if (GetVarRegistry().Read(ptr) != 0) {
+    return -1;
+  }
+  auto entry = ptr->find(name);
+  if (entry == ptr->end() ||
+      !(entry->second.display_filter & opt.display_filter)) {
+    return 0;
+  }
+  return DumpEntry(name, entry->second, opt, dumper, streambuf, os,
+                   dumpped_info);
+}
+
 int Variable::dump_exposed(Dumper& dumper, const DumpOptions* options) {
+  detail::ExposeDefaultVariables();
   DumpOptions opt;
   if (options) {
     opt = *options;
   }
 
-  tutil::CharArrayStreamBuf streambuf;
+  ::tutil::CharArrayStreamBuf streambuf;
   std::ostream os(&streambuf);
   int count = 0;
-  tutil::WildcardMatcher black_matcher(opt.black_wildcards, opt.question_mark,
+  ::tutil::WildcardMatcher black_matcher(opt.black_wildcards, opt.question_mark,
                                        false);
 
-  tutil::WildcardMatcher white_matcher(opt.white_wildcards, opt.question_mark,
+  ::tutil::WildcardMatcher white_matcher(opt.white_wildcards, opt.question_mark,
                                        true);
 
   std::ostringstream dumpped_info;
@@ -307,46 +350,53 @@ int Variable::dump_exposed(Dumper& dumper, const DumpOptions* options) {
     for (auto it = white_matcher.exact_names().cbegin();
          it != white_matcher.exact_names().cend(); ++it) {
       auto& name = *it;
-      if (!black_matcher.Match(name)) {
-        if (tvar::Variable::describe_exposed(name, os, opt.quote_string,
-                                             opt.display_filter) != 0) {
-          continue;
-        }
-
-        if (log_dumpped) {
-          dumpped_info << '\n' << name << ": " << streambuf.data();
-        }
-
-        if (!dumper.dump(name, streambuf.data())) {
-          return -1;
-        }
-        streambuf.reset();
-        ++count;
+      if (black_matcher.Match(name)) {
+        continue;
+      }
+      const int n = DumpExposedEntry(name, opt, dumper, &streambuf, os,
+                                     log_dumpped ? &dumpped_info : nullptr);
+      if (n < 0) {
+        return -1;
       }
+      count += n;
     }
   } else {
-    // Have to iterate all variable.
-    std::vector<std::string> variable_names;
-    tvar::Variable::list_exposed(variable_names, opt.display_filter);
-
-    // Sort the names to make them more readable.
-    std::sort(variable_names.begin(), variable_names.end());
-    for (auto it = variable_names.begin(); it != variable_names.end(); ++it) {
-      const std::string& name = *it;
-      if (white_matcher.Match(name) && !black_matcher.Match(name)) {
-        if (tvar::Variable::describe_exposed(name, os, opt.quote_string,
-                                             opt.display_filter)) {
-          continue;
+    // Walk the snapshots in batches, going on from the first name not
+    // visited yet.
+    std::string next_name;
+    bool done = false;
+    while (!done) {
+      {
+        VarRegistry::ScopedPtr ptr;
+        if (GetVarRegistry().Read(ptr) != 0) {
+          return -1;
         }
-
-        if (log_dumpped) {
-          dumpped_info << '\n' << name << ": " << streambuf.data();
+        auto it = next_name.empty() ? ptr->begin()
+                                    : ptr->lower_bound(next_name);
+        for (size_t n = 0; it != ptr->end() && n < kDumpBatchSize;
+             ++it, ++n) {
+          const std::string& name = it->first;
+          if (!(it->second.display_filter & opt.display_filter) ||
+              !white_matcher.Match(name) || black_matcher.Match(name)) {
+            continue;
+          }
+          const int dumped =
+              DumpEntry(name, it->second, opt, dumper, &streambuf, os,
+                        log_dumpped ? &dumpped_info : nullptr);
+          if (dumped < 0) {
+            return -1;
+          }
+          count += dumped;
         }
-        if (!dumper.dump(name, streambuf.data())) {
-          return -1;
+        done = (it == ptr->end());
+        if (!done) {
+          next_name = it->first;
         }
-        streambuf.reset();
-        ++count;
+      }
+      if (!done) {
+        // A writer woken by releasing the snapshot would find it taken
+        // again right away since mutexes are not fair, let it run.
+        std::this_thread::yield();
       }
     }
   }
@@ -359,40 +409,106 @@ int Variable::dump_exposed(Dumper& dumper, const DumpOptions* options) {
 
 // ---------------------- export to files --------------------------
 
-class FileDumper : public Dumper {
- public:
-  FileDumper(const std::string& filename, tutil::StringView prefix)
-      : filename_(filename), fp_(nullptr, FileDumper::FileClose) {
-    // setting prefix
-    // remove trailing spaces.
-    const char* p = prefix.data() + prefix.size();
-    for (; p != prefix.data() && isspace(p[-1]); --p) {
+DEFINE_bool(tvar_dump, false,
+            "Create a background thread dumping all tvar periodically, all "
+            "tvar_dump_* flags are not effective when this flag is off");
+DEFINE_int32(tvar_dump_interval, 10, "Seconds between consecutive dump");
+DEFINE_string(tvar_dump_file, "monitor/tvar.<app>.data",
+              "Dump tvar into this file, <app> is replaced with the name of "
+              "the program");
+DEFINE_string(tvar_dump_include, "",
+              "Dump tvar matching these wildcards, separated by semicolon(;), "
+              "empty means including all");
+DEFINE_string(tvar_dump_exclude, "",
+              "Dump tvar excluded from these wildcards, separated by "
+              "semicolon(;), empty means no exclusion");
+DEFINE_string(tvar_dump_prefix, "<app>",
+              "Every dumped name starts with this prefix, <app> is replaced "
+              "with the name of the program");
+DEFINE_int32(tvar_dump_max_ms, 1000,
+             "Stop describing tvar after so many milliseconds in a round, "
+             "the rest are written with their last values and the next "
+             "round goes on from where it stopped. 0 means no limit");
+
+// Normalize `prefix' like the names of variables, ending with '_'.
+static std::string NormalizePrefix(::tutil::StringView prefix) {
+  // remove trailing spaces.
+  const char* p = prefix.data() + prefix.size();
+  for (; p != prefix.data() && isspace(p[-1]); --p) {
+  }
+  prefix.remove_suffix(prefix.data() + prefix.size() - p);
+  std::string normalized;
+  if (!prefix.empty()) {
+    to_underscored_name(normalized, prefix);
+    if (normalized.back() != '_') {
+      normalized.push_back('_');
     }
-    prefix.remove_suffix(prefix.data() + prefix.size() - p);
-    // normalize it.
-    if (!prefix.empty()) {
-      to_underscored_name(prefix_, prefix);
-      if (prefix_.back() != '_') {
-        prefix_.push_back('_');
-      }
+  }
+  return normalized;
+}
+
+// Format values as "<prefix><name> : <description>" lines into a string.
+class LineDumper : public Dumper {
+ public:
+  LineDumper(const std::string& prefix, std::string* out)
+      : prefix_(prefix), out_(out) {}
+
+  bool dump(const std::string& name,
+            const ::tutil::StringView& description) override {
+    out_->append(prefix_);
+    out_->append(name);
+    out_->append(" : ");
+    out_->append(description.data(), description.size());
+    out_->append("\r\n");
+    return true;
+  }
+
+ private:
+  const std::string& prefix_;
+  std::string* out_;
+};
+
+// The file being written, renamed to `filename' by Commit() so that
+// readers never see a partial file.
+class DumpFile {
+ public:
+  explicit DumpFile(const std::string& filename)
+      : filename_(filename), fp_(nullptr, DumpFile::FileClose) {
+    tmp_filename_ = filename_ + ".tmp";
+  }
+
+  ~DumpFile() {
+    if (fp_ != nullptr) {
+      fp_.reset();
+      unlink(tmp_filename_.c_str());
     }
   }
 
-  ~FileDumper() {}
+  bool Write(const std::string& text) {
+    if (fp_ == nullptr && !Open()) {
+      return false;
+    }
+    if (fwrite(text.data(), 1, text.size(), fp_.get()) != text.size()) {
+      LOG_ERROR << "Fail to write into " << tmp_filename_;
+      return false;
+    }
+    return true;
+  }
 
-  bool dump(const std::string& name, const tutil::StringView& description) {
-    if (fp_ == nullptr) {
-      // TODO(tesla): call mkdir first?
-      fp_.reset(fopen(filename_.c_str(), "w"));
-      if (fp_ == nullptr) {
-        LOG_ERROR << "Fail to open " << filename_;
-        return false;
-      }
+  // Replace `filename' with what were written, an empty file if nothing.
+  bool Commit() {
+    if (fp_ == nullptr && !Open()) {
+      return false;
     }
-    if (fprintf(fp_.get(), "%.*s%.*s : %.*s\r\n", (int)prefix_.size(),
-                prefix_.data(), (int)name.size(), name.data(),
-                (int)description.size(), description.data()) < 0) {
-      LOG_ERROR << "Fail to write into " << filename_;
+    if (fclose(fp_.release()) != 0) {
+      LOG_SYSERR << "Fail to close " << tmp_filename_;
+      unlink(tmp_filename_.c_str());
+      return false;
+    }
+    if (rename(tmp_filename_.c_str(), filename_.c_str()) != 0) {
+      LOG_SYSERR << "Fail to rename " << tmp_filename_ << " to "
+                 << filename_;
+      unlink(tmp_filename_.c_str());
       return false;
     }
     return true;
@@ -405,15 +521,228 @@ class FileDumper : public Dumper {
     }
   }
 
+  bool Open() {
+    // Create the parent directories, like `mkdir -p'.
+    for (size_t pos = filename_.find('/', 1); pos != std::string::npos;
+         pos = filename_.find('/', pos + 1)) {
+      const std::string dir(filename_, 0, pos);
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_SYSERR << "Fail to create directory " << dir;
+        return false;
+      }
+    }
+    fp_.reset(fopen(tmp_filename_.c_str(), "w"));
+    if (fp_ == nullptr) {
+      LOG_SYSERR << "Fail to open " << tmp_filename_;
+      return false;
+    }
+    return true;
+  }
+
   std::string filename_;
-  std::string prefix_;
-  std::unique_ptr<FILE, decltype(FileDumper::FileClose)*> fp_;
+  std::string tmp_filename_;
+  std::unique_ptr<FILE, decltype(DumpFile::FileClose)*> fp_;
 };
 
-class FileDumperGroup : public Dumper {
+// Name of the program. gflags knows it once the command line is parsed,
+// otherwise it's read from /proc where there is one.
+static std::string GetProgramName() {
+  std::string name(google::ProgramInvocationShortName());
+  if (name != "UNKNOWN") {
+    return name;
+  }
+  FILE* fp = fopen("/proc/self/cmdline", "r");
+  if (fp != nullptr) {
+    // argv[0] ends with '\0'.
+    char buf[256];
+    const size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    const char* slash = strrchr(buf, '/');
+    if (buf[0] != '\0') {
+      name = (slash ? slash + 1 : buf);
+    }
+  }
+  return name;
+}
+
+// Replace all "<app>" in `str' with the name of the program.
+static std::string ReplaceAppName(std::string str) {
+  const std::string app(GetProgramName());
+  for (size_t pos = str.find("<app>"); pos != std::string::npos;
+       pos = str.find("<app>", pos + app.size())) {
+    str.replace(pos, 5, app);
+  }
+  return str;
+}
+
+static std::string GetStringFlag(const char* name) {
+  // Flags of string may be modified at the same time, copy them safely.
+  std::string value;
+  if (!google::GetCommandLineOption(name, &value)) {
+    LOG_ERROR << "Fail to get flag " << name;
+  }
+  return value;
+}
+
+// Dump the variables once per tvar_dump_interval seconds.
+//   - Every round replaces the file (a temporary file renamed) with all
+//     the variables in the order of names.
+//   - Lines of each variable are cached. A round describes variables for
+//     at most tvar_dump_max_ms, starting from the one where the last
+//     round stopped and wrapping around, so a few slow variables never
+//     block the thread for long. Variables not reached are written with
+//     their cached lines, which are also kept when values did not change.
+//   - Values of MultiDimension are written one line per labels.
+class DumpingThread {
  public:
+  DumpingThread() : round_(0) {}
+
+  void Run();
+
  private:
+  struct CachedLines {
+    std::string text;
+    uint64_t round{0};  // the last round writing the variable
+  };
+
+  // Returns number of written variables, -1 on error.
+  int RunRound();
+
+  uint64_t round_;
+  // The name to start describing with in the next round.
+  std::string resume_name_;
+  // Prefix of the cached lines.
+  std::string prefix_;
+  std::unordered_map<std::string, CachedLines> cache_;
 };
 
+void DumpingThread::Run() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point next_round = Clock::now();
+  while (true) {
+    if (!FLAGS_tvar_dump) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      next_round = Clock::now();
+      continue;
+    }
+    std::this_thread::sleep_until(next_round);
+    RunRound();
+    const int interval = std::max(FLAGS_tvar_dump_interval, 1);
+    next_round += std::chrono::seconds(interval);
+    const Clock::time_point now = Clock::now();
+    if (next_round <= now) {
+      next_round = now + std::chrono::seconds(interval);
+    }
+  }
+}
+
+int DumpingThread::RunRound() {
+  using Clock = std::chrono::steady_clock;
+  const int max_ms = FLAGS_tvar_dump_max_ms;
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::milliseconds(max_ms);
+  ++round_;
+
+  ::tutil::WildcardMatcher white_matcher(GetStringFlag("tvar_dump_include"),
+                                       '?', true);
+  ::tutil::WildcardMatcher black_matcher(GetStringFlag("tvar_dump_exclude"),
+                                       '?', false);
+  const std::string prefix = ReplaceAppName(GetStringFlag("tvar_dump_prefix"));
+  const std::string normalized_prefix =
+      NormalizePrefix(::tutil::StringView(prefix.data(), prefix.size()));
+  if (normalized_prefix != prefix_) {
+    cache_.clear();
+    prefix_ = normalized_prefix;
+  }
+
+  std::vector<std::string> names;
+  // Already in the order of names.
+  Variable::list_exposed(names, DISPLAY_ON_PLAIN_TEXT);
+  names.erase(std::remove_if(names.begin(), names.end(),
+                             [&](const std::string& name) {
+                               return !white_matcher.Match(name) ||
+                                      black_matcher.Match(name);
+                             }),
+              names.end());
+
+  // Describe from where the last round stopped, wrapping around.
+  DumpOptions opt;
+  opt.display_filter = DISPLAY_ON_PLAIN_TEXT;
+  ::tutil::CharArrayStreamBuf streambuf;
+  std::ostream os(&streambuf);
+  std::string text;
+  LineDumper line_dumper(prefix_, &text);
+  const size_t start = std::lower_bound(names.begin(), names.end(),
+                                        resume_name_) - names.begin();
+  resume_name_.clear();
+  for (size_t i = 0; i < names.size(); ++i) {
+    const std::string& name = names[(start + i) % names.size()];
+    // Describe one variable at least to make progress.
+    if (max_ms > 0 && i > 0 && Clock::now() >= deadline) {
+      resume_name_ = name;
+      break;
+    }
+    text.clear();
+    if (DumpExposedEntry(name, opt, line_dumper, &streambuf, os,
+                         nullptr) <= 0) {
+      // Hidden after being listed.
+      cache_.erase(name);
+      continue;
+    }
+    CachedLines& cached = cache_[name];
+    if (cached.text != text) {
+      cached.text.swap(text);
+    }
+  }
+
+  // Write all variables from the cache.
+  DumpFile file(ReplaceAppName(GetStringFlag("tvar_dump_file")));
+  int count = 0;
+  for (const std::string& name : names) {
+    auto it = cache_.find(name);
+    if (it == cache_.end()) {
+      continue;
+    }
+    it->second.round = round_;
+    if (!file.Write(it->second.text)) {
+      return -1;
+    }
+    ++count;
+  }
+  if (!file.Commit()) {
+    return -1;
+  }
+
+  // Forget the variables not written, they are hidden or filtered out.
+  if (cache_.size() > static_cast<size_t>(count)) {
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.round != round_) {
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  return count;
+}
+
+static void LaunchDumpingThread() {
+  std::thread([] {
+    DumpingThread dumping_thread;
+    dumping_thread.Run();
+  }).detach();
+}
+
+static std::once_flag kDumpingThreadOnce;
+
+static bool validate_tvar_dump(const char*, bool enabled) {
+  if (enabled) {
+    std::call_once(kDumpingThreadOnce, LaunchDumpingThread);
+  }
+  return true;
+}
+DEFINE_validator(tvar_dump, &validate_tvar_dump);
+
 }  // namespace tvar
 }  // namespace tesla
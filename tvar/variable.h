@@ -18,6 +18,7 @@
 #ifndef TESLA_TVAR_VARIABLE_H_
 #define TESLA_TVAR_VARIABLE_H_
 
+#include <stdint.h>            // int64_t
 #include <ostream>             // std::ostream
 #include <vector>              // std::vector
 #include "tutil/macros.h"      // DISALLOW_COPY_AND_ASSIGN 
@@ -33,6 +34,22 @@ enum DisplayFilter {
   DISPLAY_ON_ALL = 3,
 };
 
+// A distribution given by a variable as a whole, see
+// Variable::get_summary().
+struct Summary {
+  constexpr static int kMaxQuantiles = 8;
+
+  // The first `quantile_count' quantiles, e.g. {0.99, 200} means 99% of
+  // the values are not greater than 200.
+  double ratios[kMaxQuantiles];
+  int64_t values[kMaxQuantiles];
+  int quantile_count{0};
+  // Sum and number of all values recorded since the start, which never
+  // decrease.
+  int64_t sum{0};
+  int64_t count{0};
+};
+
 // Implement this class to write variables into different places.
 // If dump() return false, Variable::dump_exposed() stops and return -1.
 class Dumper {
@@ -40,7 +57,15 @@ class Dumper {
   Dumper() = default;
   virtual ~Dumper() = default;
   virtual bool dump(const std::string& name,
-                    const tutil::StringView& description) = 0;
+                    const ::tutil::StringView& description) = 0;
+
+  // Called instead of dump() for variables having a summary. By default
+  // the summary is ignored and the variable is dumped like the others.
+  virtual bool dump_summary(const std::string& name,
+                            const ::tutil::StringView& description,
+                            const Summary& summary) {
+    return dump(name, description);
+  }
 };
 
 // Options for Variable::dump_exposed().
@@ -65,6 +90,14 @@ struct DumpOptions {
   std::string black_wildcards;
 };
 
+// Options for Variable::describe_series().
+struct SeriesOptions {
+  SeriesOptions() : test_only(false) {}
+
+  // Only test whether the variable has a series, write nothing.
+  bool test_only;
+};
+
 // Base class of all tvar.
 // tvar is NOT thread-safe:
 //   You should not operate one tvar from different threads simultaneously.
@@ -86,6 +119,30 @@ class Variable {
   // string form of describe().
   std::string get_description() const;
 
+  // Describe the values of the variable in last 60 seconds, 60 minutes,
+  // 24 hours and 30 days (sampled once per second) as a json object.
+  // Return 0 on success, 1 if the variable does not save series.
+  virtual int describe_series(std::ostream&, const SeriesOptions&) const {
+    return 1;
+  }
+
+  // Return true if the variable has several values told apart by labels,
+  // which are dumped by dump_labeled() instead of describe().
+  virtual bool has_labels() const { return false; }
+
+  // Send every value to `dumper' with the labels appended to `name', e.g.
+  // `rpc_count{method="Get"}'. Implemented by variables having labels.
+  // Return number of dumped values, -1 if `dumper' failed.
+  virtual int dump_labeled(Dumper& dumper, const std::string& name,
+                           bool quote_string) const {
+    return 0;
+  }
+
+  // Return true and fill `summary' if the variable stands for a whole
+  // distribution, e.g. the latency of LatencyRecorder. It is dumped by
+  // Dumper::dump_summary() then.
+  virtual bool get_summary(Summary* summary) const { return false; }
+
   // Expose this variable globally so that it's counted in follwing
   // functions:
   //   list_exposed
@@ -93,14 +150,14 @@ class Variable {
   //   describe_exposed
   //   find_exposed
   // Return 0 on success, -1 otherwise.
-  int expose(const tutil::StringView& name,
+  int expose(const ::tutil::StringView& name,
              DisplayFilter display_filter = DISPLAY_ON_ALL) {
-    return expose_impl(tutil::StringView(), name, display_filter);
+    return expose_impl(::tutil::StringView(), name, display_filter);
   }
 
   // Expose this variable globally with a prefix.
-  int expose_as(const tutil::StringView& prefix,
-                const tutil::StringView& name,
+  int expose_as(const ::tutil::StringView& prefix,
+                const ::tutil::StringView& name,
                 DisplayFilter display_filter = DISPLAY_ON_ALL) {
     return expose_impl(prefix, name, display_filter);
   }
@@ -117,7 +174,7 @@ class Variable {
 
   // ==================================================================
   
-  // Get names of all exposed variables into `names'.
+  // Get names of all exposed variables into `names' in the order of names.
   // If you want to print all variables, you have to go through `names'
   // and call `describe_exposed' on each name. This prevents an iteration
   // from taking the lock too long.
@@ -139,15 +196,23 @@ class Variable {
                                       bool quote_string = false,
                                       DisplayFilter = DISPLAY_ON_ALL);
 
+  // Find an exposed variable by `name' and put its series into `os'.
+  // Return 0 on success, 1 if it has no series, -1 if not found.
+  static int describe_series_exposed(const std::string& name,
+                                     std::ostream& os,
+                                     const SeriesOptions& options);
+
   // Find all exposed variables matching `white_wildcards' but `black_wildcards'
-  // and send them to `dumper'.
+  // and send them to `dumper' in the order of names.
+  // Variables may be exposed or hidden by other threads meanwhile, but NOT
+  // by `dumper' or describe() of the variables, which would deadlock.
   // Use default options when `options' is empty.
   // Return number of dumped variables, -1 on error.
   static int dump_exposed(Dumper& dumper, const DumpOptions* options);
 
  protected:
-  virtual int expose_impl(const tutil::StringView& prefix,
-                          const tutil::StringView& name,
+  virtual int expose_impl(const ::tutil::StringView& prefix,
+                          const ::tutil::StringView& name,
                           DisplayFilter display_filter);
  private:
   std::string name_;
@@ -162,7 +227,7 @@ class Variable {
 //   FooBar          -> foo_bar
 //   RPCTest         -> rpctest
 //   HELLO           -> hello
-void to_underscored_name(std::string& out, const tutil::StringView& name);
+void to_underscored_name(std::string& out, const ::tutil::StringView& name);
 
 } // namespace tvar
 } // namespace tesla
@@ -0,0 +1,232 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Oct 19 17:20:05 CST 2019
+
+#ifndef TESLA_TVAR_WINDOW_H_
+#define TESLA_TVAR_WINDOW_H_
+
+#include <string>
+#include <type_traits>
+
+#include "tvar/variable.h"
+#include "tvar/detail/sampler.h"
+#include "tvar/detail/series.h"
+#include "tvar/detail/describe_value.h"
+
+#include <gflags/gflags.h>
+
+namespace tesla {
+namespace tvar {
+
+DECLARE_bool(tvar_save_series);
+
+// Window size used when none is given, in seconds.
+constexpr time_t kDefaultWindowSize = 10;
+
+namespace detail {
+
+// What the per-second series of a window records.
+enum SeriesFrequency {
+  SERIES_IN_WINDOW = 0,  // the value of the window
+  SERIES_IN_SECOND = 1,  // the value of the last second
+};
+
+template <typename R, SeriesFrequency series_freq>
+class WindowBase : public Variable {
+ public:
+  using value_type   = typename R::value_type;
+  using sampler_type = typename R::sampler_type;
+  using op_type      = typename R::op_type;
+
+  class SeriesSampler : public Sampler {
+   public:
+    SeriesSampler(WindowBase* owner, R* var)
+        : owner_(owner), series_(var->op()) {}
+
+    void TakeSample() override {
+      if (series_freq == SERIES_IN_SECOND) {
+        series_.Append(owner_->GetValue(1));
+      } else {
+        series_.Append(owner_->GetValue());
+      }
+    }
+
+    void Describe(std::ostream& os) { series_.Describe(os, nullptr); }
+
+   private:
+    WindowBase* owner_;
+    Series<value_type, op_type> series_;
+  };
+
+  WindowBase(R* var, time_t window_size)
+      : var_(var),
+        window_size_(window_size > 0 ? window_size : kDefaultWindowSize),
+        sampler_(var->get_sampler()),
+        series_sampler_(nullptr) {
+    sampler_->SetWindowSize(window_size_);
+  }
+
+  ~WindowBase() {
+    hide();
+    if (series_sampler_) {
+      series_sampler_->Destroy();
+      series_sampler_ = nullptr;
+    }
+  }
+
+  // Get the reduced value of the last `window_size' seconds and the time
+  // it really covers, which may be shorter just after the start.
+  // Returns false if the sampler has not collected two samples yet.
+  bool GetSpan(time_t window_size, value_type* value,
+               tutil::Duration* span) const {
+    return sampler_->GetValue(window_size, value, span);
+  }
+
+  bool GetSpan(value_type* value, tutil::Duration* span) const {
+    return GetSpan(window_size_, value, span);
+  }
+
+  virtual value_type GetValue(time_t window_size) const {
+    value_type value = value_type();
+    tutil::Duration span;
+    GetSpan(window_size, &value, &span);
+    return value;
+  }
+
+  value_type GetValue() const { return GetValue(window_size_); }
+
+  void describe(std::ostream& os, bool quote_string) const override {
+    if (std::is_same<value_type, std::string>::value && quote_string) {
+      os << '"' << GetValue() << '"';
+    } else {
+      DescribeValue(os, GetValue());
+    }
+  }
+
+  int describe_series(std::ostream& os,
+                      const SeriesOptions& options) const override {
+    if (series_sampler_ == nullptr) {
+      return 1;
+    }
+    if (!options.test_only) {
+      series_sampler_->Describe(os);
+    }
+    return 0;
+  }
+
+  time_t window_size() const { return window_size_; }
+
+ protected:
+  int expose_impl(const ::tutil::StringView& prefix,
+                  const ::tutil::StringView& name,
+                  DisplayFilter display_filter) override {
+    const int rc = Variable::expose_impl(prefix, name, display_filter);
+    if constexpr (!std::is_same<value_type, std::string>::value) {
+      if (rc == 0 && series_sampler_ == nullptr && FLAGS_tvar_save_series) {
+        series_sampler_ = new SeriesSampler(this, var_);
+        series_sampler_->Schedule();
+      }
+    }
+    return rc;
+  }
+
+ private:
+  R* var_;
+  time_t window_size_;
+  sampler_type* sampler_;
+  SeriesSampler* series_sampler_;
+};
+
+} // namespace detail
+
+// Get the reduced value of a reducer in the last `window_size' seconds.
+// Example:
+//   tvar::Adder<int> errors;
+//   tvar::Window<tvar::Adder<int>> errors_in_minute("errors_minute",
+//                                                  &errors, 60);
+//   errors << 1;
+//   ...
+//   errors_in_minute.GetValue();  // errors of the last 60 seconds
+//
+// Reducers with an inverse operator (Adder) keep one accumulated value per
+// second, others (Maxer, Miner) are reset every second by the sampler, so
+// they should not be read directly while a window is attached.
+template <typename R>
+class Window : public detail::WindowBase<R, detail::SERIES_IN_WINDOW> {
+  using Base = detail::WindowBase<R, detail::SERIES_IN_WINDOW>;
+
+ public:
+  // `var' must outlive the window.
+  explicit Window(R* var, time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {}
+
+  Window(const ::tutil::StringView& name, R* var,
+         time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {
+    this->expose(name);
+  }
+
+  Window(const ::tutil::StringView& prefix, const ::tutil::StringView& name,
+         R* var, time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {
+    this->expose_as(prefix, name);
+  }
+};
+
+// Get the average per-second value of a reducer in the last
+// `window_size' seconds, e.g. QPS from an Adder of requests.
+//   tvar::Adder<int> requests;
+//   tvar::PerSecond<tvar::Adder<int>> qps("qps", &requests);
+template <typename R>
+class PerSecond : public detail::WindowBase<R, detail::SERIES_IN_SECOND> {
+  using Base = detail::WindowBase<R, detail::SERIES_IN_SECOND>;
+
+ public:
+  using value_type = typename Base::value_type;
+
+  // `var' must outlive the window.
+  explicit PerSecond(R* var, time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {}
+
+  PerSecond(const ::tutil::StringView& name, R* var,
+            time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {
+    this->expose(name);
+  }
+
+  PerSecond(const ::tutil::StringView& prefix, const ::tutil::StringView& name,
+            R* var, time_t window_size = kDefaultWindowSize)
+      : Base(var, window_size) {
+    this->expose_as(prefix, name);
+  }
+
+  value_type GetValue(time_t window_size) const override {
+    value_type value = value_type();
+    tutil::Duration span;
+    if (!this->GetSpan(window_size, &value, &span) || span.IsZero()) {
+      return value_type();
+    }
+    // Scale by the real span, samples are not exactly 1s apart.
+    return static_cast<value_type>(value / span.Seconds());
+  }
+
+  using Base::GetValue;
+};
+
+} // namespace tvar
+} // namespace tesla
+
+#endif // TESLA_TVAR_WINDOW_H_
@@ -0,0 +1,301 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Mon Oct 28 21:47:12 CST 2019
+
+#ifndef TESLA_WAIT_FREE_EPOCH_H_
+#define TESLA_WAIT_FREE_EPOCH_H_
+
+#include <atomic>
+
+#include "log/logging.h"
+#include "wait_free/common.h"
+#include "wait_free/hazard_version.h"
+#include "wait_free/util.h"
+
+namespace tesla {
+namespace wait_free {
+namespace epoch {
+
+// Nodes are the same as the ones of HazardVersion: Retire() is called
+// right before the node is deleted.
+using hazard_version::HazardNode;
+
+// Epoch based reclamation. Entering and leaving a critical region is one
+// store into the record of the current thread, nothing is published per
+// pointer, which makes it the cheapest for readers:
+//   if (0 != domain.Enter()) {
+//     return -1;  // out of thread records, see note 1
+//   }
+//   Node* node = head_.load(std::memory_order_acquire);
+//   ... use node ...
+//   domain.Exit();
+// A node added by AddNode() in epoch E is deleted once the global epoch
+// reaches E + 2. The epoch advances only when every thread inside a
+// critical region has seen the current one, so a thread staying inside
+// stops all reclamation.
+//
+// Threads serving requests in a loop may stay inside and call Quiesce()
+// between requests instead, which ends the region and starts a new one in
+// the same store:
+//   domain.Enter();
+//   while (running) {
+//     HandleRequest();   // reads the structure without Enter()/Exit()
+//     domain.Quiesce();  // references of the request are dropped
+//   }
+//   domain.Exit();
+// They have to Exit() before blocking for long, e.g. in epoll_wait().
+//
+// Note:
+//   1. Threads are identified by GetCurrentThreadId() like HazardVersion,
+//      which must be less than `MaxThreadCount'. Ids of exited threads
+//      are reused, so Enter() and Quiesce() fail only if more than
+//      `MaxThreadCount' threads are alive at once.
+//   2. Critical regions do not nest.
+//   3. Nodes added by a thread are kept in lists of that thread, those of
+//      a thread which exited are reclaimed by the destructor.
+template <uint16_t MaxThreadCount>
+class EpochDomainT {
+ public:
+  EpochDomainT(const int64_t thread_advance_threshold = 64);
+  ~EpochDomainT();
+ public:
+  // Return 0 on success, -1 if the thread is out of records.
+  int Enter();
+  void Exit();
+  // Return 0 on success, -1 if the thread is out of records.
+  int Quiesce();
+
+  // Reclaim `node', which is no longer reachable for new readers, once the
+  // threads which may still see it have left their critical regions.
+  int AddNode(HazardNode* node);
+
+  // Try to advance the epoch and reclaim the nodes added by the current
+  // thread which became safe.
+  void Retire();
+
+  uint64_t current_epoch() const;
+  int64_t hazard_waiting_count() const;
+ private:
+  // Nodes of the last three epochs, by epoch % 3.
+  constexpr static int kLimboCount = 3;
+
+  struct HAZARD_CACHELINE_ALIGNMENT ThreadRecord {
+    // (epoch << 1) | 1 inside a critical region, 0 outside.
+    std::atomic<uint64_t> state{0};
+    // Used by the owner only.
+    bool enabled{false};
+    int64_t added_since_advance{0};
+    HazardNode* limbo[kLimboCount] = {nullptr, nullptr, nullptr};
+    uint64_t limbo_epoch[kLimboCount] = {0, 0, 0};
+  };
+
+  int GetThreadRecord(ThreadRecord*& record);
+  // Advance the global epoch if all threads inside have seen it.
+  bool TryAdvance(const uint64_t epoch);
+  // Delete nodes of `record' added two epochs or more before `epoch'.
+  void Reclaim(ThreadRecord* record, const uint64_t epoch);
+  int64_t DeleteList(HazardNode* list);
+ private:
+  int64_t thread_advance_threshold_;
+
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<uint64_t> global_epoch_;
+
+  ThreadRecord threads_[MaxThreadCount];
+  // Records of [0, thread_count_) may have been used.
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<int> thread_count_;
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<int64_t> hazard_waiting_count_;
+};
+
+constexpr static uint16_t kMaxThreadCount = 1024;
+using EpochDomain = EpochDomainT<kMaxThreadCount>;
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <uint16_t MaxThreadCount>
+EpochDomainT<MaxThreadCount>::EpochDomainT(
+    const int64_t thread_advance_threshold)
+    : thread_advance_threshold_(thread_advance_threshold),
+      global_epoch_(0),
+      thread_count_(0),
+      hazard_waiting_count_(0) {
+}
+
+template <uint16_t MaxThreadCount>
+EpochDomainT<MaxThreadCount>::~EpochDomainT() {
+  // No reader is left, reclaim everything.
+  const int thread_count = thread_count_.load();
+  for (int i = 0; i < thread_count; ++i) {
+    for (int j = 0; j < kLimboCount; ++j) {
+      DeleteList(threads_[i].limbo[j]);
+      threads_[i].limbo[j] = nullptr;
+    }
+  }
+}
+
+template <uint16_t MaxThreadCount>
+int EpochDomainT<MaxThreadCount>::Enter() {
+  int ret = 0;
+  ThreadRecord* record = nullptr;
+  if (0 != (ret = GetThreadRecord(record))) {
+    LOG_ERROR << "GetThreadRecord fail, ret=" << ret;
+  } else {
+    // seq_cst orders the store before the loads of the region, which pairs
+    // with the fence in TryAdvance().
+    record->state.store(
+        (global_epoch_.load(std::memory_order_acquire) << 1) | 1,
+        std::memory_order_seq_cst);
+  }
+  return ret;
+}
+
+template <uint16_t MaxThreadCount>
+void EpochDomainT<MaxThreadCount>::Exit() {
+  ThreadRecord* record = nullptr;
+  if (0 == GetThreadRecord(record)) {
+    record->state.store(0, std::memory_order_release);
+  }
+}
+
+template <uint16_t MaxThreadCount>
+int EpochDomainT<MaxThreadCount>::Quiesce() {
+  int ret = 0;
+  ThreadRecord* record = nullptr;
+  if (0 != (ret = GetThreadRecord(record))) {
+    LOG_ERROR << "GetThreadRecord fail, ret=" << ret;
+  } else {
+    const uint64_t epoch = global_epoch_.load(std::memory_order_acquire);
+    record->state.store((epoch << 1) | 1, std::memory_order_seq_cst);
+    Reclaim(record, epoch);
+  }
+  return ret;
+}
+
+template <uint16_t MaxThreadCount>
+int EpochDomainT<MaxThreadCount>::AddNode(HazardNode* node) {
+  int ret = 0;
+  ThreadRecord* record = nullptr;
+  if (nullptr == node) {
+    LOG_ERROR << "invalid parameter, node nullptr";
+    ret = -1;
+  } else if (0 != (ret = GetThreadRecord(record))) {
+    LOG_ERROR << "GetThreadRecord fail, ret=" << ret;
+  } else {
+    uint64_t epoch = global_epoch_.load(std::memory_order_acquire);
+    // The list of epoch - 3 shares the index, empty it first.
+    Reclaim(record, epoch);
+    const int index = epoch % kLimboCount;
+    node->set_next(record->limbo[index]);
+    record->limbo[index] = node;
+    record->limbo_epoch[index] = epoch;
+    hazard_waiting_count_.fetch_add(1);
+    if (thread_advance_threshold_ <= ++record->added_since_advance) {
+      record->added_since_advance = 0;
+      if (TryAdvance(epoch)) {
+        Reclaim(record, epoch + 1);
+      }
+    }
+  }
+  return ret;
+}
+
+template <uint16_t MaxThreadCount>
+void EpochDomainT<MaxThreadCount>::Retire() {
+  ThreadRecord* record = nullptr;
+  if (0 != GetThreadRecord(record)) {
+    LOG_ERROR << "GetThreadRecord fail";
+    return;
+  }
+  // Nodes of the current epoch need two advances.
+  for (int i = 0; i < 2; ++i) {
+    TryAdvance(global_epoch_.load(std::memory_order_acquire));
+  }
+  Reclaim(record, global_epoch_.load(std::memory_order_acquire));
+}
+
+template <uint16_t MaxThreadCount>
+uint64_t EpochDomainT<MaxThreadCount>::current_epoch() const {
+  return global_epoch_.load();
+}
+
+template <uint16_t MaxThreadCount>
+int64_t EpochDomainT<MaxThreadCount>::hazard_waiting_count() const {
+  return hazard_waiting_count_.load();
+}
+
+template <uint16_t MaxThreadCount>
+int EpochDomainT<MaxThreadCount>::GetThreadRecord(ThreadRecord*& record) {
+  const int64_t thread_id = GetCurrentThreadId();
+  if (MaxThreadCount <= thread_id) {
+    LOG_ERROR << "thread number overflow, thread_id=" << thread_id;
+    return -1;
+  }
+  record = &threads_[thread_id];
+  if (!record->enabled) {
+    record->enabled = true;
+    int count = thread_count_.load();
+    while (count <= thread_id &&
+           !thread_count_.compare_exchange_weak(count, thread_id + 1));
+  }
+  return 0;
+}
+
+template <uint16_t MaxThreadCount>
+bool EpochDomainT<MaxThreadCount>::TryAdvance(const uint64_t epoch) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const uint64_t current = (epoch << 1) | 1;
+  const int thread_count = thread_count_.load();
+  for (int i = 0; i < thread_count; ++i) {
+    const uint64_t state = threads_[i].state.load(std::memory_order_acquire);
+    if (0 != state && current != state) {
+      return false;
+    }
+  }
+  uint64_t expected = epoch;
+  // Fails only if another thread advanced it meanwhile, which is as good.
+  global_epoch_.compare_exchange_strong(expected, epoch + 1);
+  return true;
+}
+
+template <uint16_t MaxThreadCount>
+void EpochDomainT<MaxThreadCount>::Reclaim(ThreadRecord* record,
+                                           const uint64_t epoch) {
+  for (int i = 0; i < kLimboCount; ++i) {
+    if (nullptr != record->limbo[i] && record->limbo_epoch[i] + 2 <= epoch) {
+      HazardNode* list = record->limbo[i];
+      record->limbo[i] = nullptr;
+      hazard_waiting_count_.fetch_add(-DeleteList(list));
+    }
+  }
+}
+
+template <uint16_t MaxThreadCount>
+int64_t EpochDomainT<MaxThreadCount>::DeleteList(HazardNode* list) {
+  int64_t count = 0;
+  while (nullptr != list) {
+    HazardNode* current = list;
+    list = list->next();
+    current->Retire();
+    delete current;
+    ++count;
+  }
+  return count;
+}
+
+}  // epoch
+}  // wait_free
+}  // tesla
+
+#endif  // TESLA_WAIT_FREE_EPOCH_H_
@@ -0,0 +1,195 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Nov  3 10:42:37 CST 2019
+
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "wait_free/epoch.h"
+
+using namespace tesla::wait_free;
+
+#define CHECK_OR_FAIL(cond)                                                 \
+  if (!(cond)) {                                                            \
+    fprintf(stderr, "error %s:%d! %s\n", __FILE__, __LINE__, #cond);        \
+    return -1;                                                              \
+  }
+
+// Large enough that AddNode() never advances the epoch by itself.
+constexpr static int64_t kAdvanceThreshold = 1 << 20;
+
+class FlagNode : public epoch::HazardNode {
+ public:
+  explicit FlagNode(std::atomic<bool>* retired) : retired_(retired) {}
+
+  void Retire() override { retired_->store(true); }
+
+ private:
+  std::atomic<bool>* retired_;
+};
+
+enum Command {
+  kNone = 0,
+  kEnter,
+  kQuiesce,
+  kExit,
+  kQuit,
+};
+
+// A thread calling the domain on commands of the test, Run() returns once
+// the command is done.
+template <typename Domain>
+class Reader {
+ public:
+  explicit Reader(Domain* domain)
+      : domain_(domain), command_(kNone), ret_(0),
+        thread_([this] { Loop(); }) {}
+
+  ~Reader() {
+    Run(kQuit);
+    thread_.join();
+  }
+
+  int Run(const Command command) {
+    command_.store(command);
+    while (kNone != command_.load()) {
+      std::this_thread::yield();
+    }
+    return ret_.load();
+  }
+
+ private:
+  void Loop() {
+    while (true) {
+      const int command = command_.load();
+      if (kNone == command) {
+        std::this_thread::yield();
+        continue;
+      }
+      int ret = 0;
+      if (kEnter == command) {
+        ret = domain_->Enter();
+      } else if (kQuiesce == command) {
+        ret = domain_->Quiesce();
+      } else if (kExit == command) {
+        domain_->Exit();
+      }
+      ret_.store(ret);
+      command_.store(kNone);
+      if (kQuit == command) {
+        break;
+      }
+    }
+  }
+
+  Domain* domain_;
+  std::atomic<int> command_;
+  std::atomic<int> ret_;
+  std::thread thread_;
+};
+
+// Records are indexed by thread ids, which are dense among live threads, so
+// a domain of two records serves the main thread and one reader only.
+int run_out_of_records_test() {
+  using SmallDomain = epoch::EpochDomainT<2>;
+  std::unique_ptr<SmallDomain> domain(new SmallDomain(kAdvanceThreshold));
+  CHECK_OR_FAIL(0 == domain->Enter());
+  Reader<SmallDomain> first(domain.get());
+  Reader<SmallDomain> second(domain.get());
+  const int first_ret = first.Run(kEnter);
+  const int second_ret = second.Run(kEnter);
+  CHECK_OR_FAIL(-1 == first_ret + second_ret);
+  Reader<SmallDomain>& overflow = 0 == first_ret ? second : first;
+  CHECK_OR_FAIL(-1 == overflow.Run(kQuiesce));
+  (0 == first_ret ? first : second).Run(kExit);
+  domain->Exit();
+  return 0;
+}
+
+int run_enter_exit_test() {
+  std::unique_ptr<epoch::EpochDomain> domain(
+      new epoch::EpochDomain(kAdvanceThreshold));
+  std::atomic<bool> retired(false);
+  CHECK_OR_FAIL(0 == domain->Enter());
+  domain->Exit();
+  CHECK_OR_FAIL(0 == domain->Quiesce());
+  CHECK_OR_FAIL(0 == domain->Quiesce());
+  domain->Exit();
+  CHECK_OR_FAIL(0 == domain->AddNode(new FlagNode(&retired)));
+  CHECK_OR_FAIL(1 == domain->hazard_waiting_count());
+
+  // Nobody is inside, the epoch advances twice and the node is deleted.
+  const uint64_t epoch = domain->current_epoch();
+  domain->Retire();
+  CHECK_OR_FAIL(epoch + 2 == domain->current_epoch());
+  CHECK_OR_FAIL(retired.load());
+  CHECK_OR_FAIL(0 == domain->hazard_waiting_count());
+  return 0;
+}
+
+// A reader inside a region holds the epoch back, so a node added in epoch
+// E is kept in E + 1 and deleted at E + 2 only.
+int run_advance_test() {
+  std::unique_ptr<epoch::EpochDomain> domain(
+      new epoch::EpochDomain(kAdvanceThreshold));
+  Reader<epoch::EpochDomain> reader(domain.get());
+  std::atomic<bool> retired(false);
+  const uint64_t epoch = domain->current_epoch();
+  CHECK_OR_FAIL(0 == reader.Run(kEnter));
+  CHECK_OR_FAIL(0 == domain->AddNode(new FlagNode(&retired)));
+
+  // The reader has seen E, so E + 1 is reached but not E + 2.
+  domain->Retire();
+  CHECK_OR_FAIL(epoch + 1 == domain->current_epoch());
+  CHECK_OR_FAIL(!retired.load());
+  domain->Retire();
+  CHECK_OR_FAIL(epoch + 1 == domain->current_epoch());
+  CHECK_OR_FAIL(!retired.load());
+
+  // Once the reader has seen E + 1, E + 2 is reached and the node deleted.
+  CHECK_OR_FAIL(0 == reader.Run(kQuiesce));
+  domain->Retire();
+  CHECK_OR_FAIL(epoch + 2 == domain->current_epoch());
+  CHECK_OR_FAIL(retired.load());
+  CHECK_OR_FAIL(0 == domain->hazard_waiting_count());
+
+  // Outside of the region, the reader holds nothing back.
+  reader.Run(kExit);
+  domain->Retire();
+  CHECK_OR_FAIL(epoch + 4 == domain->current_epoch());
+  return 0;
+}
+
+int main() {
+  // Run first, thread ids are then held by the main thread and the readers
+  // only.
+  fprintf(stdout, "Run out of records test...\n");
+  if (0 != run_out_of_records_test()) {
+    return 1;
+  }
+  fprintf(stdout, "Run enter exit test...\n");
+  if (0 != run_enter_exit_test()) {
+    return 1;
+  }
+  fprintf(stdout, "Run advance test...\n");
+  if (0 != run_advance_test()) {
+    return 1;
+  }
+  return 0;
+}
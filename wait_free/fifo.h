@@ -0,0 +1,169 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Tue Oct 29 21:05:17 CST 2019
+
+#ifndef TESLA_WAIT_FREE_FIFO_H_
+#define TESLA_WAIT_FREE_FIFO_H_
+
+#include <stddef.h>
+#include <atomic>
+
+#include "log/logging.h"
+#include "wait_free/common.h"
+#include "wait_free/hazard_version.h"
+#include "wait_free/node_pool.h"
+
+namespace tesla {
+namespace wait_free {
+
+template <typename T>
+class LockFreeQueue;
+
+template <typename T>
+class FifoNode : public hazard_version::HazardNode {
+  friend class LockFreeQueue<T>;
+ public:
+  FifoNode() : next_(nullptr) {}
+  FifoNode(const T& value) : next_(nullptr), value_(value) {}
+  ~FifoNode() override {}
+ public:
+  void Retire() override { value_ = T(); }
+ public:
+  // Nodes deleted by HazardVersion go back to the pool.
+  static void* operator new(size_t /*size*/) {
+    return NodePool<sizeof(FifoNode)>::Allocate();
+  }
+  static void operator delete(void* ptr) {
+    NodePool<sizeof(FifoNode)>::Deallocate(ptr);
+  }
+ private:
+  std::atomic<FifoNode*> next_;
+  T value_;
+};
+
+// Unbounded multi-producer multi-consumer FIFO queue of Michael and
+// Scott. `head_' points to a dummy node whose next node is the front,
+// `tail_' to the last node or, for a moment, the one before it.
+//
+// Dequeued dummies are reclaimed by HazardVersion: a thread holds a
+// version while it may dereference nodes, so a node is deleted only after
+// every thread which could have seen it released its version. Nodes come
+// from a NodePool, so enqueue does not call malloc in the steady state.
+//
+// Note: a thread gets no version when more than kMaxThreadCount threads
+// using HazardVersion are alive at once (see GetCurrentThreadId()), then
+// Enqueue() and Dequeue() fail without touching the queue.
+template <typename T>
+class LockFreeQueue {
+  using Node = FifoNode<T>;
+ public:
+  // Returned by Dequeue() when the queue is empty.
+  constexpr static int kEmpty = 1;
+
+  LockFreeQueue() {
+    Node* dummy = new Node;
+    head_.store(dummy);
+    tail_.store(dummy);
+  }
+  ~LockFreeQueue() {
+    Node* node = head_.load();
+    while (node) {
+      // Note: for exception safety, don't call Retire() when modifying list.
+      Node* current = node;
+      node = node->next_.load();
+      current->Retire();
+      delete current;
+    }
+  }
+ public:
+  // Return 0 on success, -1 if no version is acquired.
+  int Enqueue(const T& value) {
+    int ret = 0;
+    Node* node = new Node(value);
+
+    uint64_t handle = 0;
+    if (0 != (ret = hazard_version_.Acquire(handle))) {
+      LOG_ERROR << "hazard version Acquire fail, ret=" << ret;
+      delete node;
+      return ret;
+    }
+    while (true) {
+      Node* tail = tail_.load();
+      Node* next = tail->next_.load();
+      if (tail != tail_.load()) {
+        continue;
+      }
+      if (nullptr == next) {
+        if (tail->next_.compare_exchange_weak(next, node)) {
+          // Failing means another thread has helped already.
+          tail_.compare_exchange_strong(tail, node);
+          break;
+        }
+      } else {
+        // Help the enqueue which linked `next' but has not moved `tail_'.
+        tail_.compare_exchange_strong(tail, next);
+      }
+    }
+    hazard_version_.Release(handle);
+    return ret;
+  }
+
+  // Return 0 if the front value is copied into `value', kEmpty if the
+  // queue is empty, -1 if no version is acquired.
+  int Dequeue(T& value) {
+    int ret = 0;
+
+    uint64_t handle = 0;
+    if (0 != (ret = hazard_version_.Acquire(handle))) {
+      LOG_ERROR << "hazard version Acquire fail, ret=" << ret;
+      return ret;
+    }
+    while (true) {
+      Node* head = head_.load();
+      Node* tail = tail_.load();
+      Node* next = head->next_.load();
+      if (head != head_.load()) {
+        continue;
+      }
+      if (nullptr == next) {
+        ret = kEmpty;
+        break;
+      }
+      if (head == tail) {
+        tail_.compare_exchange_strong(tail, next);
+        continue;
+      }
+      // Read before the CAS: once `next' becomes the dummy, another
+      // dequeue may retire it.
+      value = next->value_;
+      if (head_.compare_exchange_weak(head, next)) {
+        hazard_version_.AddNode(head);
+        break;
+      }
+    }
+    hazard_version_.Release(handle);
+    return ret;
+  }
+ private:
+  hazard_version::HazardVersion hazard_version_;
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<Node*> head_;
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<Node*> tail_;
+};
+
+}  // wait_free
+}  // tesla
+
+#endif  // TESLA_WAIT_FREE_FIFO_H_
@@ -0,0 +1,192 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Tue Oct 29 21:48:03 CST 2019
+
+#include <unistd.h>
+#include <vector>
+#include <thread>
+
+#include "wait_free/fifo.h"
+#include "tutil/timestamp.h"
+
+using namespace tesla::tutil;
+using namespace tesla::wait_free;
+
+struct QueueValue {
+  int64_t a{0};
+  int64_t b{0};
+  int64_t sum{0};
+};
+
+struct GlobalConfiguration {
+  LockFreeQueue<QueueValue> queue;
+  int64_t loop_times;
+  std::atomic<int64_t> producer_count;
+  std::atomic<int64_t> dequeue_count;
+  std::atomic<int64_t> error_count;
+};
+
+void thread_consumer(void* data) {
+  SetCpuAffinity();
+
+  GlobalConfiguration* global_conf = (GlobalConfiguration*)data;
+  QueueValue queue_value;
+  // Values of a producer are dequeued in the order they were enqueued.
+  std::vector<int64_t> last_b;
+  int64_t count = 0;
+  bool skip = false;
+  while (true) {
+    const int ret = global_conf->queue.Dequeue(queue_value);
+    if (0 == ret) {
+      // Check value
+      if ((queue_value.a + queue_value.b) != queue_value.sum) {
+        fprintf(stderr, "error data! a[%ld] b[%ld] sum[%ld]\n",
+          queue_value.a, queue_value.b, queue_value.sum);
+        global_conf->error_count.fetch_add(1);
+      } else {
+        size_t producer = queue_value.a / global_conf->loop_times;
+        if (last_b.size() <= producer) {
+          last_b.resize(producer + 1, -1);
+        }
+        if (last_b[producer] >= queue_value.b) {
+          fprintf(stderr, "error order! producer[%zu] b[%ld] after b[%ld]\n",
+            producer, queue_value.b, last_b[producer]);
+          global_conf->error_count.fetch_add(1);
+        }
+        last_b[producer] = queue_value.b;
+      }
+      ++count;
+      skip = false;
+    } else if (LockFreeQueue<QueueValue>::kEmpty != ret) {
+      global_conf->error_count.fetch_add(1);
+      break;
+    } else {
+      if (0 == global_conf->producer_count.load()) {
+        if (skip) {
+          break;
+        } else {
+          skip = true;
+        }
+      }
+    }
+  }
+  global_conf->dequeue_count.fetch_add(count);
+}
+
+void thread_producer(void* data) {
+  SetCpuAffinity();
+
+  GlobalConfiguration* global_conf = (GlobalConfiguration*)data;
+  int64_t sum_base = GetCurrentThreadId() * global_conf->loop_times;
+  QueueValue queue_value;
+  for (int64_t i = 0; i < global_conf->loop_times; i++) {
+    queue_value.a = sum_base;
+    queue_value.b = i;
+    queue_value.sum = sum_base + i;
+    if (0 != global_conf->queue.Enqueue(queue_value)) {
+      global_conf->error_count.fetch_add(1);
+      break;
+    }
+  }
+  global_conf->producer_count.fetch_add(-1);
+}
+
+int run_test(GlobalConfiguration* global_conf, const int64_t thread_count) {
+  std::vector<std::thread> producer_group;
+  std::vector<std::thread> consumer_group;
+
+  global_conf->producer_count.store(thread_count);
+  global_conf->dequeue_count.store(0);
+  global_conf->error_count.store(0);
+  Timestamp start = Timestamp::Now();
+  for (int64_t i = 0; i < thread_count; i++) {
+    producer_group.push_back(std::thread(thread_producer, global_conf));
+    consumer_group.push_back(std::thread(thread_consumer, global_conf));
+  }
+  for (int64_t i = 0; i < thread_count; i++) {
+    producer_group[i].join();
+    consumer_group[i].join();
+  }
+  Duration d = Timestamp::Now() - start;
+  int64_t enqueue_dequeue_sum = thread_count * 2 * global_conf->loop_times;
+  fprintf(stdout, "threads=%ld+%ld enqueue+dequeue=%ld timeus=%lf tps=%0.3lftimes/s\n",
+          thread_count, thread_count,
+          enqueue_dequeue_sum,
+          d.Microseconds(),
+          1000000.0 * (double)(enqueue_dequeue_sum) / (double)(d.Microseconds()));
+
+  int ret = 0;
+  if (thread_count * global_conf->loop_times != global_conf->dequeue_count.load()) {
+    fprintf(stderr, "error count! enqueue[%ld] dequeue[%ld]\n",
+      thread_count * global_conf->loop_times, global_conf->dequeue_count.load());
+    ret = -1;
+  } else if (0 != global_conf->error_count.load()) {
+    ret = -1;
+  }
+  return ret;
+}
+
+// Threads handing work over and exiting, more than HazardVersion has
+// thread records for in total.
+int run_short_lived_threads_test(GlobalConfiguration* global_conf) {
+  const int64_t thread_count = hazard_version::kMaxThreadCount + 100;
+  int64_t error_count = 0;
+  for (int64_t i = 0; i < thread_count; i++) {
+    std::thread([global_conf, i, &error_count] {
+      QueueValue queue_value;
+      queue_value.a = i;
+      queue_value.sum = i;
+      if (0 != global_conf->queue.Enqueue(queue_value) ||
+          0 != global_conf->queue.Dequeue(queue_value) ||
+          queue_value.a != i) {
+        ++error_count;
+      }
+    }).join();
+  }
+  fprintf(stdout, "short lived threads=%ld errors=%ld\n", thread_count,
+          error_count);
+  return 0 == error_count ? 0 : -1;
+}
+
+int main(const int argc, char** argv) {
+  int64_t cpu_count = 0;
+  if (1 < argc) {
+    cpu_count = atoi(argv[1]);
+  }
+  if (0 >= cpu_count) {
+    cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  fprintf(stdout, "cpu_count[%ld]\n", cpu_count);
+
+  int64_t producer_count = (cpu_count + 1) / 2;
+  fprintf(stdout, "producer_count[%ld]\n", producer_count);
+
+  // Nodes are recycled, so the loop times do not depend on the memory.
+  GlobalConfiguration g_conf;
+  g_conf.loop_times = 10000000;
+  if (2 < argc) {
+    g_conf.loop_times = atoll(argv[2]);
+  }
+  fprintf(stdout, "loop_times[%ld]\n", g_conf.loop_times);
+
+  fprintf(stdout, "Run and check dequeue result...\n");
+  if (0 != run_test(&g_conf, producer_count)) {
+    return 1;
+  }
+
+  fprintf(stdout, "Run short lived threads...\n");
+  return 0 == run_short_lived_threads_test(&g_conf) ? 0 : 1;
+}
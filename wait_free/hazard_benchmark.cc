@@ -0,0 +1,220 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 27 22:30:05 CST 2019
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tutil/time.h"
+#include "wait_free/epoch.h"
+#include "wait_free/hazard_pointer.h"
+#include "wait_free/hazard_version.h"
+
+using namespace tesla::wait_free;
+
+// One writer keeps replacing the node which readers read, and hands the
+// old node to the reclamation scheme. Compared for all schemes:
+//   - the cost of a read and of a replacement;
+//   - the time from AddNode() to the deletion of a node;
+//   - the peak number of nodes waiting for reclamation, and the memory
+//     they take together with the scheme itself.
+// With `slow reader', one more reader holds its reference for 10ms at a
+// time like a reader which blocks.
+
+struct Stats {
+  std::atomic<int64_t> reclaimed{0};
+  std::atomic<int64_t> latency_ns{0};
+  std::atomic<int64_t> max_latency_ns{0};
+  std::atomic<bool> recording{true};
+};
+
+Stats g_stats;
+
+class Node : public hazard_version::HazardNode {
+ public:
+  explicit Node(int64_t value)
+      : value(value), check(~value), added_ns(0) {}
+  ~Node() override { value = check = 0; }
+
+  void Retire() override {
+    if (!g_stats.recording.load(std::memory_order_relaxed)) {
+      return;
+    }
+    const int64_t latency = tesla::tutil::clock_ns() - added_ns;
+    g_stats.reclaimed.fetch_add(1, std::memory_order_relaxed);
+    g_stats.latency_ns.fetch_add(latency, std::memory_order_relaxed);
+    int64_t max = g_stats.max_latency_ns.load(std::memory_order_relaxed);
+    while (max < latency &&
+           !g_stats.max_latency_ns.compare_exchange_weak(max, latency));
+  }
+
+  int64_t value;
+  int64_t check;
+  int64_t added_ns;
+};
+
+// Both schemes behind the same calls.
+struct VersionScheme {
+  using Domain = hazard_version::HazardVersion;
+  static constexpr const char* kName = "hazard version";
+
+  static Node* Acquire(Domain* d, const std::atomic<Node*>& src,
+                       uint64_t* handle) {
+    d->Acquire(*handle);
+    return src.load(std::memory_order_acquire);
+  }
+  static void Release(Domain* d, uint64_t handle) { d->Release(handle); }
+  static void Replace(Domain* d, std::atomic<Node*>& src, Node* node) {
+    uint64_t handle = 0;
+    d->Acquire(handle);
+    Node* old = src.exchange(node);
+    old->added_ns = tesla::tutil::clock_ns();
+    d->AddNode(old);
+    d->Release(handle);
+  }
+};
+
+struct PointerScheme {
+  using Domain = hazard_pointer::HazardPointerDomain;
+  static constexpr const char* kName = "hazard pointer";
+
+  static Node* Acquire(Domain* d, const std::atomic<Node*>& src,
+                       uint64_t* /*handle*/) {
+    return d->Protect(0, src);
+  }
+  static void Release(Domain* d, uint64_t /*handle*/) { d->Clear(0); }
+  static void Replace(Domain* d, std::atomic<Node*>& src, Node* node) {
+    Node* old = src.exchange(node);
+    old->added_ns = tesla::tutil::clock_ns();
+    d->AddNode(old);
+  }
+};
+
+struct EpochScheme {
+  using Domain = epoch::EpochDomain;
+  static constexpr const char* kName = "epoch";
+
+  static Node* Acquire(Domain* d, const std::atomic<Node*>& src,
+                       uint64_t* /*handle*/) {
+    d->Enter();
+    return src.load(std::memory_order_acquire);
+  }
+  static void Release(Domain* d, uint64_t /*handle*/) { d->Exit(); }
+  static void Replace(Domain* d, std::atomic<Node*>& src, Node* node) {
+    Node* old = src.exchange(node);
+    old->added_ns = tesla::tutil::clock_ns();
+    d->AddNode(old);
+  }
+};
+
+template <typename Scheme>
+void Run(int nreaders, int64_t replaces, bool slow_reader) {
+  using Domain = typename Scheme::Domain;
+  std::unique_ptr<Domain> domain(new Domain);
+  std::atomic<Node*> current(new Node(0));
+  std::atomic<bool> stop(false);
+  std::atomic<int64_t> reads(0);
+  std::atomic<int64_t> read_ns(0);
+  g_stats.reclaimed = 0;
+  g_stats.latency_ns = 0;
+  g_stats.max_latency_ns = 0;
+  g_stats.recording = true;
+
+  auto read = [&](bool slow) {
+    int64_t n = 0;
+    const int64_t begin = tesla::tutil::clock_ns();
+    while (!stop.load(std::memory_order_relaxed)) {
+      uint64_t handle = 0;
+      Node* node = Scheme::Acquire(domain.get(), current, &handle);
+      if (node->value != ~node->check) {
+        fprintf(stderr, "error data! value[%ld] check[%ld]\n", node->value,
+                node->check);
+        abort();
+      }
+      if (slow) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      Scheme::Release(domain.get(), handle);
+      ++n;
+    }
+    if (!slow) {
+      reads.fetch_add(n);
+      read_ns.fetch_add(tesla::tutil::clock_ns() - begin);
+    }
+  };
+  std::vector<std::thread> readers;
+  for (int i = 0; i < nreaders; ++i) {
+    readers.emplace_back(read, false);
+  }
+  if (slow_reader) {
+    readers.emplace_back(read, true);
+  }
+
+  int64_t peak_waiting = 0;
+  const int64_t begin = tesla::tutil::clock_ns();
+  for (int64_t i = 1; i <= replaces; ++i) {
+    Scheme::Replace(domain.get(), current, new Node(i));
+    peak_waiting = std::max(peak_waiting, domain->hazard_waiting_count());
+  }
+  const int64_t write_ns = tesla::tutil::clock_ns() - begin;
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  g_stats.recording = false;
+  const int64_t reclaimed = g_stats.reclaimed.load();
+
+  fprintf(stdout,
+          "%-15s readers=%d%s read=%.1fns replace=%.1fns reclaimed=%ld/%ld "
+          "latency avg=%.1fus max=%.1fus peak waiting=%ld "
+          "memory=%zuKB+%ldKB\n",
+          Scheme::kName, nreaders, slow_reader ? "+slow" : "",
+          reads.load() ? (double)read_ns.load() / reads.load() : 0.0,
+          (double)write_ns / replaces, reclaimed, replaces,
+          reclaimed ? g_stats.latency_ns.load() / 1000.0 / reclaimed : 0.0,
+          g_stats.max_latency_ns.load() / 1000.0, peak_waiting,
+          sizeof(Domain) / 1024,
+          peak_waiting * (int64_t)sizeof(Node) / 1024);
+  domain.reset();
+  delete current.load();
+}
+
+int main(const int argc, char** argv) {
+  int64_t replaces = 1000000;
+  int max_readers = 4;
+  if (1 < argc) {
+    replaces = atol(argv[1]);
+  }
+  if (2 < argc) {
+    max_readers = atoi(argv[2]);
+  }
+  for (int slow = 0; slow <= 1; ++slow) {
+    for (int nreaders = 1; nreaders <= max_readers; nreaders *= 2) {
+      Run<VersionScheme>(nreaders, replaces, slow);
+      Run<PointerScheme>(nreaders, replaces, slow);
+      Run<EpochScheme>(nreaders, replaces, slow);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,307 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sun Oct 27 20:14:36 CST 2019
+
+#ifndef TESLA_WAIT_FREE_HAZARD_POINTER_H_
+#define TESLA_WAIT_FREE_HAZARD_POINTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "wait_free/common.h"
+#include "wait_free/hazard_version.h"
+#include "wait_free/util.h"
+#include "log/logging.h"
+
+namespace tesla {
+namespace wait_free {
+namespace hazard_pointer {
+
+// Nodes are the same as the ones of HazardVersion: Retire() is called
+// right before the node is deleted.
+using hazard_version::HazardNode;
+
+// Hazard pointers protect single nodes instead of everything retired after
+// a version, so a reference held for long (e.g. while blocking) delays the
+// reclamation of that node only.
+//   Reader:
+//     Node* node = domain.Protect(0, head_);
+//     ... use node ...
+//     domain.Clear(0);
+//   Writer, after unlinking `node' from the structure:
+//     domain.AddNode(node);
+// Each thread has `MaxHazardPointers' slots, indexed by the callers. Nodes
+// added by a thread are batched and scanned against all slots once the
+// thread has `thread_retire_threshold' of them, so the cost of a scan is
+// amortized over the batch.
+//
+// Note:
+//   1. Threads are identified by GetCurrentThreadId() like HazardVersion,
+//      which must be less than `MaxThreadCount'.
+//   2. Nodes added by a thread which exited are reclaimed by Retire() of
+//      other threads or the destructor.
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+class HazardPointerDomainT {
+ public:
+  HazardPointerDomainT(const int64_t thread_retire_threshold = 64);
+  ~HazardPointerDomainT();
+ public:
+  // Load the pointer of `src' into slot `index' of the current thread and
+  // return it. The node is not reclaimed until the slot is cleared or
+  // protects another node. Return nullptr if the thread or the index is
+  // out of range.
+  template <typename T>
+  T* Protect(const int index, const std::atomic<T*>& src);
+
+  void Clear(const int index);
+
+  // Reclaim `node', which is no longer reachable for new readers, as soon
+  // as no slot protects it.
+  int AddNode(HazardNode* node);
+
+  // Reclaim the unprotected nodes added by all threads.
+  void Retire();
+
+  int64_t hazard_waiting_count() const;
+ private:
+  struct HAZARD_CACHELINE_ALIGNMENT ThreadRecord {
+    std::atomic<const HazardNode*> hazards[MaxHazardPointers];
+    // Pushed by the owner and by scans which keep protected nodes, taken
+    // as a whole by scans.
+    std::atomic<HazardNode*> retired_list{nullptr};
+    // Note: may be negative for a while like the count of HazardVersion.
+    std::atomic<int64_t> retired_count{0};
+    bool enabled{false};
+
+    ThreadRecord() {
+      for (int i = 0; i < MaxHazardPointers; ++i) {
+        hazards[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  int GetThreadRecord(ThreadRecord*& record);
+  static void AddNodes(ThreadRecord* record, HazardNode* head,
+                       HazardNode* tail, const int64_t count);
+  // Reclaim unprotected nodes of `records' and move the others to
+  // `receiver'.
+  void Scan(ThreadRecord* receiver, ThreadRecord* begin, ThreadRecord* end);
+ private:
+  int64_t thread_retire_threshold_;
+
+  ThreadRecord threads_[MaxThreadCount];
+  // Records of [0, thread_count_) may have been used.
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<int> thread_count_;
+  HAZARD_CACHELINE_ALIGNMENT std::atomic<int64_t> hazard_waiting_count_;
+};
+
+constexpr static uint16_t kMaxThreadCount = 1024;
+constexpr static int kMaxHazardPointers = 4;
+using HazardPointerDomain =
+    HazardPointerDomainT<kMaxThreadCount, kMaxHazardPointers>;
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::HazardPointerDomainT(
+    const int64_t thread_retire_threshold)
+    : thread_retire_threshold_(thread_retire_threshold),
+      thread_count_(0),
+      hazard_waiting_count_(0) {
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::~HazardPointerDomainT() {
+  // No reader is left, reclaim everything.
+  const int thread_count = thread_count_.load();
+  for (int i = 0; i < thread_count; ++i) {
+    HazardNode* list = threads_[i].retired_list.exchange(nullptr);
+    while (nullptr != list) {
+      HazardNode* current = list;
+      list = list->next();
+      current->Retire();
+      delete current;
+    }
+  }
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+template <typename T>
+T* HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::Protect(
+    const int index, const std::atomic<T*>& src) {
+  ThreadRecord* record = nullptr;
+  if (0 > index || MaxHazardPointers <= index) {
+    LOG_ERROR << "invalid hazard pointer index[" << index << "]";
+    return nullptr;
+  } else if (0 != GetThreadRecord(record)) {
+    return nullptr;
+  }
+  std::atomic<const HazardNode*>& hazard = record->hazards[index];
+  T* ptr = src.load(std::memory_order_relaxed);
+  while (true) {
+    // The store must be visible to scans before `src' is read again,
+    // which pairs with the fence in Scan().
+    hazard.store(ptr, std::memory_order_seq_cst);
+    T* current = src.load(std::memory_order_acquire);
+    if (current == ptr) {
+      return ptr;
+    }
+    ptr = current;
+  }
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+void HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::Clear(
+    const int index) {
+  ThreadRecord* record = nullptr;
+  if (0 <= index && MaxHazardPointers > index &&
+      0 == GetThreadRecord(record)) {
+    record->hazards[index].store(nullptr, std::memory_order_release);
+  }
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+int HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::AddNode(
+    HazardNode* node) {
+  int ret = 0;
+  ThreadRecord* record = nullptr;
+  if (nullptr == node) {
+    LOG_ERROR << "invalid parameter, node nullptr";
+    ret = -1;
+  } else if (0 != (ret = GetThreadRecord(record))) {
+    LOG_ERROR << "GetThreadRecord fail, ret=" << ret;
+  } else {
+    AddNodes(record, node, node, 1);
+    hazard_waiting_count_.fetch_add(1);
+    if (thread_retire_threshold_ <= record->retired_count.load()) {
+      Scan(record, record, record + 1);
+    }
+  }
+  return ret;
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+void HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::Retire() {
+  ThreadRecord* record = nullptr;
+  if (0 != GetThreadRecord(record)) {
+    LOG_ERROR << "GetThreadRecord fail";
+  } else {
+    Scan(record, threads_, threads_ + thread_count_.load());
+  }
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+int64_t
+HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::hazard_waiting_count()
+    const {
+  return hazard_waiting_count_.load();
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+int HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::GetThreadRecord(
+    ThreadRecord*& record) {
+  const int64_t thread_id = GetCurrentThreadId();
+  if (MaxThreadCount <= thread_id) {
+    LOG_ERROR << "thread number overflow, thread_id=" << thread_id;
+    return -1;
+  }
+  record = &threads_[thread_id];
+  if (!record->enabled) {
+    record->enabled = true;
+    int count = thread_count_.load();
+    while (count <= thread_id &&
+           !thread_count_.compare_exchange_weak(count, thread_id + 1));
+  }
+  return 0;
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+void HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::AddNodes(
+    ThreadRecord* record, HazardNode* head, HazardNode* tail,
+    const int64_t count) {
+  if (0 < count) {
+    tail->set_next(record->retired_list.load());
+    while (!record->retired_list.compare_exchange_weak(tail->mutable_next(),
+                                                        head));
+    record->retired_count.fetch_add(count);
+  }
+}
+
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+void HazardPointerDomainT<MaxThreadCount, MaxHazardPointers>::Scan(
+    ThreadRecord* receiver, ThreadRecord* begin, ThreadRecord* end) {
+  // Nodes were unlinked before they were added, so a reader which
+  // publishes one of them after this fence finds `src' changed and
+  // retries.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::vector<const HazardNode*> hazards;
+  const int thread_count = thread_count_.load();
+  for (int i = 0; i < thread_count; ++i) {
+    for (int j = 0; j < MaxHazardPointers; ++j) {
+      const HazardNode* hazard =
+          threads_[i].hazards[j].load(std::memory_order_acquire);
+      if (nullptr != hazard) {
+        hazards.push_back(hazard);
+      }
+    }
+  }
+  std::sort(hazards.begin(), hazards.end());
+
+  HazardNode* list2retire = nullptr;
+  HazardNode* keep_head = nullptr;
+  HazardNode* keep_tail = nullptr;
+  int64_t retire_count = 0;
+  int64_t keep_count = 0;
+  for (ThreadRecord* record = begin; record != end; ++record) {
+    HazardNode* list = record->retired_list.exchange(nullptr);
+    int64_t taken = 0;
+    while (nullptr != list) {
+      HazardNode* current = list;
+      list = list->next();
+      ++taken;
+      if (std::binary_search(hazards.begin(), hazards.end(), current)) {
+        current->set_next(keep_head);
+        keep_head = current;
+        if (nullptr == keep_tail) {
+          keep_tail = current;
+        }
+        ++keep_count;
+      } else {
+        current->set_next(list2retire);
+        list2retire = current;
+        ++retire_count;
+      }
+    }
+    record->retired_count.fetch_add(-taken);
+  }
+  AddNodes(receiver, keep_head, keep_tail, keep_count);
+  hazard_waiting_count_.fetch_add(-retire_count);
+
+  // Retire nodes which no other threads access.
+  while (nullptr != list2retire) {
+    HazardNode* current = list2retire;
+    list2retire = list2retire->next();
+    current->Retire();
+    delete current;
+  }
+}
+
+}  // hazard_pointer
+}  // wait_free
+}  // tesla
+
+#endif  // TESLA_WAIT_FREE_HAZARD_POINTER_H_
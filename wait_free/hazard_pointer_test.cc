@@ -0,0 +1,180 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Nov  2 16:05:12 CST 2019
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "wait_free/hazard_pointer.h"
+
+using namespace tesla::wait_free;
+
+// States of a slot, which is never reused, so a reader finding a retired
+// slot protected a node reclaimed under it.
+enum SlotState {
+  kLive = 1,
+  kRetired = 2,
+};
+
+std::atomic<int64_t> g_error_count(0);
+std::atomic<int64_t> g_retired_count(0);
+
+class SlotNode : public hazard_pointer::HazardNode {
+ public:
+  SlotNode(std::atomic<int>* slots, const int64_t index)
+      : slots_(slots), index_(index) {}
+
+  int64_t index() const { return index_; }
+
+  void Retire() override {
+    if (kLive != slots_[index_].exchange(kRetired)) {
+      fprintf(stderr, "error retire! slot[%ld] retired twice\n", index_);
+      g_error_count.fetch_add(1);
+    }
+    g_retired_count.fetch_add(1);
+  }
+
+ private:
+  std::atomic<int>* slots_;
+  const int64_t index_;
+};
+
+// A protected node survives scans and is deleted once its slot is cleared.
+int run_protected_node_test() {
+  // Declared before the domain, whose destructor retires the left nodes.
+  std::atomic<int> slots[2];
+  slots[0].store(kLive);
+  slots[1].store(kLive);
+  std::unique_ptr<hazard_pointer::HazardPointerDomain> domain(
+      new hazard_pointer::HazardPointerDomain);
+  std::atomic<SlotNode*> src(new SlotNode(slots, 0));
+  std::atomic<int> step(0);
+  std::thread reader([&domain, &src, &step] {
+    if (nullptr == domain->Protect(0, src)) {
+      g_error_count.fetch_add(1);
+    }
+    step.store(1);
+    while (2 != step.load()) {
+      std::this_thread::yield();
+    }
+    domain->Clear(0);
+    step.store(3);
+  });
+  while (1 != step.load()) {
+    std::this_thread::yield();
+  }
+
+  int ret = 0;
+  SlotNode* old = src.exchange(new SlotNode(slots, 1));
+  domain->AddNode(old);
+  domain->Retire();
+  if (kLive != slots[0].load() || 1 != domain->hazard_waiting_count()) {
+    fprintf(stderr, "error protected node! retired while protected\n");
+    ret = -1;
+  }
+  step.store(2);
+  reader.join();
+  domain->Retire();
+  if (kRetired != slots[0].load() || 0 != domain->hazard_waiting_count()) {
+    fprintf(stderr, "error cleared node! not retired, waiting[%ld]\n",
+            domain->hazard_waiting_count());
+    ret = -1;
+  }
+  domain->AddNode(src.exchange(nullptr));
+  return ret;
+}
+
+// Readers protect the current node and check its slot while one writer
+// keeps replacing it, every replaced node must be retired once and never
+// while it is protected.
+int run_reclamation_test(const int64_t reader_count, const int64_t loop_times) {
+  std::unique_ptr<std::atomic<int>[]> slots(
+      new std::atomic<int>[loop_times + 1]);
+  slots[0].store(kLive);
+  std::unique_ptr<hazard_pointer::HazardPointerDomain> domain(
+      new hazard_pointer::HazardPointerDomain);
+  std::atomic<SlotNode*> src(new SlotNode(slots.get(), 0));
+  std::atomic<bool> stop(false);
+  g_retired_count.store(0);
+
+  std::vector<std::thread> readers;
+  for (int64_t i = 0; i < reader_count; i++) {
+    readers.push_back(std::thread([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        SlotNode* node = domain->Protect(0, src);
+        if (nullptr == node) {
+          g_error_count.fetch_add(1);
+          break;
+        }
+        const int64_t index = node->index();
+        if (kLive != slots[index].load()) {
+          fprintf(stderr, "error read! slot[%ld] retired while protected\n",
+                  index);
+          g_error_count.fetch_add(1);
+        }
+        domain->Clear(0);
+      }
+    }));
+  }
+
+  for (int64_t i = 1; i <= loop_times; i++) {
+    slots[i].store(kLive);
+    domain->AddNode(src.exchange(new SlotNode(slots.get(), i)));
+  }
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  domain->Retire();
+
+  fprintf(stdout, "readers=%ld replaces=%ld retired=%ld errors=%ld\n",
+          reader_count, loop_times, g_retired_count.load(),
+          g_error_count.load());
+  if (loop_times != g_retired_count.load()) {
+    fprintf(stderr, "error count! replaced[%ld] retired[%ld]\n",
+            loop_times, g_retired_count.load());
+    return -1;
+  }
+  domain->AddNode(src.exchange(nullptr));
+  return 0 == g_error_count.load() ? 0 : -1;
+}
+
+int main(const int argc, char** argv) {
+  int64_t reader_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (1 < argc) {
+    reader_count = atoi(argv[1]);
+  }
+  if (2 > reader_count) {
+    reader_count = 2;
+  }
+  int64_t loop_times = 1000000;
+  if (2 < argc) {
+    loop_times = atoll(argv[2]);
+  }
+
+  fprintf(stdout, "Run protected node test...\n");
+  if (0 != run_protected_node_test() || 0 != g_error_count.load()) {
+    return 1;
+  }
+  fprintf(stdout, "Run reclamation test...\n");
+  return 0 == run_reclamation_test(reader_count, loop_times) ? 0 : 1;
+}
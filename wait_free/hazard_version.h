@@ -27,9 +27,21 @@
 #include "wait_free/util.h"
 //#include "wait_free/spin_lock.h"
 #include "tutil/timestamp.h"
+#include "log/logging.h"
 
 namespace tesla {
 namespace wait_free {
+
+namespace hazard_pointer {
+template <uint16_t MaxThreadCount, int MaxHazardPointers>
+class HazardPointerDomainT;
+}  // hazard_pointer
+
+namespace epoch {
+template <uint16_t MaxThreadCount>
+class EpochDomainT;
+}  // epoch
+
 namespace hazard_version {
 
 class ThreadLocalStorage;
@@ -37,6 +49,10 @@ class ThreadLocalStorage;
 // TODO(tesla): why not use `struct' ?
 class HazardNode {
  friend class hazard_version::ThreadLocalStorage;
+ template <uint16_t MaxThreadCount, int MaxHazardPointers>
+ friend class hazard_pointer::HazardPointerDomainT;
+ template <uint16_t MaxThreadCount>
+ friend class epoch::EpochDomainT;
 
  public:
   HazardNode()
@@ -113,15 +129,15 @@ class ThreadLocalStorage {
  private:
   bool enabled_;
   uint16_t tid_;  // identifies which thread this object belong to.
-  uint64_t last_retire_version_;
+  // Retire() may be called from any thread.
+  std::atomic<uint64_t> last_retire_version_;
 
   // Put variables that work together into the same cacheline.
-  struct HAZARD_CACHELINE_ALIGNMENT
-  {
-    uint32_t current_seq_;
-    uint64_t current_version_;
-  };
-  
+  // `current_version_' is read by min_version() of other threads, an
+  // anonymous struct can not hold an atomic, so align the first one.
+  HAZARD_CACHELINE_ALIGNMENT uint32_t current_seq_;
+  std::atomic<uint64_t> current_version_;
+
   HAZARD_CACHELINE_ALIGNMENT std::atomic<HazardNode*> hazard_waiting_list_;
   // Note: moidifying `hazard_waiting_list_' and `hazard_waiting_count_' is
   // not an atomic operation, so `hazard_waiting_count_' may be negative.
@@ -217,8 +233,7 @@ ThreadLocalStorage*& ThreadLocalStorage::mutable_next() {
 
 void ThreadLocalStorage::AbortNotInSameThread(uint16_t tid) {
   if (tid != GetCurrentThreadId()) {
-    fprintf(stderr, "tid[%u] != current thread id[%ld]\n", tid, GetCurrentThreadId());
-    abort();
+    LOG_FATAL << "tid[" << tid << "] != current thread id[" << GetCurrentThreadId() << "]";
   }
 }
 
@@ -226,13 +241,17 @@ int ThreadLocalStorage::Acquire(const uint64_t version,
                                 VersionHandle& handle) {
   AbortNotInSameThread(tid_);
   int ret = 0;
-  if (current_version_ != std::numeric_limits<uint64_t>::max()) {
-      fprintf(stderr,
-              "current thread has already assigned a version handle, seq=%u\n",
-              current_seq_);
+  if (current_version_.load(std::memory_order_relaxed) !=
+      std::numeric_limits<uint64_t>::max()) {
+      LOG_ERROR << "current thread has already assigned a version handle, seq="
+                << current_seq_;
       ret = -1;
   } else {
-    current_version_ = version;
+    // seq_cst: published before the caller checks `global_version_' again,
+    // pairing with the seq_cst loads of min_version(). Otherwise a thread
+    // could compute the min version without seeing this one and free
+    // nodes this thread is about to read.
+    current_version_.store(version, std::memory_order_seq_cst);
     handle.tid = tid_;
     handle._ = 0;
     handle.seq = current_seq_;
@@ -243,9 +262,10 @@ int ThreadLocalStorage::Acquire(const uint64_t version,
 void ThreadLocalStorage::Release(VersionHandle& handle) {
   AbortNotInSameThread(tid_);
   if (handle.tid != tid_ && handle.seq != current_seq_) {
-    fprintf(stderr, "invalid handle, seq=%u tid=%hu\n", handle.seq, handle.tid);
+    LOG_ERROR << "invalid handle, seq=" << handle.seq << " tid=" << handle.tid;
   } else {
-    current_version_ = std::numeric_limits<uint64_t>::max();
+    current_version_.store(std::numeric_limits<uint64_t>::max(),
+                           std::memory_order_release);
     current_seq_++;
   }
 }
@@ -266,10 +286,10 @@ int64_t ThreadLocalStorage::Retire(const uint64_t version,
     AbortNotInSameThread(tid_);
   }
   
-  if (last_retire_version_ == version) {
+  if (last_retire_version_.exchange(version, std::memory_order_relaxed) ==
+      version) {
     return 0;
   }
-  last_retire_version_ = version;
 
   HazardNode* current = hazard_waiting_list_.exchange(nullptr);
   
@@ -321,7 +341,7 @@ int64_t ThreadLocalStorage::hazard_waiting_count() const {
 }
 
 uint64_t ThreadLocalStorage::current_version() const {
-  return current_version_;
+  return current_version_.load(std::memory_order_seq_cst);
 }
 
 void ThreadLocalStorage::AddNodes(HazardNode* head, HazardNode* tail,
@@ -359,7 +379,7 @@ HazardVersionT<MaxThreadCount>::HazardVersionT(
 template <uint16_t MaxThreadCount>
 HazardVersionT<MaxThreadCount>::~HazardVersionT() {
   Retire();
-  fprintf(stdout, "~HazardVersionT\n");
+  LOG_DEBUG << "~HazardVersionT";
 }
 
 template <uint16_t MaxThreadCount>
@@ -368,15 +388,15 @@ int HazardVersionT<MaxThreadCount>::Acquire(uint64_t& handle) {
   
   hazard_version::ThreadLocalStorage* tls = nullptr;
   if (0 != (ret = GetThreadLocalStorage(tls))) {
-    fprintf(stderr, "GetThreadLocalStorage fail, ret=%d\n", ret);
+    LOG_ERROR << "GetThreadLocalStorage fail, ret=" << ret;
   } else {
     while (true) {
       const uint64_t version = global_version_.load();
       hazard_version::VersionHandle version_handle(0);
       if (0 != (ret = tls->Acquire(version, version_handle))) {
-        fprintf(stderr, "tls Acquire fail, ret=%d\n", ret);
+        LOG_ERROR << "tls Acquire fail, ret=" << ret;
         break;
-      } else if (version != global_version_.load()) {
+      } else if (version != global_version_.load(std::memory_order_seq_cst)) {
         tls->Release(version_handle);
       } else {
         handle = version_handle.u64;
@@ -393,12 +413,12 @@ int HazardVersionT<MaxThreadCount>::AddNode(HazardNode* node) {
   hazard_version::ThreadLocalStorage* tls = nullptr;
 
   if (nullptr == node) {
-    fprintf(stderr, "invalid parameter, node nullptr\n");
+    LOG_ERROR << "invalid parameter, node nullptr";
     return -1;
   } else if (0 != (ret = GetThreadLocalStorage(tls))) {
-    fprintf(stderr, "GetThreadLocalStorage fail, ret=%d\n", ret);
+    LOG_ERROR << "GetThreadLocalStorage fail, ret=" << ret;
   } else if (0 != (ret = tls->AddNode(global_version_.fetch_add(1), node))) {
-    fprintf(stderr, "tls AddNode fail, ret=%d\n", ret);
+    LOG_ERROR << "tls AddNode fail, ret=" << ret;
   } else {
     hazard_waiting_count_.fetch_add(1);
   }
@@ -429,7 +449,7 @@ int HazardVersionT<MaxThreadCount>::GetThreadLocalStorage(
   uint16_t thread_id = static_cast<uint16_t>(GetCurrentThreadId());
 
   if (MaxThreadCount <= thread_id) {
-    fprintf(stderr, "thread number overflow, thread_id=%hu\n", thread_id);
+    LOG_ERROR << "thread number overflow, thread_id=" << thread_id;
     return -1;
   } else {
     tls = &threads_[thread_id];
@@ -438,7 +458,7 @@ int HazardVersionT<MaxThreadCount>::GetThreadLocalStorage(
         tls->set_next(thread_list_.load());
         while (!thread_list_.compare_exchange_weak(tls->mutable_next(), tls));
         thread_count_.fetch_add(1);
-        fprintf(stdout, "thread_count_[%ld]\n", thread_count_.load());
+        LOG_DEBUG << "thread_count_[" << thread_count_.load() << "]";
     }
   }
   return ret;
@@ -457,6 +477,10 @@ uint64_t HazardVersionT<MaxThreadCount>::min_version(const bool force_flush) {
           > tutil::Timestamp::Now().UnixMicroseconds()) {
     // from cache
   } else {
+    // Start from the current version instead of the max reported by
+    // threads holding no version: threads acquiring one later get at least
+    // the current one, so the cached value stays safe for them.
+    min_version = global_version_.load();
     hazard_version::ThreadLocalStorage* iter = thread_list_.load();
     while (nullptr != iter) {
       uint64_t tls_version = iter->current_version();
@@ -478,7 +502,7 @@ void HazardVersionT<MaxThreadCount>::Retire() {
   int ret = 0;
   hazard_version::ThreadLocalStorage* tls = nullptr;
   if (0 != (ret = GetThreadLocalStorage(tls))) {
-    fprintf(stderr, "GetThreadLocalStorage fail, ret=%d\n", ret);
+    LOG_ERROR << "GetThreadLocalStorage fail, ret=" << ret;
   } else {
     uint64_t version = min_version(true);
 
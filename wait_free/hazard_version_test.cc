@@ -0,0 +1,180 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Sat Nov  2 15:20:41 CST 2019
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "wait_free/hazard_version.h"
+
+using namespace tesla::wait_free;
+
+// States of a slot, which is never reused, so a reader finding a retired
+// slot read a node reclaimed under it.
+enum SlotState {
+  kLive = 1,
+  kRetired = 2,
+};
+
+std::atomic<int64_t> g_error_count(0);
+std::atomic<int64_t> g_retired_count(0);
+
+class SlotNode : public hazard_version::HazardNode {
+ public:
+  explicit SlotNode(std::atomic<int>* slot) : slot_(slot) {}
+
+  void Retire() override {
+    if (kLive != slot_->exchange(kRetired)) {
+      fprintf(stderr, "error retire! slot retired twice\n");
+      g_error_count.fetch_add(1);
+    }
+    g_retired_count.fetch_add(1);
+  }
+
+ private:
+  std::atomic<int>* slot_;
+};
+
+// A node added while another thread holds an older version is kept until
+// that version is released.
+int run_held_version_test() {
+  // Declared before the domain, whose destructor retires the left nodes.
+  std::atomic<int> slot(kLive);
+  std::unique_ptr<hazard_version::HazardVersion> domain(
+      new hazard_version::HazardVersion);
+  std::atomic<int> step(0);
+  std::thread reader([&domain, &step] {
+    uint64_t handle = 0;
+    if (0 != domain->Acquire(handle)) {
+      g_error_count.fetch_add(1);
+    }
+    step.store(1);
+    while (2 != step.load()) {
+      std::this_thread::yield();
+    }
+    domain->Release(handle);
+    step.store(3);
+  });
+  while (1 != step.load()) {
+    std::this_thread::yield();
+  }
+
+  int ret = 0;
+  domain->AddNode(new SlotNode(&slot));
+  domain->Retire();
+  if (kLive != slot.load()) {
+    fprintf(stderr, "error held version! node retired while held\n");
+    ret = -1;
+  }
+  step.store(2);
+  reader.join();
+  domain->Retire();
+  if (kRetired != slot.load()) {
+    fprintf(stderr, "error released version! node not retired\n");
+    ret = -1;
+  }
+  if (0 != domain->hazard_waiting_count()) {
+    fprintf(stderr, "error count! waiting[%ld]\n",
+            domain->hazard_waiting_count());
+    ret = -1;
+  }
+  return ret;
+}
+
+// Readers check the slot of the current node under a version while one
+// writer keeps replacing it, every replaced slot must be retired once and
+// never while a reader may see it.
+int run_reclamation_test(const int64_t reader_count, const int64_t loop_times) {
+  std::unique_ptr<std::atomic<int>[]> slots(
+      new std::atomic<int>[loop_times + 1]);
+  slots[0].store(kLive);
+  std::unique_ptr<hazard_version::HazardVersion> domain(
+      new hazard_version::HazardVersion);
+  std::atomic<int64_t> current(0);
+  std::atomic<bool> stop(false);
+  g_retired_count.store(0);
+
+  std::vector<std::thread> readers;
+  for (int64_t i = 0; i < reader_count; i++) {
+    readers.push_back(std::thread([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t handle = 0;
+        if (0 != domain->Acquire(handle)) {
+          g_error_count.fetch_add(1);
+          break;
+        }
+        const int64_t index = current.load();
+        if (kLive != slots[index].load()) {
+          fprintf(stderr, "error read! slot[%ld] retired under a version\n",
+                  index);
+          g_error_count.fetch_add(1);
+        }
+        domain->Release(handle);
+      }
+    }));
+  }
+
+  for (int64_t i = 1; i <= loop_times; i++) {
+    slots[i].store(kLive);
+    const int64_t old = current.exchange(i);
+    domain->AddNode(new SlotNode(&slots[old]));
+    if (0 == i % 64) {
+      domain->Retire();
+    }
+  }
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  domain->Retire();
+
+  fprintf(stdout, "readers=%ld replaces=%ld retired=%ld errors=%ld\n",
+          reader_count, loop_times, g_retired_count.load(),
+          g_error_count.load());
+  if (loop_times != g_retired_count.load()) {
+    fprintf(stderr, "error count! replaced[%ld] retired[%ld]\n",
+            loop_times, g_retired_count.load());
+    return -1;
+  }
+  return 0 == g_error_count.load() ? 0 : -1;
+}
+
+int main(const int argc, char** argv) {
+  int64_t reader_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (1 < argc) {
+    reader_count = atoi(argv[1]);
+  }
+  if (2 > reader_count) {
+    reader_count = 2;
+  }
+  int64_t loop_times = 1000000;
+  if (2 < argc) {
+    loop_times = atoll(argv[2]);
+  }
+
+  fprintf(stdout, "Run held version test...\n");
+  if (0 != run_held_version_test() || 0 != g_error_count.load()) {
+    return 1;
+  }
+  fprintf(stdout, "Run reclamation test...\n");
+  return 0 == run_reclamation_test(reader_count, loop_times) ? 0 : 1;
+}
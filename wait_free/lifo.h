@@ -59,7 +59,7 @@ class LockFreeStack {
       current->Retire();
       ++count;
     }
-    fprintf(stdout, "~LockFreeStack:: remaining count[%ld]\n", count);
+    LOG_DEBUG << "~LockFreeStack:: remaining count[" << count << "]";
   }
  public:
   void Push(Node* node) {
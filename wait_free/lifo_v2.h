@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <atomic>
+#include "log/logging.h"
 
 namespace tesla {
 namespace wait_free {
@@ -39,7 +40,7 @@ class LockFreeStackWithReferenceCount {
   ~LockFreeStackWithReferenceCount() {
     uint64_t count = 0;
     while (Pop()) { count++; }
-    fprintf(stdout, "%lu nodes in the list when destructing!\n", count);
+    LOG_DEBUG << count << " nodes in the list when destructing!";
   }
  public:
   struct Node;
@@ -0,0 +1,154 @@
+// Copyright (c) 2019 Tesla, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Author: Michael Tesla (michaeltesla1995@gmail.com)
+// Date: Tue Oct 29 20:36:40 CST 2019
+
+#ifndef TESLA_WAIT_FREE_NODE_POOL_H_
+#define TESLA_WAIT_FREE_NODE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+#include "wait_free/spin_lock.h"
+
+namespace tesla {
+namespace wait_free {
+
+// Recycle blocks of `Size' bytes, e.g. as operator new/delete of a node
+// type, so that a steady producer does not call malloc:
+//   static void* operator new(size_t) {
+//     return NodePool<sizeof(Node)>::Allocate();
+//   }
+//   static void operator delete(void* p) {
+//     NodePool<sizeof(Node)>::Deallocate(p);
+//   }
+// Every thread keeps up to 2 * `kBatchSize' free blocks of its own, and
+// exchanges batches of `kBatchSize' with a global list under a spin lock,
+// so nodes freed by consumers flow back to producers. Blocks are never
+// returned to the system, the pool stays at its peak size.
+template <size_t Size>
+class NodePool {
+ public:
+  constexpr static int64_t kBatchSize = 64;
+
+  static void* Allocate() {
+    LocalCache& cache = local_cache();
+    if (nullptr == cache.head) {
+      cache.head = global().Take(&cache.count);
+      if (nullptr == cache.head) {
+        return ::operator new(kBlockSize);
+      }
+    }
+    Block* block = cache.head;
+    cache.head = block->next;
+    --cache.count;
+    return block;
+  }
+
+  static void Deallocate(void* ptr) {
+    if (nullptr == ptr) {
+      return;
+    }
+    LocalCache& cache = local_cache();
+    Block* block = static_cast<Block*>(ptr);
+    block->next = cache.head;
+    cache.head = block;
+    if (2 * kBatchSize <= ++cache.count) {
+      cache.GiveBack(kBatchSize);
+    }
+  }
+
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  constexpr static size_t kBlockSize =
+      Size < sizeof(Block) ? sizeof(Block) : Size;
+
+  class GlobalList {
+   public:
+    // Link the blocks from `head' to `tail' into the list.
+    void Put(Block* head, Block* tail) {
+      lock_.Lock();
+      tail->next = head_;
+      head_ = head;
+      lock_.Unlock();
+    }
+
+    // Unlink up to kBatchSize blocks, their number is put into `count'.
+    Block* Take(int64_t* count) {
+      lock_.Lock();
+      Block* head = head_;
+      Block* tail = nullptr;
+      int64_t n = 0;
+      for (Block* iter = head_; nullptr != iter && n < kBatchSize;
+           iter = iter->next) {
+        tail = iter;
+        ++n;
+      }
+      if (nullptr != tail) {
+        head_ = tail->next;
+        tail->next = nullptr;
+      }
+      lock_.Unlock();
+      *count = n;
+      return n > 0 ? head : nullptr;
+    }
+
+   private:
+    SpinLock lock_;
+    Block* head_{nullptr};
+  };
+
+  struct LocalCache {
+    Block* head{nullptr};
+    int64_t count{0};
+
+    ~LocalCache() { GiveBack(count); }
+
+    // Move the first `n' blocks to the global list.
+    void GiveBack(int64_t n) {
+      if (0 >= n || nullptr == head) {
+        return;
+      }
+      Block* first = head;
+      Block* last = head;
+      for (int64_t i = 1; i < n && nullptr != last->next; ++i) {
+        last = last->next;
+      }
+      head = last->next;
+      count -= n;
+      global().Put(first, last);
+    }
+  };
+
+  static GlobalList& global() {
+    // Never destroyed, threads may exit after static destruction.
+    static GlobalList* list = new GlobalList;
+    return *list;
+  }
+
+  static LocalCache& local_cache() {
+    thread_local static LocalCache cache;
+    return cache;
+  }
+};
+
+}  // wait_free
+}  // tesla
+
+#endif  // TESLA_WAIT_FREE_NODE_POOL_H_
@@ -43,7 +43,7 @@ class SpinLock {
   }
 
  private:
-  HAZARD_CACHELINE_ALIGNMENT std::atomic_flag flag_;
+  HAZARD_CACHELINE_ALIGNMENT std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
 };
 
 }  // wait_free
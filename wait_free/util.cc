@@ -17,9 +17,12 @@
 
 #include "wait_free/util.h"
 #include <pthread.h>
-#include <stdio.h>
 #include <unistd.h>
 #include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "log/logging.h"
 
 namespace tesla {
 namespace wait_free {
@@ -27,26 +30,74 @@ namespace wait_free {
 static_assert(sizeof(std::atomic<uint16_t>) == sizeof(uint16_t),
               "atomic template should not modify the size of data type");
 
+namespace {
+
+// Ids of exited threads are taken by new threads, so that ids stay below
+// the peak number of live threads and the per-thread records indexed by
+// them are reused.
+class ThreadIdAllocator {
+ public:
+  int64_t Allocate() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (free_ids_.empty()) {
+      return next_id_++;
+    }
+    const int64_t id = free_ids_.back();
+    free_ids_.pop_back();
+    return id;
+  }
+
+  void Free(int64_t id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    free_ids_.push_back(id);
+  }
+
+ private:
+  std::mutex mutex_;
+  int64_t next_id_{0};
+  std::vector<int64_t> free_ids_;
+};
+
+ThreadIdAllocator& GetThreadIdAllocator() {
+  // Never destroyed, threads may exit after static destruction.
+  static ThreadIdAllocator* allocator = new ThreadIdAllocator;
+  return *allocator;
+}
+
+struct ThreadId {
+  int64_t id{-1};
+
+  ~ThreadId() {
+    if (id != -1) {
+      GetThreadIdAllocator().Free(id);
+      // A destructor of another thread local object calling
+      // GetCurrentThreadId() later gets a new id, which is never freed,
+      // instead of sharing this one with the next thread.
+      id = -1;
+    }
+  }
+};
+
+}  // namespace
+
 int64_t GetCurrentThreadId() {
-  static std::atomic<int64_t> gid(0);
-  thread_local static int64_t tid = -1;
-  if (tid == -1) {
-    tid = gid.fetch_add(1);
+  thread_local static ThreadId tid;
+  if (tid.id == -1) {
+    tid.id = GetThreadIdAllocator().Allocate();
   }
-  return tid;
+  return tid.id;
 }
 
 void SetCpuAffinity() {
   int64_t cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  CPU_SET(GetCurrentThreadId() % cpu_count, &cpuset);
+  const int64_t cpu = GetCurrentThreadId() % cpu_count;
+  CPU_SET(cpu, &cpuset);
   if (0 == pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)) {
-    fprintf(stdout, "pthread_setaffinity_np success %ld \n",
-      GetCurrentThreadId() % cpu_count);
+    LOG_DEBUG << "pthread_setaffinity_np success " << cpu;
   } else {
-    fprintf(stdout, "pthread_setaffinity_np fail %ld \n",
-      GetCurrentThreadId() % cpu_count);
+    LOG_WARN << "pthread_setaffinity_np fail " << cpu;
   }
 }
 
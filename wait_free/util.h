@@ -25,8 +25,9 @@ namespace wait_free {
 
 // Note:
 //   1. Returns the same value called by the same thread.
-//   2. Returns different values called by different threads.
-//      values are continues and begin from zero.
+//   2. Returns different values called by different live threads.
+//      values begin from zero, ids of exited threads are reused, so they
+//      are less than the peak number of threads alive at once.
 int64_t GetCurrentThreadId();
 
 void SetCpuAffinity();